@@ -1,7 +1,34 @@
 // Copyright 1998-2018 Epic Games, Inc. All Rights Reserved.
 
 #include "ActionGame.h"
+#include "ActionGameLog.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Parse.h"
 #include "Modules/ModuleManager.h"
 
-IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, ActionGame, "ActionGame" );
- 
\ No newline at end of file
+class FActionGameModule : public FDefaultGameModuleImpl
+{
+public:
+	virtual void StartupModule() override
+	{
+		FActionGameLog::Startup();
+	}
+
+	virtual void ShutdownModule() override
+	{
+		FActionGameLog::Shutdown();
+	}
+};
+
+bool FActionGameProfile::HasPresentation()
+{
+#if ACTIONGAME_WITH_PRESENTATION
+	// decided once, before the first character class default object is constructed
+	static const bool bHasPresentation = !IsRunningDedicatedServer() && !FParse::Param(FCommandLine::Get(), TEXT("ServerProfile"));
+	return bHasPresentation;
+#else
+	return false;
+#endif
+}
+
+IMPLEMENT_PRIMARY_GAME_MODULE( FActionGameModule, ActionGame, "ActionGame" );
@@ -3,3 +3,23 @@
 #pragma once
 
 #include "CoreMinimal.h"
+
+/** Presentation (cameras, combat sounds, on-screen log messages) is compiled out of the dedicated server target **/
+#ifndef ACTIONGAME_WITH_PRESENTATION
+	#define ACTIONGAME_WITH_PRESENTATION !UE_SERVER
+#endif
+
+
+/**
+ * Build profile of the running process.
+ *
+ * A process that shows nothing - the ActionGameServer target, a game build started
+ * with -server, or -ServerProfile to measure it headless - creates no cameras, loads
+ * no combat sounds, animates only what hit timing needs and logs to file only.
+ */
+class ACTIONGAME_API FActionGameProfile
+{
+public:
+	/** Whether combatants create their presentation only components and assets **/
+	static bool HasPresentation();
+};
@@ -1,6 +1,7 @@
 // Copyright 1998-2018 Epic Games, Inc. All Rights Reserved.
 
 #include "ActionGameCharacter.h"
+#include "ActionGame.h"
 #include "HeadMountedDisplayFunctionLibrary.h"
 #include "Camera/CameraComponent.h"
 #include "Components/CapsuleComponent.h"
@@ -8,14 +9,26 @@
 #include "GameFramework/CharacterMovementComponent.h"
 #include "GameFramework/Controller.h"
 #include "GameFramework/SpringArmComponent.h"
+#include "CombatAIController.h"
+#include "CombatAudioManager.h"
+#include "CombatLatencyTracer.h"
+#include "CombatSignificanceManager.h"
+#include "GameFramework/GameStateBase.h"
+#include "Net/UnrealNetwork.h"
 
 #include "Engine.h"
 #include "UnrealMathUtility.h"
 
+DECLARE_CYCLE_STAT(TEXT("AttackInput"), STAT_AttackInput, STATGROUP_ActionGameCombat);
+DECLARE_CYCLE_STAT(TEXT("AttackNotifyStart"), STAT_AttackNotifyStart, STATGROUP_ActionGameCombat);
+DECLARE_CYCLE_STAT(TEXT("AttackNotifyEnd"), STAT_AttackNotifyEnd, STATGROUP_ActionGameCombat);
+DECLARE_CYCLE_STAT(TEXT("OnAttackHit"), STAT_OnAttackHit, STATGROUP_ActionGameCombat);
+
 //////////////////////////////////////////////////////////////////////////
 // AActionGameCharacter
 
-AActionGameCharacter::AActionGameCharacter()
+AActionGameCharacter::AActionGameCharacter(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer.SetDefaultSubobjectClass<UCombatMovementComponent>(ACharacter::CharacterMovementComponentName))
 {
 	// Set size for collision capsule
 	GetCapsuleComponent()->InitCapsuleSize(42.f, 96.0f);
@@ -24,6 +37,30 @@ AActionGameCharacter::AActionGameCharacter()
 	BaseTurnRate = 45.f;
 	BaseLookUpRate = 45.f;
 
+	CombatantId = INDEX_NONE;
+	AttackCounter = 0;
+	bPooled = false;
+	Team = 0;
+	bLockedOn = false;
+	bHitPoseRequired = false;
+
+	LockOnRadius = 1500.f;
+	LockOnAngle = 60.f;
+	LockOnBreakDistance = 2000.f;
+	LockOnCameraSpeed = 8.f;
+	SoftTargetRadius = 300.f;
+	SoftTargetAngle = 60.f;
+	Significance = ECombatSignificance::HIGH;
+
+	MaxHealth = 100.f;
+	Health = MaxHealth;
+
+	// replicated attacks are fast forwarded by their delay, up to this much
+	MaxAttackCatchUpSeconds = 0.25f;
+
+	// limbs are swept by the combat manager, the boxes never need a collision profile change
+	MeleeHitDetection = EMeleeHitDetection::SWEEP;
+
 	// Don't rotate when the controller rotates. Let that just affect the camera.
 	bUseControllerRotationPitch = false;
 	bUseControllerRotationYaw = false;
@@ -35,6 +72,7 @@ AActionGameCharacter::AActionGameCharacter()
 	GetCharacterMovement()->JumpZVelocity = 600.f;
 	GetCharacterMovement()->AirControl = 0.2f;
 
+	// the subobjects never depend on how the process was started, blueprints saved with either profile load in both
 	// Create a camera boom (pulls in towards the player if there is a collision)
 	CameraBoom = CreateDefaultSubobject<USpringArmComponent>(TEXT("CameraBoom"));
 	CameraBoom->SetupAttachment(RootComponent);
@@ -49,26 +87,15 @@ AActionGameCharacter::AActionGameCharacter()
 	// Note: The skeletal mesh and anim blueprint references on the Mesh component (inherited from Character) 
 	// are set in the derived blueprint asset named MyCharacter (to avoid direct content references in C++)
 
-	// load player montage
-	static ConstructorHelpers::FObjectFinder<UAnimMontage> MeleeFistAttackMontageObject(TEXT("AnimMontage'/Game/Resources/Animations/Attack/Punch/MeleeFistAttackMontage.MeleeFistAttackMontage'"));
-	if (MeleeFistAttackMontageObject.Succeeded())
-	{
-		MeleeFistAttackMontage = MeleeFistAttackMontageObject.Object;
-	}
-
-	// load player attack data table
-	static ConstructorHelpers::FObjectFinder<UDataTable> MeleeAttackDataTableObject(TEXT("DataTable'/Game/Resources/PlayerDataTables/PlayerDataTable.PlayerDataTable'"));
-	if (MeleeAttackDataTableObject.Succeeded())
-	{
-		MeleeAttackDataTable = MeleeAttackDataTableObject.Object;
-	}
+	// combat content is streamed in by the move set, nothing is loaded with the class
+	MeleeAttackDataTable = TSoftObjectPtr<UDataTable>(FSoftObjectPath(TEXT("/Game/Resources/PlayerDataTables/PlayerDataTable.PlayerDataTable")));
 
 	LeftCollisionBox = CreateDefaultSubobject<UBoxComponent>(TEXT("LeftCollisionBox"));
 	LeftCollisionBox->SetupAttachment(RootComponent);
 	LeftCollisionBox->SetCollisionProfileName(MeleeCollisionProfile.Disabled);
 
+	// limb boxes stay hidden, ActionGame.Debug.Hitboxes draws the ones that can hit
 	LeftCollisionBox->SetWorldScale3D(FVector(0.18f));
-	LeftCollisionBox->SetHiddenInGame(false);
 	LeftCollisionBox->SetNotifyRigidBodyCollision(false); // collision simulation generates hit events
 
 
@@ -77,28 +104,33 @@ AActionGameCharacter::AActionGameCharacter()
 	RightCollisionBox->SetCollisionProfileName(MeleeCollisionProfile.Disabled);
 
 	RightCollisionBox->SetWorldScale3D(FVector(0.18f));
-	RightCollisionBox->SetHiddenInGame(false);
 	RightCollisionBox->SetNotifyRigidBodyCollision(false); // collision simulation generates hit events
 
+	LimbBoxes.Add(LeftCollisionBox);
+	LimbBoxes.Add(RightCollisionBox);
 
-	// sound cue
-	static ConstructorHelpers::FObjectFinder<USoundCue> AttackPunchSoundCueObject(TEXT("SoundCue'/Game/Resources/Audio/AttackPunchCue.AttackPunchCue'"));
-	if (AttackPunchSoundCueObject.Succeeded())
-	{
-		AttackPunchSoundCue = AttackPunchSoundCueObject.Object;
+	// sound cues, played through the shared combat voice pool, never streamed in without presentation
+	AttackPunchSoundCue = TSoftObjectPtr<USoundCue>(FSoftObjectPath(TEXT("/Game/Resources/Audio/AttackPunchCue.AttackPunchCue")));
+	PunchThrowSoundCue = TSoftObjectPtr<USoundCue>(FSoftObjectPath(TEXT("/Game/Resources/Audio/punchThrowSoundCue.punchThrowSoundCue")));
+}
 
-		PunchAudioComponent = CreateDefaultSubobject<UAudioComponent>("PunchAudioComponent");
-		PunchAudioComponent->SetupAttachment(RootComponent);		
-	}
-	
-	// punch throw sound cue
-	static ConstructorHelpers::FObjectFinder<USoundCue> PunchThrowSoundCueObject(TEXT("SoundCue'/Game/Resources/Audio/punchThrowSoundCue.punchThrowSoundCue'"));
-	if (PunchThrowSoundCueObject.Succeeded())
-	{
-		PunchThrowSoundCue = PunchThrowSoundCueObject.Object;
+void AActionGameCharacter::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
 
-		PunchThrowAudioComponent = CreateDefaultSubobject<UAudioComponent>("PunchThrowAudioComponent");
-		PunchThrowAudioComponent->SetupAttachment(RootComponent);
+	// nobody looks through the camera of a server that shows nothing
+	if (!FActionGameProfile::HasPresentation())
+	{
+		if (FollowCamera)
+		{
+			FollowCamera->DestroyComponent();
+			FollowCamera = nullptr;
+		}
+		if (CameraBoom)
+		{
+			CameraBoom->DestroyComponent();
+			CameraBoom = nullptr;
+		}
 	}
 }
 
@@ -106,10 +138,29 @@ void AActionGameCharacter::BeginPlay()
 {
 	Super::BeginPlay();
 
-	IsAnimationBlended = true;
+	// recordings and the benchmark reseed it before driving the character
+	AttackRandom.Initialize(static_cast<int32>(FPlatformTime::Cycles()));
 
-	LeftCollisionBox->OnComponentHit.AddDynamic(this, &AActionGameCharacter::OnAttackHit);
-	RightCollisionBox->OnComponentHit.AddDynamic(this, &AActionGameCharacter::OnAttackHit);
+	if (Role == ROLE_Authority)
+	{
+		Health = MaxHealth;
+	}
+
+	// attacks are refused until the move set has streamed in, usually preloaded by the game mode
+	MoveSet = RequestMoveSet();
+	MoveSet->CallWhenLoaded(FSimpleDelegate::CreateUObject(this, &AActionGameCharacter::OnMoveSetLoaded));
+
+	// attack state lives in the combat manager
+	CombatManager = ACombatManager::Get(this);
+	RegisterCombatant();
+
+	if (MeleeHitDetection == EMeleeHitDetection::PHYSICS_EVENTS)
+	{
+		for (UBoxComponent* LimbBox : LimbBoxes)
+		{
+			LimbBox->OnComponentHit.AddDynamic(this, &AActionGameCharacter::OnAttackHit);
+		}
+	}
 
 	//LeftCollisionBox->OnComponentBeginOverlap.AddDynamic(this, &AActionGameCharacter::OnAttackOverlapBegin);
 	//RightCollisionBox->OnComponentBeginOverlap.AddDynamic(this, &AActionGameCharacter::OnAttackOverlapBegin);
@@ -117,14 +168,165 @@ void AActionGameCharacter::BeginPlay()
 	//LeftCollisionBox->OnComponentEndOverlap.AddDynamic(this, &AActionGameCharacter::OnAttackOverlapEnd);
 	//RightCollisionBox->OnComponentEndOverlap.AddDynamic(this, &AActionGameCharacter::OnAttackOverlapEnd);
 
-	if (PunchAudioComponent != NULL && AttackPunchSoundCue != NULL)
+	if (FActionGameProfile::HasPresentation())
+	{
+		CombatAudio = ACombatAudioManager::Get(this);
+	}
+	else
 	{
-		PunchAudioComponent->SetSound(AttackPunchSoundCue);
+		// the skeleton is posed only while an attack needs its limbs, montages keep their timing
+		SetHitPoseRequired(false);
 	}
 
-	if (PunchThrowAudioComponent!= NULL && PunchThrowSoundCue != NULL)
+	// ranks this character with the others from the next update on
+	ACombatSignificanceManager::Get(this);
+}
+
+void AActionGameCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	UnregisterCombatant();
+
+	// the last character of its class unloads the move set with the next garbage collection
+	AttackCatalogue.Reset();
+	MoveSet.Reset();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+TSharedRef<FCombatMoveSet> AActionGameCharacter::RequestMoveSet() const
+{
+	TArray<FSoftObjectPath> Assets;
+	if (FActionGameProfile::HasPresentation())
 	{
-		PunchThrowAudioComponent->SetSound(PunchThrowSoundCue);
+		Assets.Add(AttackPunchSoundCue.ToSoftObjectPath());
+		Assets.Add(PunchThrowSoundCue.ToSoftObjectPath());
+	}
+	Assets.RemoveAll([](const FSoftObjectPath& Path) { return Path.IsNull(); });
+
+	return FCombatMoveSet::Request(GetClass(), MeleeAttackDataTable, Assets);
+}
+
+void AActionGameCharacter::OnMoveSetLoaded()
+{
+	AttackCatalogue = MoveSet->GetCatalogue();
+}
+
+void AActionGameCharacter::RegisterCombatant()
+{
+	if (CombatManager.IsValid() && CombatantId == INDEX_NONE)
+	{
+		CombatantId = CombatManager->RegisterCombatant(this, LimbBoxes, MeleeHitDetection);
+		UpdateClaimedHits();
+	}
+}
+
+void AActionGameCharacter::UnregisterCombatant()
+{
+	if (HasCombatant())
+	{
+		CombatManager->UnregisterCombatant(CombatantId);
+	}
+	CombatantId = INDEX_NONE;
+}
+
+void AActionGameCharacter::DeactivateForPool()
+{
+	// the attack in flight ends here, its window and limb collision with it
+	if (HasCombatant())
+	{
+		CombatManager->StopAttack(CombatantId);
+	}
+	GetCombatMovement()->StopLunge();
+	SetLockOnTarget(nullptr);
+	StopAnimMontage();
+	UnregisterCombatant();
+	if (bHitPoseRequired)
+	{
+		SetHitPoseRequired(false);
+	}
+
+	for (UBoxComponent* LimbBox : LimbBoxes)
+	{
+		LimbBox->SetCollisionProfileName(MeleeCollisionProfile.Disabled);
+		LimbBox->SetNotifyRigidBodyCollision(false);
+	}
+
+	GetCharacterMovement()->StopMovementImmediately();
+	InputFrame.Reset();
+	ReplicatedAttack = FAttackEvent();
+	AttackCounter = 0;
+
+	// nothing ticks, animates, collides or renders while pooled, delegates stay bound for the next use
+	SetActorHiddenInGame(true);
+	SetActorEnableCollision(false);
+	SetActorTickEnabled(false);
+	GetCharacterMovement()->SetComponentTickEnabled(false);
+	GetMesh()->SetComponentTickEnabled(false);
+	bPooled = true;
+}
+
+void AActionGameCharacter::ActivateFromPool(const FTransform& Transform)
+{
+	bPooled = false;
+	SetActorTransform(Transform, false, nullptr, ETeleportType::TeleportPhysics);
+
+	SetActorHiddenInGame(false);
+	SetActorEnableCollision(true);
+	SetActorTickEnabled(true);
+	GetCharacterMovement()->SetComponentTickEnabled(true);
+	GetMesh()->SetComponentTickEnabled(true);
+
+	AttackRandom.Initialize(static_cast<int32>(FPlatformTime::Cycles()));
+	if (Role == ROLE_Authority)
+	{
+		Health = MaxHealth;
+	}
+	// full detail until the next ranking places it
+	SetSignificance(ECombatSignificance::HIGH);
+	RegisterCombatant();
+}
+
+void AActionGameCharacter::SetSignificance(ECombatSignificance Tier)
+{
+	if (Tier == Significance)
+	{
+		return;
+	}
+	Significance = Tier;
+
+	const FCombatSignificanceTier& Settings = ACombatSignificanceManager::GetTier(Tier);
+	SetActorTickInterval(Settings.TickInterval);
+	GetMesh()->SetComponentTickInterval(Settings.AnimationTickInterval);
+	GetCharacterMovement()->SetComponentTickInterval(Settings.MovementTickInterval);
+
+	// far away bodies stop following the animation, attack hits run on the combat manager's clock either way
+	GetMesh()->KinematicBonesUpdateToPhysics = Settings.bFullCollision ? EKinematicBonesUpdateToPhysics::SkipSimulatingBones : EKinematicBonesUpdateToPhysics::SkipAllBones;
+
+	// idle limb boxes leave the animated sockets, the next attack attaches them again
+	const bool bWindowOpen = HasCombatant() && CombatManager->IsAttackWindowOpen(CombatantId);
+	if (!Settings.bFullCollision && !bWindowOpen)
+	{
+		const FAttachmentTransformRules AttachmentTransformRules(EAttachmentRule::KeepRelative, false);
+		for (UBoxComponent* LimbBox : LimbBoxes)
+		{
+			if (LimbBox->GetAttachParent() != GetRootComponent())
+			{
+				LimbBox->AttachToComponent(GetRootComponent(), AttachmentTransformRules);
+			}
+		}
+	}
+}
+
+void AActionGameCharacter::OnRep_Pooled()
+{
+	// the replicated transform has already moved the character
+	if (bPooled)
+	{
+		DeactivateForPool();
+	}
+	else
+	{
+		ActivateFromPool(GetActorTransform());
 	}
 }
 
@@ -135,11 +337,12 @@ void AActionGameCharacter::SetupPlayerInputComponent(class UInputComponent* Play
 {
 	// Set up gameplay key bindings
 	check(PlayerInputComponent);
-	PlayerInputComponent->BindAction("Jump", IE_Pressed, this, &ACharacter::Jump);
-	PlayerInputComponent->BindAction("Jump", IE_Released, this, &ACharacter::StopJumping);
+	PlayerInputComponent->BindAction("Jump", IE_Pressed, this, &AActionGameCharacter::JumpInput);
+	PlayerInputComponent->BindAction("Jump", IE_Released, this, &AActionGameCharacter::StopJumpingInput);
 
 	PlayerInputComponent->BindAction("Punch", IE_Pressed, this, &AActionGameCharacter::PunchInput);
 	PlayerInputComponent->BindAction("Kick", IE_Pressed, this, &AActionGameCharacter::KickInput);
+	PlayerInputComponent->BindAction("LockOn", IE_Pressed, this, &AActionGameCharacter::LockOnInput);
 
 	PlayerInputComponent->BindAxis("MoveForward", this, &AActionGameCharacter::MoveForward);
 	PlayerInputComponent->BindAxis("MoveRight", this, &AActionGameCharacter::MoveRight);
@@ -147,9 +350,9 @@ void AActionGameCharacter::SetupPlayerInputComponent(class UInputComponent* Play
 	// We have 2 versions of the rotation bindings to handle different kinds of devices differently
 	// "turn" handles devices that provide an absolute delta, such as a mouse.
 	// "turnrate" is for devices that we choose to treat as a rate of change, such as an analog joystick
-	PlayerInputComponent->BindAxis("Turn", this, &APawn::AddControllerYawInput);
+	PlayerInputComponent->BindAxis("Turn", this, &AActionGameCharacter::Turn);
 	PlayerInputComponent->BindAxis("TurnRate", this, &AActionGameCharacter::TurnAtRate);
-	PlayerInputComponent->BindAxis("LookUp", this, &APawn::AddControllerPitchInput);
+	PlayerInputComponent->BindAxis("LookUp", this, &AActionGameCharacter::LookUp);
 	PlayerInputComponent->BindAxis("LookUpRate", this, &AActionGameCharacter::LookUpAtRate);
 
 	// handle touch devices
@@ -162,142 +365,618 @@ void AActionGameCharacter::SetupPlayerInputComponent(class UInputComponent* Play
 
 bool AActionGameCharacter::GetIsAnimationBlended()
 {
-	return IsAnimationBlended;
+	return !HasCombatant() || CombatManager->IsAnimationBlended(CombatantId);
 }
 
 void AActionGameCharacter::SetIsKeyboardEnabled(bool Enabled)
 {
-	IsKeyboardEnabled = Enabled;
+	if (HasCombatant())
+	{
+		CombatManager->SetMovementEnabled(CombatantId, Enabled);
+	}
 }
 
 void AActionGameCharacter::PunchInput()
 {
+	InputFrame.Actions |= FCombatInputFrame::ACTION_Punch;
 	AttackInput(EAttackType::MELEE_FIST);
 }
 
 void AActionGameCharacter::KickInput()
 {
+	InputFrame.Actions |= FCombatInputFrame::ACTION_Kick;
 	AttackInput(EAttackType::MELEE_KICK);
 }
 
+void AActionGameCharacter::JumpInput()
+{
+	InputFrame.Actions |= FCombatInputFrame::ACTION_JumpPressed;
+	Jump();
+}
+
+void AActionGameCharacter::StopJumpingInput()
+{
+	InputFrame.Actions |= FCombatInputFrame::ACTION_JumpReleased;
+	StopJumping();
+}
+
+void AActionGameCharacter::ReplayInputFrame(const FCombatInputFrame& Frame)
+{
+	// actions before axes, the order the player input component handles them in
+	if (Frame.Actions & FCombatInputFrame::ACTION_JumpPressed)
+	{
+		JumpInput();
+	}
+	if (Frame.Actions & FCombatInputFrame::ACTION_JumpReleased)
+	{
+		StopJumpingInput();
+	}
+	if (Frame.Actions & FCombatInputFrame::ACTION_Punch)
+	{
+		PunchInput();
+	}
+	if (Frame.Actions & FCombatInputFrame::ACTION_Kick)
+	{
+		KickInput();
+	}
+	if (Frame.Actions & FCombatInputFrame::ACTION_LockOn)
+	{
+		LockOnInput();
+	}
+
+	MoveForward(Frame.Axes[FCombatInputFrame::AXIS_MoveForward]);
+	MoveRight(Frame.Axes[FCombatInputFrame::AXIS_MoveRight]);
+	Turn(Frame.Axes[FCombatInputFrame::AXIS_Turn]);
+	TurnAtRate(Frame.Axes[FCombatInputFrame::AXIS_TurnRate]);
+	LookUp(Frame.Axes[FCombatInputFrame::AXIS_LookUp]);
+	LookUpAtRate(Frame.Axes[FCombatInputFrame::AXIS_LookUpRate]);
+}
+
+void AActionGameCharacter::SetAttackRandomSeed(int32 Seed)
+{
+	AttackRandom.Initialize(Seed);
+}
+
 EAttackType AActionGameCharacter::GetCurrentAttackType()
 {
-	return CurrentAttack;
+	return HasCombatant() ? CombatManager->GetAttackType(CombatantId) : EAttackType::MELEE_FIST;
+}
+
+bool AActionGameCharacter::HasCombatant() const
+{
+	return CombatantId != INDEX_NONE && CombatManager.IsValid();
+}
+
+const FCompiledAttack* AActionGameCharacter::GetActiveAttack() const
+{
+	return HasCombatant() ? CombatManager->GetAttack(CombatantId) : nullptr;
+}
+
+bool AActionGameCharacter::IsMovementEnabled() const
+{
+	return !HasCombatant() || CombatManager->IsMovementEnabled(CombatantId);
+}
+
+float AActionGameCharacter::GetAttackLungeSpeed() const
+{
+	const FCompiledAttack* Attack = GetActiveAttack();
+	return Attack ? Attack->LungeSpeed : 0.f;
 }
 
 void AActionGameCharacter::AttackInput(EAttackType type)
 {
-	Log(ELogLevel::INFO, __FUNCTION__);
+	SCOPE_CYCLE_COUNTER(STAT_AttackInput);
+	AG_LOG(Combat, TRACE, "{}", __FUNCTION__);
+
+	// simulated proxies only play the attacks replicated to them
+	if (Role == ROLE_SimulatedProxy || !HasCombatant())
+	{
+		return;
+	}
+
+	// the combat manager holds the press until the combo table allows it
+	CombatManager->BufferAttack(CombatantId, type);
+}
+
+void AActionGameCharacter::ExecuteAttack(EAttackType Type, int32 Section)
+{
+	// an attack whose montage is still streaming is dropped rather than loaded here
+	const FCompiledAttack* Attack = AttackCatalogue.IsValid() ? AttackCatalogue->Find(Type) : nullptr;
+	if (Attack == nullptr || !HasCombatant() || IsDefeated())
+	{
+		AG_LOG(Combat, DEBUG, "Attack {} not available yet", Type);
+		return;
+	}
+
+	FCombatLatencyTracer::BeginAttack(this, Type);
 
+	AttackCounter = static_cast<uint8>((AttackCounter + 1) & ((1 << FAttackEvent::CounterBits) - 1));
 
-	if (MeleeAttackDataTable)
+	// a combo link names its section, anything else picks one of the montage sections at random
+	const int32 NumSections = FMath::Min(Attack->SectionNames.Num(), FAttackEvent::MaxSections);
+	FAttackEvent Event;
+	Event.AttackType = static_cast<uint8>(Type);
+	Event.SectionIndex = static_cast<uint8>(Section >= 0 && Section < NumSections ? Section : AttackRandom.RandHelper(NumSections));
+	Event.Counter = AttackCounter;
+	Event.SetStartTime(GetServerWorldTime());
+
+	// clients play the attack right away, the server confirms or rejects it
+	if (!PlayAttack(Event, 0.f, false))
+	{
+		return;
+	}
+
+	if (Role == ROLE_Authority)
+	{
+		ReplicateAttack(Event);
+	}
+	else
 	{
-		static const FString ContextString(TEXT("Player Attack Montage Context"));
-		// attach collision to sockets based on transformation definitions
-		const FAttachmentTransformRules AttachmentTransformRules(EAttachmentRule::SnapToTarget, EAttachmentRule::SnapToTarget, EAttachmentRule::KeepWorld, false);
+		ServerAttack(Event);
+		CombatManager->RecordAttackEventSent();
+	}
+}
 
-		CurrentAttack = type;
+bool AActionGameCharacter::PlayAttack(const FAttackEvent& Event, float StartOffset, bool bIgnoreCooldown)
+{
+	const FCompiledAttack* Attack = AttackCatalogue.IsValid() ? AttackCatalogue->Find(Event.GetAttackType()) : nullptr;
+	if (Attack == nullptr || !HasCombatant() || Event.SectionIndex >= Attack->SectionNames.Num())
+	{
+		return false;
+	}
 
-		switch (type)
+	// the attack may still be cooling down
+	if (!CombatManager->StartAttack(CombatantId, Event.GetAttackType(), Attack, Event.SectionIndex, bIgnoreCooldown))
+	{
+		return false;
+	}
+
+	// limbs are swept from the animated pose, posed from the first frame so the window never reads a stale one
+	if (!FActionGameProfile::HasPresentation() && !bHitPoseRequired)
+	{
+		SetHitPoseRequired(true);
+	}
+
+	// attach collision to sockets based on transformation definitions, only when the attack uses other sockets
+	const FAttachmentTransformRules AttachmentTransformRules(EAttachmentRule::SnapToTarget, EAttachmentRule::SnapToTarget, EAttachmentRule::KeepWorld, false);
+	for (int32 Limb = 0; Limb < FMath::Min(LimbBoxes.Num(), Attack->LimbSockets.Num()); ++Limb)
+	{
+		UBoxComponent* LimbBox = LimbBoxes[Limb];
+		if (LimbBox->GetAttachSocketName() != Attack->LimbSockets[Limb] || LimbBox->GetAttachParent() != GetMesh())
 		{
-		case EAttackType::MELEE_FIST:
-			AttackMontage = MeleeAttackDataTable->FindRow<FPlayAttackMontage>(FName(TEXT("Punch")), ContextString, true);
-
-			LeftCollisionBox->AttachToComponent(GetMesh(), AttachmentTransformRules, "fist_l_collision");
-			RightCollisionBox->AttachToComponent(GetMesh(), AttachmentTransformRules, "fist_r_collision");
-
-			IsKeyboardEnabled = true;
-
-			IsAnimationBlended = true;
-			break;
-		case EAttackType::MELEE_KICK:
-			AttackMontage = MeleeAttackDataTable->FindRow<FPlayAttackMontage>(FName(TEXT("Kick")), ContextString, true);
-
-			LeftCollisionBox->AttachToComponent(GetMesh(), AttachmentTransformRules, "foot_l_collision");
-			RightCollisionBox->AttachToComponent(GetMesh(), AttachmentTransformRules, "foot_r_collision");
-			
-			IsKeyboardEnabled = false;
-			IsAnimationBlended = false;
-			break;
-		default:
-			IsAnimationBlended = true;
-			break;
+			LimbBox->AttachToComponent(GetMesh(), AttachmentTransformRules, Attack->LimbSockets[Limb]);
 		}
+	}
 
-		if (AttackMontage)
-		{
-			int32 AniSectionCount = AttackMontage->AnimationSectionCount;
+	// the owner and the server turn the attacker the same way, others get the rotation replicated
+	if (Role != ROLE_SimulatedProxy)
+	{
+		FaceAttackTarget();
+	}
+
+	// the lunge runs in the predicted movement, late events only get what is left of it
+	if (Attack->HasLunge() && StartOffset < Attack->LungeDuration)
+	{
+		GetCombatMovement()->StartLunge(Attack->LungeSpeed, Attack->LungeDuration - StartOffset);
+	}
 
-			// generate random index 1-3
-			int AnimSectionIndex = rand() % AniSectionCount + 1;
-			// combine to section name
-			FString AnimSectionName = "start_" + FString::FromInt(AnimSectionIndex);
+	const FName& AnimSectionName = Attack->SectionNames[Event.SectionIndex];
+	PlayAnimMontage(Attack->Montage, 1.0f, AnimSectionName);
+	FCombatLatencyTracer::MarkStage(this, ECombatLatencyStage::MontageStart);
 
-			PlayAnimMontage(AttackMontage->Montage, 1.0f, FName(*AnimSectionName));
-		}
+	// late events start part way into their section to line up with the server
+	UAnimInstance* AnimInstance = GetMesh()->GetAnimInstance();
+	if (StartOffset > 0.f && AnimInstance)
+	{
+		float SectionStart, SectionEnd;
+		Attack->Montage->GetSectionStartAndEndTime(Attack->Montage->GetSectionIndex(AnimSectionName), SectionStart, SectionEnd);
+		AnimInstance->Montage_SetPosition(Attack->Montage, FMath::Min(SectionStart + StartOffset, SectionEnd));
+	}
+	if (StartOffset > 0.f)
+	{
+		CombatManager->SkipAttackTime(CombatantId, StartOffset);
+	}
+	return true;
+}
+
+void AActionGameCharacter::FaceAttackTarget()
+{
+	const AActionGameCharacter* Target = LockOnTarget.Get();
+	if (Target == nullptr)
+	{
+		// without a lock the nearest enemy along the move input, or ahead when standing
+		const FVector Acceleration = GetCharacterMovement()->GetCurrentAcceleration();
+		const FVector Direction = Acceleration.IsNearlyZero() ? GetActorForwardVector() : Acceleration;
+		Target = CombatManager->FindTarget(GetActorLocation(), Direction, SoftTargetRadius, FMath::Cos(FMath::DegreesToRadians(SoftTargetAngle)), Team, this);
+	}
+
+	if (Target)
+	{
+		SetActorRotation(FRotator(0.f, (Target->GetActorLocation() - GetActorLocation()).Rotation().Yaw, 0.f));
+	}
+}
+
+void AActionGameCharacter::LockOnInput()
+{
+	InputFrame.Actions |= FCombatInputFrame::ACTION_LockOn;
+
+	if (bLockedOn)
+	{
+		SetLockOnTarget(nullptr);
+		return;
+	}
+	if (!HasCombatant() || Controller == nullptr)
+	{
+		return;
+	}
+
+	const FVector ViewDirection = Controller->GetControlRotation().Vector();
+	SetLockOnTarget(CombatManager->FindTarget(GetActorLocation(), ViewDirection, LockOnRadius, FMath::Cos(FMath::DegreesToRadians(LockOnAngle)), Team, this));
+}
+
+void AActionGameCharacter::SetLockOnTarget(AActionGameCharacter* Target)
+{
+	if (Target == LockOnTarget.Get() && bLockedOn == (Target != nullptr))
+	{
+		return;
+	}
+
+	LockOnTarget = Target;
+	bLockedOn = Target != nullptr;
+
+	// locked, the character turns with the control rotation aimed at the target and strafes around it
+	GetCharacterMovement()->bOrientRotationToMovement = !bLockedOn;
+	GetCharacterMovement()->bUseControllerDesiredRotation = bLockedOn;
+
+	if (Role == ROLE_AutonomousProxy)
+	{
+		ServerSetLockOnTarget(Target);
 	}
 }
 
+bool AActionGameCharacter::ServerSetLockOnTarget_Validate(AActionGameCharacter* Target)
+{
+	return Target != this;
+}
+
+void AActionGameCharacter::ServerSetLockOnTarget_Implementation(AActionGameCharacter* Target)
+{
+	SetLockOnTarget(Target);
+}
+
+void AActionGameCharacter::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	if (bLockedOn)
+	{
+		UpdateLockOn(DeltaSeconds);
+	}
+
+	if (bHitPoseRequired && (!HasCombatant() || !CombatManager->IsAttackPlaying(CombatantId)))
+	{
+		SetHitPoseRequired(false);
+	}
+}
+
+void AActionGameCharacter::SetHitPoseRequired(bool bRequired)
+{
+	bHitPoseRequired = bRequired;
+
+	// nothing renders on a server, this picks between posing the bones and ticking the montages alone
+	GetMesh()->VisibilityBasedAnimTickOption = bRequired ? EVisibilityBasedAnimTickOption::AlwaysTickPoseAndRefreshBones : EVisibilityBasedAnimTickOption::OnlyTickMontagesWhenNotRendered;
+}
+
+bool AActionGameCharacter::IsPresentationComponent(const UActorComponent* Component) const
+{
+	return Component && (Component == CameraBoom || Component == FollowCamera);
+}
+
+void AActionGameCharacter::UpdateLockOn(float DeltaSeconds)
+{
+	// both sides release on their own, the server does not wait for the owner's call
+	const AActionGameCharacter* Target = LockOnTarget.Get();
+	if (Target == nullptr || Target->IsPooled() || Target->IsDefeated() || IsDefeated()
+		|| FVector::DistSquared(Target->GetActorLocation(), GetActorLocation()) > FMath::Square(LockOnBreakDistance))
+	{
+		SetLockOnTarget(nullptr);
+		return;
+	}
+
+	// the camera boom follows the control rotation
+	if (Controller && IsLocallyControlled())
+	{
+		const FRotator ControlRotation = Controller->GetControlRotation();
+		const FRotator TargetRotation(ControlRotation.Pitch, (Target->GetActorLocation() - GetActorLocation()).Rotation().Yaw, ControlRotation.Roll);
+		Controller->SetControlRotation(FMath::RInterpTo(ControlRotation, TargetRotation, DeltaSeconds, LockOnCameraSpeed));
+	}
+}
+
+void AActionGameCharacter::ReplicateAttack(const FAttackEvent& Event)
+{
+	ReplicatedAttack = Event;
+	if (GetNetMode() != NM_Standalone && HasCombatant())
+	{
+		CombatManager->RecordAttackEventSent();
+	}
+}
+
+bool AActionGameCharacter::ServerAttack_Validate(const FAttackEvent& Event)
+{
+	return Event.AttackType < static_cast<uint8>(EAttackType::MAX);
+}
+
+void AActionGameCharacter::ServerAttack_Implementation(const FAttackEvent& Event)
+{
+	const float ServerTime = GetServerWorldTime();
+	if (HasCombatant())
+	{
+		CombatManager->RecordAttackEventReceived(FMath::Max(ServerTime - Event.GetStartTime(ServerTime), 0.f));
+	}
+
+	// the combo table is the server's as well, a client cannot cancel what its attack does not allow
+	if (!HasCombatant() || !CombatManager->ValidateAttack(CombatantId, Event.GetAttackType(), Event.SectionIndex))
+	{
+		AG_LOG(Combat, DEBUG, "Attack {} of {} breaks the combo table", Event.GetAttackType(), GetFName());
+		ClientRejectAttack(Event.Counter);
+		return;
+	}
+
+	if (!PlayAttack(Event, 0.f, false))
+	{
+		ClientRejectAttack(Event.Counter);
+		return;
+	}
+
+	// other clients time the attack from when the server started it
+	FAttackEvent AcceptedEvent = Event;
+	AcceptedEvent.SetStartTime(ServerTime);
+	ReplicateAttack(AcceptedEvent);
+}
+
+void AActionGameCharacter::ClientRejectAttack_Implementation(uint8 Counter)
+{
+	AG_LOG(Combat, WARNING, "Attack {} rejected by the server", Counter);
+
+	// a later attack has replaced the predicted one already
+	if (Counter != AttackCounter || !HasCombatant())
+	{
+		return;
+	}
+
+	if (const FCompiledAttack* ActiveAttack = GetActiveAttack())
+	{
+		StopAnimMontage(ActiveAttack->Montage);
+	}
+	CombatManager->StopAttack(CombatantId);
+	GetCombatMovement()->StopLunge();
+}
+
+void AActionGameCharacter::OnRep_ReplicatedAttack()
+{
+	const float ServerTime = GetServerWorldTime();
+	const float Latency = FMath::Max(ServerTime - ReplicatedAttack.GetStartTime(ServerTime), 0.f);
+	if (HasCombatant())
+	{
+		CombatManager->RecordAttackEventReceived(Latency);
+	}
+
+	// the server has accepted the attack, cooldowns here may lag behind it
+	PlayAttack(ReplicatedAttack, FMath::Min(Latency, MaxAttackCatchUpSeconds), true);
+}
+
+float AActionGameCharacter::GetServerWorldTime() const
+{
+	const AGameStateBase* GameState = GetWorld()->GetGameState();
+	return GameState ? GameState->GetServerWorldTimeSeconds() : GetWorld()->GetTimeSeconds();
+}
+
+void AActionGameCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	// the owning client has predicted its own attacks
+	DOREPLIFETIME_CONDITION(AActionGameCharacter, ReplicatedAttack, COND_SkipOwner);
+	DOREPLIFETIME(AActionGameCharacter, bPooled);
+	DOREPLIFETIME(AActionGameCharacter, Health);
+	DOREPLIFETIME(AActionGameCharacter, Team);
+}
+
 void AActionGameCharacter::AttackNotifyStart()
 {
-	Log(ELogLevel::INFO, __FUNCTION__);
+	SCOPE_CYCLE_COUNTER(STAT_AttackNotifyStart);
+	AG_LOG(Combat, TRACE, "{}", __FUNCTION__);
 
-	LeftCollisionBox->SetCollisionProfileName(MeleeCollisionProfile.Enabled);
-	LeftCollisionBox->SetNotifyRigidBodyCollision(true);
-	//LeftCollisionBox->SetGenerateOverlapEvents(true);
+	if (!HasCombatant())
+	{
+		return;
+	}
+
+	FCombatLatencyTracer::MarkStage(this, ECombatLatencyStage::FirstActiveFrame);
 
-	RightCollisionBox->SetCollisionProfileName(MeleeCollisionProfile.Enabled);
-	RightCollisionBox->SetNotifyRigidBodyCollision(true);
-	//RightCollisionBox->SetGenerateOverlapEvents(true);
+	CombatManager->OpenAttackWindow(CombatantId);
+
+	// limbs are swept by the combat manager, ranged attacks hit with their projectile
+	const FCompiledAttack* ActiveAttack = GetActiveAttack();
+	if (MeleeHitDetection == EMeleeHitDetection::SWEEP || (ActiveAttack && ActiveAttack->IsRanged()))
+	{
+		return;
+	}
+
+	const FName EnabledProfileName = ActiveAttack ? ActiveAttack->EnabledProfileName : MeleeCollisionProfile.Enabled;
+
+	// only the limbs the section strikes with collide, hits outside their time window are dropped on arrival
+	const uint8 LimbMask = CombatManager->GetSectionLimbMask(CombatantId);
+	for (int32 Limb = 0; Limb < LimbBoxes.Num(); ++Limb)
+	{
+		if (LimbMask & (1 << Limb))
+		{
+			LimbBoxes[Limb]->SetCollisionProfileName(EnabledProfileName);
+			LimbBoxes[Limb]->SetNotifyRigidBodyCollision(true);
+		}
+	}
 }
 
 void AActionGameCharacter::AttackNotifyEnd()
 {
-	Log(ELogLevel::INFO, __FUNCTION__);
+	SCOPE_CYCLE_COUNTER(STAT_AttackNotifyEnd);
+	AG_LOG(Combat, TRACE, "{}", __FUNCTION__);
 
-	LeftCollisionBox->SetCollisionProfileName(MeleeCollisionProfile.Disabled);
-	LeftCollisionBox->SetNotifyRigidBodyCollision(false);
-	//LeftCollisionBox->SetGenerateOverlapEvents(false);
+	if (!HasCombatant())
+	{
+		return;
+	}
 
-	RightCollisionBox->SetCollisionProfileName(MeleeCollisionProfile.Disabled);
-	RightCollisionBox->SetNotifyRigidBodyCollision(false);
-	//RightCollisionBox->SetGenerateOverlapEvents(false);
+	CombatManager->CloseAttackWindow(CombatantId);
+
+	if (MeleeHitDetection == EMeleeHitDetection::SWEEP)
+	{
+		return;
+	}
+
+	const FCompiledAttack* ActiveAttack = GetActiveAttack();
+	const FName DisabledProfileName = ActiveAttack ? ActiveAttack->DisabledProfileName : MeleeCollisionProfile.Disabled;
+
+	for (UBoxComponent* LimbBox : LimbBoxes)
+	{
+		LimbBox->SetCollisionProfileName(DisabledProfileName);
+		LimbBox->SetNotifyRigidBodyCollision(false);
+	}
 }
 
 
 void AActionGameCharacter::OnAttackHit(UPrimitiveComponent* HitComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit)
 {
-	Log(ELogLevel::WARNING, __FUNCTION__);
-	Log(ELogLevel::INFO, Hit.Actor->GetName());
-	if (PunchAudioComponent != NULL && !PunchAudioComponent->IsPlaying())
+	SCOPE_CYCLE_COUNTER(STAT_OnAttackHit);
+	AG_LOG(Combat, DEBUG, "{} {}", __FUNCTION__, OtherActor ? OtherActor->GetFName() : NAME_None);
+
+	// the server waits for the owning client's claim
+	if (!HasCombatant() || (Role == ROLE_Authority && IsPlayerControlled() && !IsLocallyControlled()))
+	{
+		return;
+	}
+
+	const int32 Limb = LimbBoxes.IndexOfByKey(HitComponent);
+	if (Limb == INDEX_NONE || !CombatManager->IsLimbActive(CombatantId, Limb))
+	{
+		return;
+	}
+
+	// the same swing may hit several times, the combat manager keeps the first
+	CombatManager->QueueHit(CombatantId, Limb, OtherActor, HitComponent->GetComponentLocation());
+}
+
+void AActionGameCharacter::LandHit(int32 Limb, AActor* Victim, const FVector& Location)
+{
+	// owning clients claim their limb hits, the server checks them against where the victim was, projectiles hit on the server
+	if (Role == ROLE_AutonomousProxy && Limb != ACombatManager::ProjectileLimb)
+	{
+		ServerClaimHit(Victim, static_cast<uint8>(Limb), FAttackEvent::WrapTime(GetServerWorldTime()));
+	}
+
+	FCombatLatencyTracer::MarkStage(this, ECombatLatencyStage::Hit);
+
+	if (HasCombatant() && Role == ROLE_Authority)
+	{
+		CombatManager->RecordHit();
+	}
+	if (CombatAudio.IsValid() && ACombatSignificanceManager::GetTier(Significance).bAudible)
 	{
 		// default pitch value 1.0f
-		PunchAudioComponent->SetPitchMultiplier(FMath::RandRange(1.f, 1.3f));
-		PunchAudioComponent->Play(0.f);
+		CombatAudio->PlaySound(AttackPunchSoundCue.Get(), Location, ECombatSound::PUNCH_IMPACT, FMath::RandRange(1.f, 1.3f));
+	}
+}
+
+float AActionGameCharacter::TakeDamage(float DamageAmount, FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser)
+{
+	const float Damage = Super::TakeDamage(DamageAmount, DamageEvent, EventInstigator, DamageCauser);
+	if (Role != ROLE_Authority || Damage <= 0.f || IsDefeated())
+	{
+		return 0.f;
+	}
+
+	Health = FMath::Max(Health - Damage, 0.f);
+	if (IsDefeated())
+	{
+		AG_LOG(Combat, INFO, "{} defeated by {}", GetFName(), DamageCauser ? DamageCauser->GetFName() : NAME_None);
+
+		// an attack in flight ends with the fight
+		if (HasCombatant())
+		{
+			CombatManager->StopAttack(CombatantId);
+		}
+		GetCombatMovement()->StopLunge();
+	}
+	return Damage;
+}
+
+bool AActionGameCharacter::ServerClaimHit_Validate(AActor* Victim, uint8 Limb, uint16 ClientTime)
+{
+	return Limb < ACombatManager::MaxLimbsPerCombatant;
+}
+
+void AActionGameCharacter::ServerClaimHit_Implementation(AActor* Victim, uint8 Limb, uint16 ClientTime)
+{
+	if (!HasCombatant())
+	{
+		return;
 	}
 
-	UAnimInstance * AnimInstance = GetMesh()->GetAnimInstance();
-	if (AnimInstance)
+	// the client stamps claims with its estimate of server time, which lags by about the
+	// time the replicated positions it hit took to arrive, so it is the time to rewind to,
+	// an accepted claim is resolved with the rest of the frame's hits
+	const float ServerTime = FAttackEvent::UnwrapTime(ClientTime, GetServerWorldTime());
+	CombatManager->ValidateMeleeHit(CombatantId, Limb, Victim, ServerTime);
+}
+
+void AActionGameCharacter::PossessedBy(AController* NewController)
+{
+	Super::PossessedBy(NewController);
+
+	const ACombatAIController* AIController = Cast<ACombatAIController>(NewController);
+	Team = AIController ? AIController->Team : 0;
+
+	UpdateClaimedHits();
+}
+
+void AActionGameCharacter::UnPossessed()
+{
+	Super::UnPossessed();
+
+	UpdateClaimedHits();
+}
+
+void AActionGameCharacter::UpdateClaimedHits()
+{
+	// remote players report their own hits, the server does not sweep for them
+	if (HasCombatant() && Role == ROLE_Authority)
 	{
-		// not perfect.
-		//AnimInstance->Montage_Stop(AnimationVar, AttackMontage->Montage);
+		CombatManager->SetHitsClaimedByClient(CombatantId, IsPlayerControlled() && !IsLocallyControlled());
+	}
+}
 
-		//AnimInstance->Montage_Pause(AttackMontage->Montage);
-		//AnimInstance->Montage_Resume(AttackMontage->Montage);
+bool AActionGameCharacter::HasAttackTimeline() const
+{
+	return HasCombatant() && CombatManager->IsTimelineDriven(CombatantId);
+}
 
-		float currentPosition = AnimInstance->Montage_GetPosition(AttackMontage->Montage);
-		AnimInstance->Montage_Play(AttackMontage->Montage, AnimationVar, EMontagePlayReturnType::Duration, currentPosition, true);
+void AActionGameCharacter::PlayPunchThrowSound()
+{
+	// insignificant characters leave their voices to the ones the player can see
+	if (CombatAudio.IsValid() && ACombatSignificanceManager::GetTier(Significance).bAudible)
+	{
+		CombatAudio->PlaySound(PunchThrowSoundCue.Get(), GetActorLocation(), ECombatSound::PUNCH_THROW);
 	}
 }
 
 void AActionGameCharacter::OnAttackOverlapBegin(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
 {
-	Log(ELogLevel::WARNING, __FUNCTION__);
+	AG_LOG(Combat, WARNING, "{}", __FUNCTION__);
 }
 
 void AActionGameCharacter::OnAttackOverlapEnd(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex)
 {
-	Log(ELogLevel::WARNING, __FUNCTION__);
+	AG_LOG(Combat, WARNING, "{}", __FUNCTION__);
 }
 
 void AActionGameCharacter::OnResetVR()
@@ -307,29 +986,48 @@ void AActionGameCharacter::OnResetVR()
 
 void AActionGameCharacter::TouchStarted(ETouchIndex::Type FingerIndex, FVector Location)
 {
-		Jump();
+		JumpInput();
 }
 
 void AActionGameCharacter::TouchStopped(ETouchIndex::Type FingerIndex, FVector Location)
 {
-		StopJumping();
+		StopJumpingInput();
+}
+
+void AActionGameCharacter::Turn(float Value)
+{
+	InputFrame.Axes[FCombatInputFrame::AXIS_Turn] = Value;
+	AddControllerYawInput(Value);
+}
+
+void AActionGameCharacter::LookUp(float Value)
+{
+	InputFrame.Axes[FCombatInputFrame::AXIS_LookUp] = Value;
+	AddControllerPitchInput(Value);
 }
 
 void AActionGameCharacter::TurnAtRate(float Rate)
 {
+	InputFrame.Axes[FCombatInputFrame::AXIS_TurnRate] = Rate;
+
 	// calculate delta for this frame from the rate information
 	AddControllerYawInput(Rate * BaseTurnRate * GetWorld()->GetDeltaSeconds());
 }
 
 void AActionGameCharacter::LookUpAtRate(float Rate)
 {
+	InputFrame.Axes[FCombatInputFrame::AXIS_LookUpRate] = Rate;
+
 	// calculate delta for this frame from the rate information
 	AddControllerPitchInput(Rate * BaseLookUpRate * GetWorld()->GetDeltaSeconds());
 }
 
 void AActionGameCharacter::MoveForward(float Value)
 {
-	if ((Controller != NULL) && (Value != 0.0f) && IsKeyboardEnabled)
+	InputFrame.Axes[FCombatInputFrame::AXIS_MoveForward] = Value;
+
+	// attacks rooting the character drop the input in the movement component, where it is predicted
+	if ((Controller != NULL) && (Value != 0.0f))
 	{
 		// find out which way is forward
 		const FRotator Rotation = Controller->GetControlRotation();
@@ -343,7 +1041,9 @@ void AActionGameCharacter::MoveForward(float Value)
 
 void AActionGameCharacter::MoveRight(float Value)
 {
-	if ( (Controller != NULL) && (Value != 0.0f) && IsKeyboardEnabled)
+	InputFrame.Axes[FCombatInputFrame::AXIS_MoveRight] = Value;
+
+	if ( (Controller != NULL) && (Value != 0.0f))
 	{
 		// find out which way is right
 		const FRotator Rotation = Controller->GetControlRotation();
@@ -356,69 +1056,3 @@ void AActionGameCharacter::MoveRight(float Value)
 	}
 }
 
-
-//========= LOG ON SCREEN =========//
-void AActionGameCharacter::Log(ELogLevel LogLevel, FString Message)
-{
-	Log(LogLevel, Message, ELogOutput::ALL);
-}
-
-void AActionGameCharacter::Log(ELogLevel LogLevel, FString Message, ELogOutput LogOutput)
-{
-	// only print when screen is selected and the GEngine is availiable
-	if ((LogOutput == ELogOutput::ALL || LogOutput == ELogOutput::SCREEN) && GEngine)
-	{
-		// default color
-		FColor LogColor = FColor::Cyan;
-		// change color based on the type
-		switch (LogLevel)
-		{
-		case ELogLevel::TRACE:
-			LogColor = FColor::Green;
-			break;
-		case ELogLevel::DEBUG:
-			LogColor = FColor::Cyan;
-			break;
-		case ELogLevel::INFO:
-			LogColor = FColor::White;
-			break;
-		case ELogLevel::WARNING:
-			LogColor = FColor::Yellow;
-			break;
-		case ELogLevel::ERROR:
-			LogColor = FColor::Red;
-			break;
-		default:
-			break;
-		}
-
-		// print message on the screen for duration time
-		GEngine->AddOnScreenDebugMessage(-1, 3.0f, LogColor, Message);
-	}
-	if (LogOutput == ELogOutput::ALL || LogOutput == ELogOutput::SCREEN)
-	{
-		switch (LogLevel)
-		{
-		case ELogLevel::TRACE:
-			UE_LOG(LogTemp, VeryVerbose, TEXT("%s"), *Message);
-			break;
-		case ELogLevel::DEBUG:
-			UE_LOG(LogTemp, Verbose, TEXT("%s"), *Message);
-			break;
-		case ELogLevel::INFO:
-			UE_LOG(LogTemp, Log, TEXT("%s"), *Message);
-			break;
-		case ELogLevel::WARNING:
-			UE_LOG(LogTemp, Warning, TEXT("%s"), *Message);
-			break;
-		case ELogLevel::ERROR:
-			UE_LOG(LogTemp, Error, TEXT("%s"), *Message);
-			break;
-		default:
-			UE_LOG(LogTemp, Log, TEXT("%s"), *Message);
-			break;
-		}
-	}
-}
-
-
@@ -6,99 +6,43 @@
 #include "GameFramework/Character.h"
 
 #include "Components/BoxComponent.h"
-#include "Components/AudioComponent.h"
 #include "Engine/DataTable.h"
 
-#include "ActionGameCharacter.generated.h"
-
-
-USTRUCT(BlueprintType)
-struct FPlayAttackMontage : public FTableRowBase 
-{
-	GENERATED_BODY()
-
-	/** Animation Montage **/
-	UPROPERTY(EditAnywhere, BlueprintReadOnly)
-	UAnimMontage* Montage;
-
-	/** Montage Section Cound **/
-	UPROPERTY(EditAnywhere, BlueprintReadOnly)
-	int32 AnimationSectionCount;
-
-	/** Discription **/
-	UPROPERTY(EditAnywhere, BlueprintReadOnly)
-	FString Description;
-};
-
-
-USTRUCT(BlueprintType)
-struct FMeleeCollisionProfile
-{
-	GENERATED_BODY()
-
-	UPROPERTY(EditAnywhere, BlueprintReadWrite)
-	FName Enabled;
-
-	UPROPERTY(EditAnywhere, BlueprintReadWrite)
-	FName Disabled;
-
-	// default constructor
-	FMeleeCollisionProfile()
-	{
-		Enabled = FName(TEXT("Weapon"));
-		Disabled = FName(TEXT("NoCollision"));
-	}
-};
-
+#include "AttackCatalogue.h"
+#include "CombatMoveSet.h"
+#include "ActionGameLog.h"
+#include "CombatManager.h"
+#include "CombatMovementComponent.h"
+#include "CombatInputRecorder.h"
+#include "CombatSignificanceManager.h"
+#include "AttackEvent.h"
 
-UENUM(BlueprintType)
-enum class ELogLevel : uint8 {
-	TRACE		UMETA(DisplayName = "Trace"),
-	DEBUG		UMETA(DisplayName = "Debug"),
-	INFO		UMETA(DisplayName = "Info"),
-	WARNING		UMETA(DisplayName = "Warning"),
-	ERROR		UMETA(DisplayName = "Error")
-};
-
-UENUM(BlueprintType)
-enum class ELogOutput : uint8 {
-	ALL			UMETA(DisplayName = "All levels"),
-	OUTPUT_LOG	UMETA(DisplayName = "Output log"),
-	SCREEN		UMETA(DisplayName = "Screen")
-};
+#include "ActionGameCharacter.generated.h"
 
-UENUM(BlueprintType)
-enum class EAttackType: uint8 {
-	MELEE_FIST	UMETA(DisplayName = "Melee - Fist"),
-	MELEE_KICK  UMETA(DisplayName = "Melee - Kick")
-};
 
 UCLASS(config=Game)
 class AActionGameCharacter : public ACharacter
 {
 	GENERATED_BODY()
 
-	/** Camera boom positioning the camera behind the character */
+	/** Camera boom positioning the camera behind the character, destroyed as the character is initialized without presentation */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Camera, meta = (AllowPrivateAccess = "true"))
 	class USpringArmComponent* CameraBoom;
 
-	/** Follow camera */
+	/** Follow camera, destroyed as the character is initialized without presentation */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Camera, meta = (AllowPrivateAccess = "true"))
 	class UCameraComponent* FollowCamera;
 
 
-	/** Melee fist attack montage **/
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Animation, meta = (AllowPrivateAccess = "true"))
-	class UAnimMontage* MeleeFistAttackMontage;
-
+	/** Attack table, its rows point to the montages streamed in with it **/
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Animation, meta = (AllowPrivateAccess = "true"))
-	class UDataTable* MeleeAttackDataTable;
+	TSoftObjectPtr<class UDataTable> MeleeAttackDataTable;
 
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Audio, meta = (AllowPrivateAccess = "true"))
-	class USoundCue* AttackPunchSoundCue;
+	TSoftObjectPtr<class USoundCue> AttackPunchSoundCue;
 
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Audio, meta = (AllowPrivateAccess = "true"))
-	class USoundCue* PunchThrowSoundCue;
+	TSoftObjectPtr<class USoundCue> PunchThrowSoundCue;
 
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Collision, meta = (AllowPrivateAccess = "true"))
 	class UBoxComponent* LeftCollisionBox;
@@ -106,14 +50,97 @@ class AActionGameCharacter : public ACharacter
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Collision, meta = (AllowPrivateAccess = "true"))
 	class UBoxComponent* RightCollisionBox;
 
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Animation, meta = (AllowPrivateAccess = "true"))
-	float AnimationVar;
+	/** How melee hits are found while an attack window is open **/
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Collision, meta = (AllowPrivateAccess = "true"))
+	EMeleeHitDetection MeleeHitDetection;
+
+	/** Longest delay a replicated attack is fast forwarded by on other clients **/
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Replication, meta = (AllowPrivateAccess = "true"))
+	float MaxAttackCatchUpSeconds;
+
+	/** Health the character starts with and is restored to when it leaves the pool **/
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Combat, meta = (AllowPrivateAccess = "true"))
+	float MaxHealth;
+
+	/** Health left, taken by resolved hits on the server **/
+	UPROPERTY(Replicated, VisibleInstanceOnly, BlueprintReadOnly, Category = Combat, meta = (AllowPrivateAccess = "true"))
+	float Health;
+
+	/** Last attack the server accepted, replicated to everyone but its owner **/
+	UPROPERTY(ReplicatedUsing = OnRep_ReplicatedAttack)
+	FAttackEvent ReplicatedAttack;
+
+	/** Fighters of the same team never target each other, players are team 0. Taken from the possessing AI controller **/
+	UPROPERTY(Replicated, VisibleInstanceOnly, BlueprintReadOnly, Category = Combat, meta = (AllowPrivateAccess = "true"))
+	uint8 Team;
+
+	/** Distance and half angle in degrees off the camera direction a lock-on target is picked in **/
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Targeting, meta = (AllowPrivateAccess = "true"))
+	float LockOnRadius;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Targeting, meta = (AllowPrivateAccess = "true"))
+	float LockOnAngle;
+
+	/** Distance the lock breaks at **/
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Targeting, meta = (AllowPrivateAccess = "true"))
+	float LockOnBreakDistance;
+
+	/** Interpolation speed of the camera turning to the locked target **/
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Targeting, meta = (AllowPrivateAccess = "true"))
+	float LockOnCameraSpeed;
+
+	/** Distance and half angle in degrees off the move direction an attack without a lock turns to an enemy in **/
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Targeting, meta = (AllowPrivateAccess = "true"))
+	float SoftTargetRadius;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Targeting, meta = (AllowPrivateAccess = "true"))
+	float SoftTargetAngle;
 public:
-	AActionGameCharacter();
+	AActionGameCharacter(const FObjectInitializer& ObjectInitializer);
+
+	// called once the components are initialized, before the game starts
+	virtual void PostInitializeComponents() override;
 
 	// called when the game starts or when the player spawned
 	virtual void BeginPlay() override;
 
+	// called when the character is destroyed or the level ends
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	// keeps the lock-on target and the camera on it
+	virtual void Tick(float DeltaSeconds) override;
+
+	/** Parks the character for reuse: its attack ends and it stops ticking, colliding and rendering **/
+	void DeactivateForPool();
+
+	/** Brings a parked character back at Transform, as fresh as a newly spawned one **/
+	void ActivateFromPool(const FTransform& Transform);
+
+	FORCEINLINE bool IsPooled() const { return bPooled; }
+
+	/** Takes damage from hits resolved by the combat manager, on the server **/
+	virtual float TakeDamage(float DamageAmount, struct FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser) override;
+
+	FORCEINLINE float GetHealth() const { return Health; }
+
+	/** Out of health, the character no longer attacks **/
+	FORCEINLINE bool IsDefeated() const { return Health <= 0.f; }
+
+	FORCEINLINE uint8 GetTeam() const { return Team; }
+
+	/** Locks on to Target, nullptr releases. Locked, the character faces the target and the camera turns to it **/
+	void SetLockOnTarget(AActionGameCharacter* Target);
+
+	FORCEINLINE AActionGameCharacter* GetLockOnTarget() const { return LockOnTarget.Get(); }
+
+	/** Applies the tick rates, collision detail and audio of Tier, set by the significance manager **/
+	void SetSignificance(ECombatSignificance Tier);
+
+	FORCEINLINE ECombatSignificance GetSignificance() const { return Significance; }
+
+	/** Returns the combat content of this character's class, streaming it when nothing holds it yet. Works on the class default object **/
+	TSharedRef<FCombatMoveSet> RequestMoveSet() const;
+
 	/** Base turn rate, in deg/sec. Other scaling may affect final turn rate. */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category=Camera)
 	float BaseTurnRate;
@@ -130,6 +157,12 @@ public:
 	/** Call for Punch input */
 	void AttackInput(EAttackType type);
 
+	/** Starts an attack the input buffer let through, in Section or a random one when INDEX_NONE **/
+	void ExecuteAttack(EAttackType Type, int32 Section);
+
+	/** Locks on to the best enemy in front of the camera, or releases the lock **/
+	void LockOnInput();
+
 	UFUNCTION(BlueprintCallable, Category = Animation)
 	bool GetIsAnimationBlended();
 
@@ -139,6 +172,17 @@ public:
 
 	UFUNCTION(BlueprintCallable, Category = Animation)
 	EAttackType GetCurrentAttackType();
+
+	/** Input handled since the last reset, read by the input recorder **/
+	FORCEINLINE const FCombatInputFrame& GetInputFrame() const { return InputFrame; }
+	FORCEINLINE void ResetInputFrame() { InputFrame.Reset(); }
+
+	/** Runs a recorded frame through the same handlers as live input **/
+	void ReplayInputFrame(const FCombatInputFrame& Frame);
+
+	/** Reseeds the stream attack sections are picked from **/
+	void SetAttackRandomSeed(int32 Seed);
+	FORCEINLINE int32 GetAttackRandomSeed() const { return AttackRandom.GetInitialSeed(); }
 protected:
 
 	/** Resets HMD orientation in VR. */
@@ -150,6 +194,14 @@ protected:
 	/** Called for side to side input */
 	void MoveRight(float Value);
 
+	/** Called for absolute turn and look up input, such as a mouse */
+	void Turn(float Value);
+	void LookUp(float Value);
+
+	/** Called for jump input */
+	void JumpInput();
+	void StopJumpingInput();
+
 
 	/** 
 	 * Called via input to turn at a given rate. 
@@ -180,7 +232,14 @@ public:
 	/** Returns FollowCamera subobject **/
 	FORCEINLINE class UCameraComponent* GetFollowCamera() const { return FollowCamera; }
 
-	UAudioComponent* PunchThrowAudioComponent;
+	/** Whether Component only shows the character and is left out without presentation **/
+	bool IsPresentationComponent(const UActorComponent* Component) const;
+
+	/** Plays the punch whoosh through the combat voice pool **/
+	void PlayPunchThrowSound();
+
+	/** Whether the combat manager times the current attack's window and sounds, its notifies are skipped then **/
+	bool HasAttackTimeline() const;
 
 	/** Notifiy start**/
 	UFUNCTION()
@@ -190,6 +249,47 @@ public:
 	UFUNCTION()
 	void AttackNotifyEnd();
 	
+	/** Asks the server to run an attack the owning client has already started **/
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerAttack(const FAttackEvent& Event);
+
+	/** Reports a hit found by the owning client, checked by the server against rewound positions **/
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerClaimHit(AActor* Victim, uint8 Limb, uint16 ClientTime);
+
+	/** Gives the server the owning client's lock-on, the server turns the character the same way **/
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerSetLockOnTarget(AActionGameCharacter* Target);
+
+	/** Tells the owning client its predicted attack was refused **/
+	UFUNCTION(Client, Reliable)
+	void ClientRejectAttack(uint8 Counter);
+
+	UFUNCTION()
+	void OnRep_ReplicatedAttack();
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	virtual void PossessedBy(AController* NewController) override;
+	virtual void UnPossessed() override;
+
+	/** Returns the movement component predicting attack locks and lunges **/
+	FORCEINLINE UCombatMovementComponent* GetCombatMovement() const { return CastChecked<UCombatMovementComponent>(GetCharacterMovement()); }
+
+	/** Whether input moves the character, false while an attack roots it **/
+	bool IsMovementEnabled() const;
+
+	/** Lunge speed of the current attack, 0 without one **/
+	float GetAttackLungeSpeed() const;
+
+	/** Id of this character's state in the combat manager, INDEX_NONE before BeginPlay **/
+	FORCEINLINE int32 GetCombatantId() const { return CombatantId; }
+
+	/**
+	 * Reaction to a hit the combat manager has resolved: claims it from the server when the
+	 * hit was found by the owning client, counts it and plays the impact at Location.
+	 */
+	void LandHit(int32 Limb, AActor* Victim, const FVector& Location);
+
 	// triggered when the collision hit event fires between enemy
 	UFUNCTION()
 	void OnAttackHit(UPrimitiveComponent* HitComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit);
@@ -202,21 +302,77 @@ public:
 	UFUNCTION()
 	void OnAttackOverlapEnd(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex);
 private:
-	UAudioComponent* PunchAudioComponent;
-	
-	FPlayAttackMontage* AttackMontage;
+	/** combat content of this character's class, kept resident while the character plays **/
+	TSharedPtr<FCombatMoveSet> MoveSet;
+
+	/** compiled attacks shared by every character using MeleeAttackDataTable, invalid until the move set is loaded **/
+	TSharedPtr<const FAttackCatalogue> AttackCatalogue;
+
+	void OnMoveSetLoaded();
 
 	FMeleeCollisionProfile MeleeCollisionProfile;
 
-	EAttackType CurrentAttack;
+	/** combat manager holding this character's attack state **/
+	TWeakObjectPtr<ACombatManager> CombatManager;
+
+	/** voice pool playing this character's sounds **/
+	TWeakObjectPtr<class ACombatAudioManager> CombatAudio;
+
+	/** limb boxes in limb order (left, right), the order attack rows and the combat manager number limbs in **/
+	TArray<UBoxComponent*, TInlineAllocator<ACombatManager::MaxLimbsPerCombatant>> LimbBoxes;
+
+	/** id of this character's state in CombatManager, INDEX_NONE until BeginPlay **/
+	int32 CombatantId;
+
+	/** significance tier applied last, HIGH until the significance manager ranks the character **/
+	ECombatSignificance Significance;
+
+	/** enemy locked on to, bLockedOn stays set until the lock is released even when the target is gone **/
+	TWeakObjectPtr<AActionGameCharacter> LockOnTarget;
+	bool bLockedOn;
+
+	/** Releases a lock whose target is out of the fight or out of range, turns the camera to it otherwise **/
+	void UpdateLockOn(float DeltaSeconds);
+
+	/** Turns the character to the locked target, or to the soft target ahead of it, for the attack it starts **/
+	void FaceAttackTarget();
+
+	/** without presentation, whether the mesh poses its bones for the attack in flight or ticks its montages alone **/
+	bool bHitPoseRequired;
+	void SetHitPoseRequired(bool bRequired);
+
+	/** counter of the last attack started here, matched against server rejections **/
+	uint8 AttackCounter;
+
+	/** parked in the game mode's character pool, clients park their copy with it **/
+	UPROPERTY(ReplicatedUsing = OnRep_Pooled)
+	bool bPooled;
+
+	UFUNCTION()
+	void OnRep_Pooled();
+
+	void RegisterCombatant();
+	void UnregisterCombatant();
+
+	/** Starts the attack described by Event, StartOffset seconds into its section **/
+	bool PlayAttack(const FAttackEvent& Event, float StartOffset, bool bIgnoreCooldown);
+
+	void ReplicateAttack(const FAttackEvent& Event);
+
+	void UpdateClaimedHits();
+
+	/** the server's world time as known here **/
+	float GetServerWorldTime() const;
+
+	/** picks attack sections, seeded so recorded fights replay the same way **/
+	FRandomStream AttackRandom;
 
-	bool IsAnimationBlended;
+	/** input handled this frame **/
+	FCombatInputFrame InputFrame;
 
-	bool IsKeyboardEnabled;
-	/** Log - prints message to log outputs **/
-	void Log(ELogLevel LogLevel, FString Message);
+	bool HasCombatant() const;
 
-	/** Log - prints message on the screen **/
-	void Log(ELogLevel LogLevel, FString Message, ELogOutput LogOutput);
+	/** attack currently playing, points into AttackCatalogue **/
+	const FCompiledAttack* GetActiveAttack() const;
 };
 
@@ -2,14 +2,207 @@
 
 #include "ActionGameGameMode.h"
 #include "ActionGameCharacter.h"
+#include "ActionGameLog.h"
+#include "CombatBenchmark.h"
+#include "CombatMemoryReport.h"
+#include "CombatLatencyTracer.h"
+#include "ActionGameGameState.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "Misc/CommandLine.h"
 #include "UObject/ConstructorHelpers.h"
 
+DECLARE_CYCLE_STAT(TEXT("Character spawn"), STAT_CharacterSpawn, STATGROUP_ActionGameCombat);
+DECLARE_CYCLE_STAT(TEXT("Character pool acquire"), STAT_CharacterPoolAcquire, STATGROUP_ActionGameCombat);
+DECLARE_CYCLE_STAT(TEXT("Character pool release"), STAT_CharacterPoolRelease, STATGROUP_ActionGameCombat);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pooled characters"), STAT_PooledCharacters, STATGROUP_ActionGameCombat);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pool hits"), STAT_PoolHits, STATGROUP_ActionGameCombat);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pool misses"), STAT_PoolMisses, STATGROUP_ActionGameCombat);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Pool hit rate (%)"), STAT_PoolHitRate, STATGROUP_ActionGameCombat);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Pool acquire avg (ms)"), STAT_PoolAcquireAverage, STATGROUP_ActionGameCombat);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Character spawn avg (ms)"), STAT_CharacterSpawnAverage, STATGROUP_ActionGameCombat);
+
 AActionGameGameMode::AActionGameGameMode()
 {
-	// set default pawn class to our Blueprinted character
+	// set default pawn class to our Blueprinted character, its combat content is streamed in when a game starts
 	static ConstructorHelpers::FClassFinder<APawn> PlayerPawnBPClass(TEXT("/Game/ThirdPersonCPP/Blueprints/ThirdPersonCharacter"));
 	if (PlayerPawnBPClass.Class != NULL)
 	{
 		DefaultPawnClass = PlayerPawnBPClass.Class;
 	}
+
+	GameStateClass = AActionGameGameState::StaticClass();
+
+	CharacterPoolPrewarm = 8;
+	MaxPooledCharacters = 256;
+
+	PoolHits = 0;
+	PoolMisses = 0;
+	PoolAcquireSeconds = 0.0;
+	SpawnSeconds = 0.0;
+}
+
+void AActionGameGameMode::InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage)
+{
+	Super::InitGame(MapName, Options, ErrorMessage);
+
+	// stream the default pawn's moves before anyone can attack with them
+	if (DefaultPawnClass && DefaultPawnClass->IsChildOf(AActionGameCharacter::StaticClass()))
+	{
+		DefaultMoveSet = DefaultPawnClass->GetDefaultObject<AActionGameCharacter>()->RequestMoveSet();
+	}
+}
+
+void AActionGameGameMode::StartPlay()
+{
+	Super::StartPlay();
+
+	// fighters spawned in waves come out of the pool instead of being constructed mid fight
+	FParse::Value(FCommandLine::Get(), TEXT("CharacterPool="), CharacterPoolPrewarm);
+	if (DefaultPawnClass && DefaultPawnClass->IsChildOf(AActionGameCharacter::StaticClass()))
+	{
+		PrewarmCharacters(*DefaultPawnClass, CharacterPoolPrewarm);
+	}
+
+	// -CombatBenchmark runs the headless combat benchmark on the default map
+	if (FParse::Param(FCommandLine::Get(), TEXT("CombatBenchmark")))
+	{
+		ACombatBenchmark::Start(GetWorld(), FCommandLine::Get());
+	}
+
+	// -CombatMemoryReport measures one character against its memory budget
+	if (FParse::Param(FCommandLine::Get(), TEXT("CombatMemoryReport")))
+	{
+		ACombatMemoryReport::Start(GetWorld(), FCommandLine::Get());
+	}
+}
+
+void AActionGameGameMode::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (PoolHits + PoolMisses > 0)
+	{
+		AG_LOG(Combat, INFO, "Character pool: {} hits, {} misses, acquire {} ms, spawn {} ms on average", PoolHits, PoolMisses,
+			PoolHits > 0 ? PoolAcquireSeconds * 1000.0 / PoolHits : 0.0, PoolMisses > 0 ? SpawnSeconds * 1000.0 / PoolMisses : 0.0);
+	}
+
+	PooledCharacters.Reset();
+	DefaultMoveSet.Reset();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+
+//========= CHARACTER POOL =========//
+
+AActionGameCharacter* AActionGameGameMode::AcquireCharacter(TSubclassOf<AActionGameCharacter> Class, const FTransform& Transform)
+{
+	if (Class == nullptr)
+	{
+		return nullptr;
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+
+	// characters destroyed with the level or by someone else are skipped
+	PooledCharacters.RemoveAllSwap([](const AActionGameCharacter* Character) { return Character == nullptr || Character->IsPendingKill(); }, false);
+
+	const int32 Index = PooledCharacters.FindLastByPredicate([Class](const AActionGameCharacter* Character) { return Character->GetClass() == Class; });
+	if (Index != INDEX_NONE)
+	{
+		SCOPE_CYCLE_COUNTER(STAT_CharacterPoolAcquire);
+
+		AActionGameCharacter* Character = PooledCharacters[Index];
+		PooledCharacters.RemoveAtSwap(Index, 1, false);
+		Character->ActivateFromPool(Transform);
+
+		++PoolHits;
+		PoolAcquireSeconds += FPlatformTime::Seconds() - StartTime;
+		UpdatePoolStats();
+		return Character;
+	}
+
+	AActionGameCharacter* Character = nullptr;
+	{
+		SCOPE_CYCLE_COUNTER(STAT_CharacterSpawn);
+
+		FActorSpawnParameters SpawnParameters;
+		SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+		Character = GetWorld()->SpawnActor<AActionGameCharacter>(Class, Transform, SpawnParameters);
+	}
+
+	++PoolMisses;
+	SpawnSeconds += FPlatformTime::Seconds() - StartTime;
+	UpdatePoolStats();
+	return Character;
+}
+
+void AActionGameGameMode::ReleaseCharacter(AActionGameCharacter* Character)
+{
+	SCOPE_CYCLE_COUNTER(STAT_CharacterPoolRelease);
+
+	if (Character == nullptr || Character->IsPendingKill() || Character->IsPooled())
+	{
+		return;
+	}
+
+	// players keep their controller, AI controllers belong to the character
+	if (AController* Controller = Character->GetController())
+	{
+		Controller->UnPossess();
+		if (!Controller->IsA<APlayerController>())
+		{
+			Controller->Destroy();
+		}
+	}
+
+	if (PooledCharacters.Num() >= MaxPooledCharacters)
+	{
+		Character->Destroy();
+		return;
+	}
+
+	Character->DeactivateForPool();
+	PooledCharacters.Add(Character);
+	UpdatePoolStats();
+}
+
+void AActionGameGameMode::PrewarmCharacters(TSubclassOf<AActionGameCharacter> Class, int32 Count)
+{
+	if (Class == nullptr)
+	{
+		return;
+	}
+
+	int32 Waiting = 0;
+	for (const AActionGameCharacter* Character : PooledCharacters)
+	{
+		Waiting += (Character && Character->GetClass() == Class) ? 1 : 0;
+	}
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	// parked out of sight, they are moved into place when handed out
+	const FTransform ParkingTransform(FVector(0.f, 0.f, -100000.f));
+	for (; Waiting < FMath::Min(Count, MaxPooledCharacters); ++Waiting)
+	{
+		AActionGameCharacter* Character = GetWorld()->SpawnActor<AActionGameCharacter>(Class, ParkingTransform, SpawnParameters);
+		if (Character == nullptr)
+		{
+			break;
+		}
+		Character->DeactivateForPool();
+		PooledCharacters.Add(Character);
+	}
+	UpdatePoolStats();
+}
+
+void AActionGameGameMode::UpdatePoolStats() const
+{
+	SET_DWORD_STAT(STAT_PooledCharacters, PooledCharacters.Num());
+	SET_DWORD_STAT(STAT_PoolHits, PoolHits);
+	SET_DWORD_STAT(STAT_PoolMisses, PoolMisses);
+	SET_FLOAT_STAT(STAT_PoolHitRate, PoolHits + PoolMisses > 0 ? 100.f * PoolHits / (PoolHits + PoolMisses) : 0.f);
+	SET_FLOAT_STAT(STAT_PoolAcquireAverage, PoolHits > 0 ? static_cast<float>(PoolAcquireSeconds * 1000.0 / PoolHits) : 0.f);
+	SET_FLOAT_STAT(STAT_CharacterSpawnAverage, PoolMisses > 0 ? static_cast<float>(SpawnSeconds * 1000.0 / PoolMisses) : 0.f);
 }
@@ -4,8 +4,11 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/GameModeBase.h"
+#include "CombatMoveSet.h"
 #include "ActionGameGameMode.generated.h"
 
+class AActionGameCharacter;
+
 UCLASS(minimalapi)
 class AActionGameGameMode : public AGameModeBase
 {
@@ -13,6 +16,50 @@ class AActionGameGameMode : public AGameModeBase
 
 public:
 	AActionGameGameMode();
+
+	virtual void InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage) override;
+	virtual void StartPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	//========= CHARACTER POOL =========//
+
+	/** Hands out a character of Class at Transform, reusing a pooled one when there is one **/
+	AActionGameCharacter* AcquireCharacter(TSubclassOf<AActionGameCharacter> Class, const FTransform& Transform);
+
+	/** Takes Character back for reuse, its AI controller is destroyed. Destroys it when the pool is full **/
+	void ReleaseCharacter(AActionGameCharacter* Character);
+
+	/** Spawns pooled characters of Class until Count of them are waiting **/
+	void PrewarmCharacters(TSubclassOf<AActionGameCharacter> Class, int32 Count);
+
+	FORCEINLINE uint32 GetPoolHits() const { return PoolHits; }
+	FORCEINLINE uint32 GetPoolMisses() const { return PoolMisses; }
+
+protected:
+	/** Default pawn characters spawned into the pool when play starts (-CharacterPool=N overrides) **/
+	UPROPERTY(EditDefaultsOnly, Category = Pool)
+	int32 CharacterPoolPrewarm;
+
+	/** Characters kept waiting at most, released ones beyond it are destroyed **/
+	UPROPERTY(EditDefaultsOnly, Category = Pool)
+	int32 MaxPooledCharacters;
+
+private:
+	/** combat content of the default pawn, streamed in while the map loads and held for the match **/
+	TSharedPtr<FCombatMoveSet> DefaultMoveSet;
+
+	/** parked characters, hidden and inactive **/
+	UPROPERTY(Transient)
+	TArray<AActionGameCharacter*> PooledCharacters;
+
+	void UpdatePoolStats() const;
+
+	uint32 PoolHits;
+	uint32 PoolMisses;
+
+	/** time spent handing out characters, to compare reuse against spawning **/
+	double PoolAcquireSeconds;
+	double SpawnSeconds;
 };
 
 
@@ -0,0 +1,34 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "ActionGameGameState.h"
+#include "CombatInputRecorder.h"
+#include "CombatNetReport.h"
+#include "Misc/CommandLine.h"
+
+
+void AActionGameGameState::BeginPlay()
+{
+	Super::BeginPlay();
+
+	const TCHAR* CommandLine = FCommandLine::Get();
+	const bool bQuitWhenDone = !FParse::Param(CommandLine, TEXT("NoQuit"));
+
+	// -CombatRecord=<name> records the player's fight, -CombatReplay=<name> plays it back
+	FString RecordingName;
+	if (FParse::Value(CommandLine, TEXT("CombatRecord="), RecordingName))
+	{
+		ACombatInputRecorder::StartRecording(GetWorld(), RecordingName);
+	}
+	else if (FParse::Value(CommandLine, TEXT("CombatReplay="), RecordingName))
+	{
+		// a networked run ends with the net report, not the replay
+		ACombatInputRecorder::StartReplay(GetWorld(), RecordingName, bQuitWhenDone && !FParse::Param(CommandLine, TEXT("CombatNetReport")));
+	}
+
+	// -CombatNetReport=<seconds> reports bandwidth and attack event delays of this instance
+	float ReportSeconds = 0.f;
+	if (FParse::Value(CommandLine, TEXT("CombatNetReport="), ReportSeconds))
+	{
+		ACombatNetReport::Start(GetWorld(), ReportSeconds, bQuitWhenDone);
+	}
+}
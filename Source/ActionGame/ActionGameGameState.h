@@ -0,0 +1,20 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/GameStateBase.h"
+#include "ActionGameGameState.generated.h"
+
+/**
+ * Game state of ActionGame. Begins play on the server and on every client, so it
+ * starts the command line tools that have to run on clients too.
+ */
+UCLASS()
+class ACTIONGAME_API AActionGameGameState : public AGameStateBase
+{
+	GENERATED_BODY()
+
+public:
+	virtual void BeginPlay() override;
+};
@@ -0,0 +1,511 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "ActionGameLog.h"
+#include "ActionGame.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/FileManager.h"
+#include "HAL/Runnable.h"
+#include "HAL/RunnableThread.h"
+#include "HAL/Event.h"
+#include "Misc/CoreDelegates.h"
+#include "Misc/Paths.h"
+#include "Containers/Queue.h"
+#include "Templates/Atomic.h"
+
+#include "Engine.h"
+
+DEFINE_LOG_CATEGORY(LogActionGame);
+
+
+//========= ARGUMENT CAPTURE =========//
+
+FActionLogArg* FActionLogRecord::NextArg()
+{
+	// extra arguments are ignored, the placeholder prints as {}
+	return NumArgs < MaxArgs ? &Args[NumArgs++] : nullptr;
+}
+
+void FActionLogRecord::AddInt(int64 Value)
+{
+	if (FActionLogArg* Arg = NextArg())
+	{
+		Arg->Type = FActionLogArg::EType::Int;
+		Arg->Int = Value;
+	}
+}
+
+void FActionLogRecord::AddUInt(uint64 Value)
+{
+	if (FActionLogArg* Arg = NextArg())
+	{
+		Arg->Type = FActionLogArg::EType::UInt;
+		Arg->UInt = Value;
+	}
+}
+
+void FActionLogRecord::AddFloat(double Value)
+{
+	if (FActionLogArg* Arg = NextArg())
+	{
+		Arg->Type = FActionLogArg::EType::Float;
+		Arg->Float = Value;
+	}
+}
+
+void FActionLogRecord::AddArg(bool Value)
+{
+	if (FActionLogArg* Arg = NextArg())
+	{
+		Arg->Type = FActionLogArg::EType::Bool;
+		Arg->Bool = Value;
+	}
+}
+
+void FActionLogRecord::AddArg(const FName& Value)
+{
+	// names are resolved to text on the log thread
+	if (FActionLogArg* Arg = NextArg())
+	{
+		Arg->Type = FActionLogArg::EType::Name;
+		Arg->Name = Value;
+	}
+}
+
+void FActionLogRecord::AddString(const TCHAR* Value, int32 Length)
+{
+	if (FActionLogArg* Arg = NextArg())
+	{
+		// strings are copied (and truncated) into the record, nothing is allocated
+		const int32 CopyLength = FMath::Min(Length, MaxTextLength - TextLength);
+		FMemory::Memcpy(Text + TextLength, Value, CopyLength * sizeof(TCHAR));
+
+		Arg->Type = FActionLogArg::EType::String;
+		Arg->String.Offset = TextLength;
+		Arg->String.Length = CopyLength;
+		TextLength += CopyLength;
+	}
+}
+
+void FActionLogRecord::AddArg(const ANSICHAR* Value)
+{
+	if (FActionLogArg* Arg = NextArg())
+	{
+		const int32 CopyLength = FMath::Min(FCStringAnsi::Strlen(Value), MaxTextLength - TextLength);
+		for (int32 Index = 0; Index < CopyLength; ++Index)
+		{
+			Text[TextLength + Index] = CharCast<TCHAR>(Value[Index]);
+		}
+
+		Arg->Type = FActionLogArg::EType::String;
+		Arg->String.Offset = TextLength;
+		Arg->String.Length = CopyLength;
+		TextLength += CopyLength;
+	}
+}
+
+
+namespace
+{
+	//========= RUNTIME SETTINGS =========//
+
+	int32 CategoryLevels[static_cast<uint8>(EActionLogCategory::MAX)] =
+	{
+		// per attack messages are DEBUG and TRACE, crowds stay quiet until a category is turned up
+		static_cast<int32>(ELogLevel::WARNING),	// Combat
+		static_cast<int32>(ELogLevel::WARNING),	// Animation
+		static_cast<int32>(ELogLevel::INFO),	// Audio
+	};
+
+	int32 CategoryOutputs[static_cast<uint8>(EActionLogCategory::MAX)] =
+	{
+		static_cast<int32>(ELogOutput::ALL),		// Combat
+		static_cast<int32>(ELogOutput::ALL),		// Animation
+		static_cast<int32>(ELogOutput::OUTPUT_LOG),	// Audio
+	};
+
+	const TCHAR* CategoryNames[] = { TEXT("Combat"), TEXT("Animation"), TEXT("Audio") };
+	static_assert(ARRAY_COUNT(CategoryNames) == static_cast<uint8>(EActionLogCategory::MAX), "Every EActionLogCategory needs a name");
+
+	const TCHAR* LevelNames[] = { TEXT("Trace"), TEXT("Debug"), TEXT("Info"), TEXT("Warning"), TEXT("Error") };
+
+	FAutoConsoleVariableRef CVarLogCombat(TEXT("ActionGame.Log.Combat"), CategoryLevels[0], TEXT("Lowest level logged for Combat (0 trace .. 4 error, 5 off)"));
+	FAutoConsoleVariableRef CVarLogAnimation(TEXT("ActionGame.Log.Animation"), CategoryLevels[1], TEXT("Lowest level logged for Animation (0 trace .. 4 error, 5 off)"));
+	FAutoConsoleVariableRef CVarLogAudio(TEXT("ActionGame.Log.Audio"), CategoryLevels[2], TEXT("Lowest level logged for Audio (0 trace .. 4 error, 5 off)"));
+
+	FAutoConsoleVariableRef CVarLogOutputCombat(TEXT("ActionGame.Log.Output.Combat"), CategoryOutputs[0], TEXT("Combat log output (0 all, 1 output log, 2 screen)"));
+	FAutoConsoleVariableRef CVarLogOutputAnimation(TEXT("ActionGame.Log.Output.Animation"), CategoryOutputs[1], TEXT("Animation log output (0 all, 1 output log, 2 screen)"));
+	FAutoConsoleVariableRef CVarLogOutputAudio(TEXT("ActionGame.Log.Output.Audio"), CategoryOutputs[2], TEXT("Audio log output (0 all, 1 output log, 2 screen)"));
+
+	int32 MaxScreenMessagesPerFrame = 4;
+	FAutoConsoleVariableRef CVarLogScreenMessagesPerFrame(TEXT("ActionGame.Log.ScreenMessagesPerFrame"), MaxScreenMessagesPerFrame, TEXT("Maximum log messages added to the screen per frame"));
+
+
+	//========= RING BUFFER =========//
+
+	/**
+	 * Bounded multi producer / single consumer queue. Each cell carries a sequence
+	 * number telling producers and the consumer whose turn it is, so neither side locks.
+	 */
+	class FLogRingBuffer
+	{
+	public:
+		static const uint32 Capacity = 2048;
+
+		FLogRingBuffer()
+			: Cells(new FCell[Capacity])
+			, EnqueuePos(0)
+			, DequeuePos(0)
+		{
+			static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+			for (uint32 Index = 0; Index < Capacity; ++Index)
+			{
+				Cells[Index].Sequence = Index;
+			}
+		}
+
+		~FLogRingBuffer()
+		{
+			delete[] Cells;
+		}
+
+		/** Returns false when the buffer is full **/
+		bool Enqueue(const FActionLogRecord& Record)
+		{
+			FCell* Cell = nullptr;
+			uint32 Pos = EnqueuePos.Load(EMemoryOrder::Relaxed);
+			for (;;)
+			{
+				Cell = &Cells[Pos & (Capacity - 1)];
+				const int32 Diff = static_cast<int32>(Cell->Sequence.Load() - Pos);
+				if (Diff == 0)
+				{
+					// claim the cell, Pos is refreshed when another producer won
+					if (EnqueuePos.CompareExchange(Pos, Pos + 1))
+					{
+						break;
+					}
+				}
+				else if (Diff < 0)
+				{
+					return false;
+				}
+				else
+				{
+					Pos = EnqueuePos.Load(EMemoryOrder::Relaxed);
+				}
+			}
+
+			Cell->Record = Record;
+			Cell->Sequence.Store(Pos + 1);
+			return true;
+		}
+
+		/** Consumer side, only called from the log thread **/
+		bool Dequeue(FActionLogRecord& OutRecord)
+		{
+			FCell& Cell = Cells[DequeuePos & (Capacity - 1)];
+			if (static_cast<int32>(Cell.Sequence.Load() - (DequeuePos + 1)) < 0)
+			{
+				return false;
+			}
+
+			OutRecord = Cell.Record;
+			Cell.Sequence.Store(DequeuePos + Capacity);
+			++DequeuePos;
+			return true;
+		}
+
+	private:
+		struct FCell
+		{
+			TAtomic<uint32> Sequence;
+			FActionLogRecord Record;
+		};
+
+		FCell* Cells;
+
+		TAtomic<uint32> EnqueuePos;
+		uint32 DequeuePos;
+	};
+
+
+	//========= LOG THREAD =========//
+
+	struct FScreenMessage
+	{
+		FString Message;
+		FColor Color;
+	};
+
+	FColor GetLevelColor(ELogLevel LogLevel)
+	{
+		// change color based on the type
+		switch (LogLevel)
+		{
+		case ELogLevel::TRACE:
+			return FColor::Green;
+		case ELogLevel::DEBUG:
+			return FColor::Cyan;
+		case ELogLevel::INFO:
+			return FColor::White;
+		case ELogLevel::WARNING:
+			return FColor::Yellow;
+		case ELogLevel::ERROR:
+			return FColor::Red;
+		default:
+			return FColor::Cyan;
+		}
+	}
+
+	class FActionLogWorker : public FRunnable
+	{
+	public:
+		FActionLogWorker()
+			: WakeEvent(FPlatformProcess::GetSynchEventFromPool())
+			, bStopping(false)
+			, bWakePending(false)
+			, DroppedCount(0)
+			, bScreen(FActionGameProfile::HasPresentation())
+		{
+			// one file per process, a listen server and its clients run side by side
+			const FString FileName = FPaths::Combine(FPaths::ProjectLogDir(), FString::Printf(TEXT("ActionGame-%u.log"), FPlatformProcess::GetCurrentProcessId()));
+			FileWriter = IFileManager::Get().CreateFileWriter(*FileName, FILEWRITE_AllowRead);
+
+			Line.Reserve(256);
+		}
+
+		virtual ~FActionLogWorker()
+		{
+			FPlatformProcess::ReturnSynchEventToPool(WakeEvent);
+			delete FileWriter;
+		}
+
+		void Push(const FActionLogRecord& Record)
+		{
+			if (!Records.Enqueue(Record))
+			{
+				DroppedCount.Increment();
+			}
+
+			// one wake up per drain, later messages ride along without a kernel call
+			if (!bWakePending.Exchange(true))
+			{
+				WakeEvent->Trigger();
+			}
+		}
+
+		virtual uint32 Run() override
+		{
+			while (!bStopping)
+			{
+				WakeEvent->Wait(50);
+				bWakePending = false;
+				Drain();
+			}
+			Drain();
+			return 0;
+		}
+
+		virtual void Stop() override
+		{
+			bStopping = true;
+			WakeEvent->Trigger();
+		}
+
+		/** Game thread - shows a few of the pending screen messages **/
+		void FlushScreen()
+		{
+			FScreenMessage ScreenMessage;
+			for (int32 Count = 0; Count < MaxScreenMessagesPerFrame && ScreenMessages.Dequeue(ScreenMessage); ++Count)
+			{
+				if (GEngine)
+				{
+					// print message on the screen for duration time
+					GEngine->AddOnScreenDebugMessage(-1, 3.0f, ScreenMessage.Color, ScreenMessage.Message);
+				}
+			}
+		}
+
+	private:
+		void Drain()
+		{
+			FActionLogRecord Record;
+			while (Records.Dequeue(Record))
+			{
+				Format(Record);
+
+				// with nothing on screen, screen messages go to the output log
+				ELogOutput Output = static_cast<ELogOutput>(CategoryOutputs[static_cast<uint8>(Record.Category)]);
+				if (Output == ELogOutput::SCREEN && !bScreen)
+				{
+					Output = ELogOutput::OUTPUT_LOG;
+				}
+
+				if (FileWriter)
+				{
+					const FString FileLine = FString::Printf(TEXT("[%.3f][%llu][%s][%s] %s\r\n"), Record.Time, Record.Frame, CategoryNames[static_cast<uint8>(Record.Category)], LevelNames[static_cast<uint8>(Record.Level)], *Line);
+					const FTCHARToUTF8 Utf8(*FileLine);
+					FileWriter->Serialize(const_cast<ANSICHAR*>(Utf8.Get()), Utf8.Length());
+				}
+
+				if (Output == ELogOutput::ALL || Output == ELogOutput::OUTPUT_LOG)
+				{
+					switch (Record.Level)
+					{
+					case ELogLevel::TRACE:
+						UE_LOG(LogActionGame, VeryVerbose, TEXT("%s"), *Line);
+						break;
+					case ELogLevel::DEBUG:
+						UE_LOG(LogActionGame, Verbose, TEXT("%s"), *Line);
+						break;
+					case ELogLevel::WARNING:
+						UE_LOG(LogActionGame, Warning, TEXT("%s"), *Line);
+						break;
+					case ELogLevel::ERROR:
+						UE_LOG(LogActionGame, Error, TEXT("%s"), *Line);
+						break;
+					default:
+						UE_LOG(LogActionGame, Log, TEXT("%s"), *Line);
+						break;
+					}
+				}
+
+#if !UE_BUILD_SHIPPING && ACTIONGAME_WITH_PRESENTATION
+				// on screen text is a debug aid, shipped builds and servers only write the log
+				if (bScreen && (Output == ELogOutput::ALL || Output == ELogOutput::SCREEN))
+				{
+					ScreenMessages.Enqueue(FScreenMessage{ Line, GetLevelColor(Record.Level) });
+				}
+#endif
+			}
+
+			const int32 Dropped = DroppedCount.Set(0);
+			if (Dropped > 0)
+			{
+				UE_LOG(LogActionGame, Warning, TEXT("Log buffer full, dropped %d messages"), Dropped);
+			}
+
+			if (FileWriter)
+			{
+				FileWriter->Flush();
+			}
+		}
+
+		/** Expands the {} placeholders of Record into Line **/
+		void Format(const FActionLogRecord& Record)
+		{
+			Line.Reset();
+
+			int32 ArgIndex = 0;
+			for (const TCHAR* Char = Record.Format; *Char; ++Char)
+			{
+				if (Char[0] == TEXT('{') && Char[1] == TEXT('}') && ArgIndex < Record.NumArgs)
+				{
+					AppendArg(Record, Record.Args[ArgIndex++]);
+					++Char;
+				}
+				else
+				{
+					Line.AppendChar(*Char);
+				}
+			}
+		}
+
+		void AppendArg(const FActionLogRecord& Record, const FActionLogArg& Arg)
+		{
+			switch (Arg.Type)
+			{
+			case FActionLogArg::EType::Int:
+				Line += FString::Printf(TEXT("%lld"), Arg.Int);
+				break;
+			case FActionLogArg::EType::UInt:
+				Line += FString::Printf(TEXT("%llu"), Arg.UInt);
+				break;
+			case FActionLogArg::EType::Float:
+				Line += FString::SanitizeFloat(Arg.Float);
+				break;
+			case FActionLogArg::EType::Bool:
+				Line += Arg.Bool ? TEXT("true") : TEXT("false");
+				break;
+			case FActionLogArg::EType::Name:
+				Arg.Name.AppendString(Line);
+				break;
+			case FActionLogArg::EType::String:
+				Line.AppendChars(Record.Text + Arg.String.Offset, Arg.String.Length);
+				break;
+			default:
+				break;
+			}
+		}
+
+		FLogRingBuffer Records;
+		TQueue<FScreenMessage, EQueueMode::Spsc> ScreenMessages;
+
+		FEvent* WakeEvent;
+		FArchive* FileWriter;
+		TAtomic<bool> bStopping;
+		TAtomic<bool> bWakePending;
+		FThreadSafeCounter DroppedCount;
+
+		/** false without presentation, nothing is ever shown on screen **/
+		const bool bScreen;
+
+		/** reused formatting buffer **/
+		FString Line;
+	};
+
+	FActionLogWorker* Worker = nullptr;
+	FRunnableThread* WorkerThread = nullptr;
+	FDelegateHandle EndFrameHandle;
+}
+
+
+void FActionGameLog::Startup()
+{
+	check(Worker == nullptr);
+
+	Worker = new FActionLogWorker();
+	WorkerThread = FRunnableThread::Create(Worker, TEXT("ActionGameLog"), 0, TPri_BelowNormal);
+
+	if (FActionGameProfile::HasPresentation())
+	{
+		EndFrameHandle = FCoreDelegates::OnEndFrame.AddLambda([]()
+		{
+			Worker->FlushScreen();
+		});
+	}
+}
+
+void FActionGameLog::Shutdown()
+{
+	if (Worker == nullptr)
+	{
+		return;
+	}
+
+	FCoreDelegates::OnEndFrame.Remove(EndFrameHandle);
+
+	if (WorkerThread)
+	{
+		// Kill stops the worker and waits for the final drain
+		WorkerThread->Kill(true);
+		delete WorkerThread;
+		WorkerThread = nullptr;
+	}
+
+	delete Worker;
+	Worker = nullptr;
+}
+
+bool FActionGameLog::IsEnabled(EActionLogCategory Category, ELogLevel Level)
+{
+	return Worker != nullptr && static_cast<int32>(Level) >= CategoryLevels[static_cast<uint8>(Category)];
+}
+
+void FActionGameLog::Submit(FActionLogRecord& Record)
+{
+	Record.Time = FPlatformTime::Seconds() - GStartTime;
+	Record.Frame = GFrameCounter;
+
+	Worker->Push(Record);
+}
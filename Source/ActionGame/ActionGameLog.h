@@ -0,0 +1,176 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "ActionGameLog.generated.h"
+
+
+UENUM(BlueprintType)
+enum class ELogLevel : uint8 {
+	TRACE		UMETA(DisplayName = "Trace"),
+	DEBUG		UMETA(DisplayName = "Debug"),
+	INFO		UMETA(DisplayName = "Info"),
+	WARNING		UMETA(DisplayName = "Warning"),
+	ERROR		UMETA(DisplayName = "Error")
+};
+
+UENUM(BlueprintType)
+enum class ELogOutput : uint8 {
+	ALL			UMETA(DisplayName = "All levels"),
+	OUTPUT_LOG	UMETA(DisplayName = "Output log"),
+	SCREEN		UMETA(DisplayName = "Screen")
+};
+
+/** Log categories, each with its own runtime verbosity and output (ActionGame.Log.<Category>) **/
+enum class EActionLogCategory : uint8 {
+	Combat,
+	Animation,
+	Audio,
+
+	MAX
+};
+
+DECLARE_LOG_CATEGORY_EXTERN(LogActionGame, Log, All);
+
+/**
+ * Lowest level compiled in. Messages below it are removed at compile time,
+ * arguments included. Shipping keeps warnings and errors only.
+ */
+#ifndef ACTIONGAME_LOG_MIN_LEVEL
+	#if UE_BUILD_SHIPPING
+		#define ACTIONGAME_LOG_MIN_LEVEL 3
+	#else
+		#define ACTIONGAME_LOG_MIN_LEVEL 0
+	#endif
+#endif
+
+/**
+ * Logs a message to the ActionGame log backend.
+ *
+ * Format is a literal using {} placeholders, e.g.
+ *     AG_LOG(Combat, INFO, "{} hit {}", __FUNCTION__, *OtherActor->GetName());
+ *
+ * Nothing is evaluated for a filtered message. Accepted messages are copied into
+ * a lock-free ring buffer and formatted on the log thread.
+ */
+#define AG_LOG(Category, Level, Format, ...) \
+	do \
+	{ \
+		if (static_cast<uint8>(ELogLevel::Level) >= ACTIONGAME_LOG_MIN_LEVEL && FActionGameLog::IsEnabled(EActionLogCategory::Category, ELogLevel::Level)) \
+		{ \
+			FActionGameLog::Write(EActionLogCategory::Category, ELogLevel::Level, TEXT(Format), ##__VA_ARGS__); \
+		} \
+	} while (0)
+
+
+/** One log argument, captured by value so formatting can happen later on another thread **/
+struct FActionLogArg
+{
+	enum class EType : uint8 { Int, UInt, Float, Bool, Name, String };
+
+	EType Type;
+
+	union
+	{
+		int64 Int;
+		uint64 UInt;
+		double Float;
+		bool Bool;
+		struct { int32 Offset; int32 Length; } String;
+	};
+
+	FName Name;
+};
+
+/** A log message waiting to be formatted **/
+struct FActionLogRecord
+{
+	static const int32 MaxArgs = 6;
+	static const int32 MaxTextLength = 128;
+
+	/** format literal, never freed **/
+	const TCHAR* Format;
+
+	double Time;
+	uint64 Frame;
+
+	EActionLogCategory Category;
+	ELogLevel Level;
+
+	int32 NumArgs;
+	FActionLogArg Args[MaxArgs];
+
+	/** storage for copied string arguments **/
+	int32 TextLength;
+	TCHAR Text[MaxTextLength];
+
+	void AddArg(int8 Value) { AddInt(Value); }
+	void AddArg(int16 Value) { AddInt(Value); }
+	void AddArg(int32 Value) { AddInt(Value); }
+	void AddArg(int64 Value) { AddInt(Value); }
+	void AddArg(uint8 Value) { AddUInt(Value); }
+	void AddArg(uint16 Value) { AddUInt(Value); }
+	void AddArg(uint32 Value) { AddUInt(Value); }
+	void AddArg(uint64 Value) { AddUInt(Value); }
+	void AddArg(float Value) { AddFloat(Value); }
+	void AddArg(double Value) { AddFloat(Value); }
+	void AddArg(bool Value);
+	void AddArg(const FName& Value);
+	void AddArg(const FString& Value) { AddString(*Value, Value.Len()); }
+	void AddArg(const TCHAR* Value) { AddString(Value, FCString::Strlen(Value)); }
+	void AddArg(const ANSICHAR* Value);
+
+	template <typename EnumType>
+	typename TEnableIf<TIsEnum<EnumType>::Value>::Type AddArg(EnumType Value) { AddInt(static_cast<int64>(Value)); }
+
+private:
+	FActionLogArg* NextArg();
+	void AddInt(int64 Value);
+	void AddUInt(uint64 Value);
+	void AddFloat(double Value);
+	void AddString(const TCHAR* Value, int32 Length);
+};
+
+
+/**
+ * Asynchronous log backend used through AG_LOG.
+ *
+ * The calling thread only copies the arguments into a bounded lock-free ring buffer.
+ * A worker thread drains it, formats the messages and writes them to
+ * Saved/Logs/ActionGame-<process id>.log and the output log. Screen messages are handed back
+ * to the game thread and shown a few per frame. Messages are dropped (and counted)
+ * when the buffer is full; the caller never blocks.
+ */
+class ACTIONGAME_API FActionGameLog
+{
+public:
+	/** Starts the log worker, called on module startup **/
+	static void Startup();
+
+	/** Flushes pending messages and stops the log worker, called on module shutdown **/
+	static void Shutdown();
+
+	/** Runtime filter, see ActionGame.Log.<Category> **/
+	static bool IsEnabled(EActionLogCategory Category, ELogLevel Level);
+
+	template <typename... ArgTypes>
+	static void Write(EActionLogCategory Category, ELogLevel Level, const TCHAR* Format, const ArgTypes&... Args)
+	{
+		FActionLogRecord Record;
+		Record.Format = Format;
+		Record.Category = Category;
+		Record.Level = Level;
+		Record.NumArgs = 0;
+		Record.TextLength = 0;
+
+		int32 Unpack[] = { 0, (Record.AddArg(Args), 0)... };
+		(void)Unpack;
+
+		Submit(Record);
+	}
+
+private:
+	static void Submit(FActionLogRecord& Record);
+};
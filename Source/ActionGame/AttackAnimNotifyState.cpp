@@ -2,48 +2,39 @@
 
 #include "AttackAnimNotifyState.h"
 #include "ActionGameCharacter.h"
+#include "CombatLatencyTracer.h"
 #include "Engine.h"
 
+DECLARE_CYCLE_STAT(TEXT("AttackNotifyState Begin"), STAT_AttackNotifyStateBegin, STATGROUP_ActionGameCombat);
+DECLARE_CYCLE_STAT(TEXT("AttackNotifyState End"), STAT_AttackNotifyStateEnd, STATGROUP_ActionGameCombat);
+
 
 void UAttackAnimNotifyState::NotifyBegin(USkeletalMeshComponent * MeshComp, UAnimSequenceBase * Animation, float TotalDuration)
 {
-	GEngine->AddOnScreenDebugMessage(-1, 3.0f, FColor::Green, __FUNCTION__);
+	SCOPE_CYCLE_COUNTER(STAT_AttackNotifyStateBegin);
+	AG_LOG(Animation, DEBUG, "{}", __FUNCTION__);
 
 	if (MeshComp != NULL && MeshComp->GetOwner() != NULL)
 	{
 		AActionGameCharacter* player = Cast<AActionGameCharacter>(MeshComp->GetOwner());
-		if (player != NULL)
+		// the combat manager opens the window on montage time itself
+		if (player != NULL && !player->HasAttackTimeline())
 		{
 			player->AttackNotifyStart();
 		}
 	}
 }
 
-void UAttackAnimNotifyState::NotifyTick(USkeletalMeshComponent * MeshComp, UAnimSequenceBase * Animation, float FrameDeltaTime)
-{
-	if (MeshComp != NULL && MeshComp->GetOwner() != NULL)
-	{
-		AActionGameCharacter* player = Cast<AActionGameCharacter>(MeshComp->GetOwner());
-		if (player != NULL)
-		{
-			if (player->GetCurrentAttackType() == EAttackType::MELEE_KICK)
-			{
-				player->SetIsKeyboardEnabled(false);
-			}
-		}
-	}
-}
-
 void UAttackAnimNotifyState::NotifyEnd(USkeletalMeshComponent * MeshComp, UAnimSequenceBase * Animation)
 {
-	GEngine->AddOnScreenDebugMessage(-1, 3.0f, FColor::Red, __FUNCTION__);
+	SCOPE_CYCLE_COUNTER(STAT_AttackNotifyStateEnd);
+	AG_LOG(Animation, DEBUG, "{}", __FUNCTION__);
 	if (MeshComp != NULL && MeshComp->GetOwner() != NULL)
 	{
 		AActionGameCharacter* player = Cast<AActionGameCharacter>(MeshComp->GetOwner());
-		if (player != NULL)
+		if (player != NULL && !player->HasAttackTimeline())
 		{
-			player->AttackNotifyEnd();		
-			player->SetIsKeyboardEnabled(true);
+			player->AttackNotifyEnd();
 		}
 	}
 }
@@ -0,0 +1,377 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "AttackCatalogue.h"
+#include "ActionGameLog.h"
+#include "AttackAnimNotifyState.h"
+#include "PunchThrowAnimNotifyState.h"
+#include "Animation/AnimMontage.h"
+#include "Engine/CollisionProfile.h"
+#include "Algo/Sort.h"
+
+
+namespace
+{
+	/** Per attack type defaults - the row name it is read from and how it behaves **/
+	struct FAttackDefaults
+	{
+		EAttackType Type;
+		const TCHAR* RowName;
+		const TCHAR* LeftSocketName;
+		const TCHAR* RightSocketName;
+		bool bMovementEnabled;
+		bool bAnimationBlended;
+		float LungeDistance;
+		float LungeDuration;
+		float Damage;
+		float HitStopDuration;
+		float HitStopPlayRate;
+		float ProjectileSpeed;
+		float ProjectileRadius;
+		float ProjectileRange;
+	};
+
+	const FAttackDefaults AttackDefaults[] =
+	{
+		{ EAttackType::MELEE_FIST, TEXT("Punch"), TEXT("fist_l_collision"), TEXT("fist_r_collision"), true, true, 40.f, 0.12f, 10.f, 0.08f, 0.1f, 0.f, 0.f, 0.f },
+		{ EAttackType::MELEE_KICK, TEXT("Kick"), TEXT("foot_l_collision"), TEXT("foot_r_collision"), false, false, 60.f, 0.15f, 20.f, 0.12f, 0.05f, 0.f, 0.f, 0.f },
+		{ EAttackType::RANGED_BLAST, TEXT("Blast"), TEXT("hand_l"), TEXT("hand_r"), false, true, 0.f, 0.1f, 8.f, 0.f, 1.f, 2000.f, 15.f, 2000.f },
+	};
+
+	static_assert(ARRAY_COUNT(AttackDefaults) == static_cast<uint8>(EAttackType::MAX), "Every EAttackType needs an entry in AttackDefaults");
+
+	/** montage sections are named "start_1" .. "start_N" **/
+	const TCHAR* AttackSectionPrefix = TEXT("start_");
+
+	FName ResolveCollisionProfile(FName ProfileName)
+	{
+		FCollisionResponseTemplate Template;
+		if (!UCollisionProfile::Get()->GetProfileTemplate(ProfileName, Template))
+		{
+			AG_LOG(Combat, WARNING, "Attack catalogue: unknown collision profile {}, using NoCollision", ProfileName);
+			return UCollisionProfile::NoCollision_ProfileName;
+		}
+		return ProfileName;
+	}
+
+	/** Adds the attack windows and throw sounds of the montage notifies inside [SectionStart, SectionEnd) **/
+	void ExtractSectionTimeline(const UAnimMontage* Montage, float SectionStart, float SectionEnd, TArray<FAttackTimelineEvent>& Timeline)
+	{
+		const int32 FirstEvent = Timeline.Num();
+
+		for (const FAnimNotifyEvent& Notify : Montage->Notifies)
+		{
+			const float Begin = Notify.GetTriggerTime();
+			if (Notify.NotifyStateClass == nullptr || Begin < SectionStart || Begin >= SectionEnd)
+			{
+				continue;
+			}
+
+			if (Notify.NotifyStateClass->IsA<UAttackAnimNotifyState>())
+			{
+				const float End = FMath::Min(Notify.GetEndTriggerTime(), SectionEnd);
+				Timeline.Add(FAttackTimelineEvent{ Begin - SectionStart, EAttackTimelineEvent::WindowOpen });
+				Timeline.Add(FAttackTimelineEvent{ End - SectionStart, EAttackTimelineEvent::WindowClose });
+			}
+			else if (Notify.NotifyStateClass->IsA<UPunchThrowAnimNotifyState>())
+			{
+				Timeline.Add(FAttackTimelineEvent{ Begin - SectionStart, EAttackTimelineEvent::ThrowSound });
+			}
+		}
+
+		// a window closing and the next opening at the same time close first
+		Algo::Sort(MakeArrayView(Timeline.GetData() + FirstEvent, Timeline.Num() - FirstEvent), [](const FAttackTimelineEvent& A, const FAttackTimelineEvent& B)
+		{
+			return A.Time < B.Time || (A.Time == B.Time && A.Type == EAttackTimelineEvent::WindowClose && B.Type != EAttackTimelineEvent::WindowClose);
+		});
+	}
+
+	/**
+	 * Returns the limbs SectionName hits with and, when Timeline is given, adds a LimbMask event at
+	 * every time the set of limbs in the schedule changes. Sections the schedule leaves out hit with all limbs.
+	 */
+	uint8 CompileSectionLimbs(const FCompiledAttack& Attack, const TArray<FAttackLimbWindow>& Schedule, FName SectionName, float SectionLength, TArray<FAttackTimelineEvent>* Timeline)
+	{
+		const uint8 AllLimbs = static_cast<uint8>((1 << Attack.LimbSockets.Num()) - 1);
+
+		struct FLimbWindow
+		{
+			uint8 Bit;
+			float Start;
+			float End;
+		};
+		TArray<FLimbWindow, TInlineAllocator<8>> Windows;
+		uint8 SectionMask = 0;
+
+		for (const FAttackLimbWindow& Entry : Schedule)
+		{
+			if (!Entry.Section.IsNone() && Entry.Section != SectionName)
+			{
+				continue;
+			}
+
+			const int32 Limb = Attack.LimbSockets.IndexOfByKey(Entry.Socket);
+			if (Limb == INDEX_NONE)
+			{
+				AG_LOG(Combat, WARNING, "Attack catalogue: limb schedule names socket {} the attack has no limb on", Entry.Socket);
+				continue;
+			}
+
+			const uint8 Bit = static_cast<uint8>(1 << Limb);
+			SectionMask |= Bit;
+			Windows.Add(FLimbWindow{ Bit, FMath::Max(Entry.Start, 0.f), Entry.End > 0.f ? FMath::Min(Entry.End, SectionLength) : SectionLength });
+		}
+
+		if (SectionMask == 0)
+		{
+			return AllLimbs;
+		}
+
+		if (Timeline)
+		{
+			// the limbs in play only change where a window starts or ends
+			TArray<float, TInlineAllocator<16>> Changes;
+			Changes.Add(0.f);
+			for (const FLimbWindow& Window : Windows)
+			{
+				Changes.AddUnique(Window.Start);
+				Changes.AddUnique(Window.End);
+			}
+			Changes.Sort();
+
+			uint8 PreviousMask = 0xFF;
+			for (const float Time : Changes)
+			{
+				uint8 Mask = 0;
+				for (const FLimbWindow& Window : Windows)
+				{
+					Mask |= (Window.Start <= Time && Time < Window.End) ? Window.Bit : 0;
+				}
+				if (Mask != PreviousMask)
+				{
+					Timeline->Add(FAttackTimelineEvent{ Time, EAttackTimelineEvent::LimbMask, Mask });
+					PreviousMask = Mask;
+				}
+			}
+		}
+		return SectionMask;
+	}
+
+	/**
+	 * Fills the combo table of Attack from its row's links, once every attack of the catalogue is
+	 * compiled so links can name sections of other attacks. Without links every input cancels any
+	 * section at any time into a random section, the way attacks played before combos.
+	 */
+	void CompileComboTransitions(FCompiledAttack& Attack, const TArray<FAttackComboLink>& Links, const FCompiledAttack* Attacks)
+	{
+		const int32 NumTypes = static_cast<int32>(EAttackType::MAX);
+		const bool bFreeCancel = Links.Num() == 0;
+
+		Attack.ComboTransitions.SetNumUninitialized(Attack.SectionNames.Num() * NumTypes);
+		for (FComboTransition& Transition : Attack.ComboTransitions)
+		{
+			Transition.ToSection = bFreeCancel ? FComboTransition::RandomSection : FComboTransition::NoTransition;
+			Transition.CancelStart = 0.f;
+			Transition.CancelEnd = MAX_flt;
+		}
+
+		for (const FAttackComboLink& Link : Links)
+		{
+			if (Link.Input >= EAttackType::MAX)
+			{
+				continue;
+			}
+
+			int8 ToSection = FComboTransition::RandomSection;
+			if (!Link.ToSection.IsNone())
+			{
+				const int32 Target = Attacks[static_cast<uint8>(Link.Input)].SectionNames.IndexOfByKey(Link.ToSection);
+				if (Target == INDEX_NONE)
+				{
+					AG_LOG(Combat, WARNING, "Attack catalogue: combo link to {} names a section the {} attack does not have", Link.ToSection, Link.Input);
+					continue;
+				}
+				ToSection = static_cast<int8>(Target);
+			}
+
+			for (int32 Section = 0; Section < Attack.SectionNames.Num(); ++Section)
+			{
+				if (!Link.FromSection.IsNone() && Link.FromSection != Attack.SectionNames[Section])
+				{
+					continue;
+				}
+
+				FComboTransition& Transition = Attack.GetComboTransitionCell(Section, Link.Input);
+				if (Transition.ToSection != FComboTransition::NoTransition)
+				{
+					AG_LOG(Combat, WARNING, "Attack catalogue: section {} has more than one combo link for {}, the first is used", Attack.SectionNames[Section], Link.Input);
+					continue;
+				}
+				Transition.ToSection = ToSection;
+				Transition.CancelStart = FMath::Max(Link.CancelStart, 0.f);
+				Transition.CancelEnd = Link.CancelEnd > 0.f ? Link.CancelEnd : MAX_flt;
+			}
+		}
+	}
+
+	TMap<TWeakObjectPtr<const UDataTable>, TWeakPtr<const FAttackCatalogue>>& GetCatalogueCache()
+	{
+		static TMap<TWeakObjectPtr<const UDataTable>, TWeakPtr<const FAttackCatalogue>> Cache;
+		return Cache;
+	}
+}
+
+
+TSharedPtr<const FAttackCatalogue> FAttackCatalogue::Get(const UDataTable* DataTable)
+{
+	check(IsInGameThread());
+
+	if (DataTable == nullptr)
+	{
+		return nullptr;
+	}
+
+	TMap<TWeakObjectPtr<const UDataTable>, TWeakPtr<const FAttackCatalogue>>& Cache = GetCatalogueCache();
+	if (const TWeakPtr<const FAttackCatalogue>* Existing = Cache.Find(DataTable))
+	{
+		// a released catalogue points to montages that may have been unloaded since
+		if (TSharedPtr<const FAttackCatalogue> Catalogue = Existing->Pin())
+		{
+			return Catalogue;
+		}
+	}
+
+	// drop catalogues of tables that have been garbage collected or catalogues nobody holds
+	for (auto It = Cache.CreateIterator(); It; ++It)
+	{
+		if (!It.Key().IsValid() || !It.Value().IsValid())
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	TSharedRef<FAttackCatalogue> Catalogue = MakeShared<FAttackCatalogue>();
+	Catalogue->Build(DataTable);
+
+#if WITH_EDITOR
+	// edited tables are recompiled the next time a character asks for them
+	const_cast<UDataTable*>(DataTable)->OnDataTableChanged().AddLambda([WeakTable = TWeakObjectPtr<const UDataTable>(DataTable)]()
+	{
+		GetCatalogueCache().Remove(WeakTable);
+	});
+#endif
+
+	Cache.Add(DataTable, Catalogue);
+	return Catalogue;
+}
+
+void FAttackCatalogue::Build(const UDataTable* DataTable)
+{
+	static const FString ContextString(TEXT("Attack Catalogue Context"));
+	const FMeleeCollisionProfile CollisionProfile;
+
+	const FName EnabledProfileName = ResolveCollisionProfile(CollisionProfile.Enabled);
+	const FName DisabledProfileName = ResolveCollisionProfile(CollisionProfile.Disabled);
+
+	// rows of the compiled attacks, for the combo links compiled once all attacks are
+	const FPlayAttackMontage* Rows[static_cast<uint8>(EAttackType::MAX)] = {};
+	FString MissingRows;
+
+	for (const FAttackDefaults& Defaults : AttackDefaults)
+	{
+		FCompiledAttack& Attack = Attacks[static_cast<uint8>(Defaults.Type)];
+
+		// tables may leave attack types out, those attacks are simply unavailable
+		const FPlayAttackMontage* Row = DataTable->FindRow<FPlayAttackMontage>(FName(Defaults.RowName), ContextString, false);
+		if (Row == nullptr)
+		{
+			MissingRows += MissingRows.IsEmpty() ? TEXT("") : TEXT(", ");
+			MissingRows += Defaults.RowName;
+			continue;
+		}
+		// montages are never loaded here, the game thread would wait on them
+		if (Row->Montage.Get() == nullptr)
+		{
+			continue;
+		}
+
+		Rows[static_cast<uint8>(Defaults.Type)] = Row;
+		Attack.Montage = Row->Montage.Get();
+		Attack.LimbSockets.Add(Row->LeftSocketName.IsNone() ? FName(Defaults.LeftSocketName) : Row->LeftSocketName);
+		Attack.LimbSockets.Add(Row->RightSocketName.IsNone() ? FName(Defaults.RightSocketName) : Row->RightSocketName);
+		for (const FName& Socket : Row->ExtraLimbSockets)
+		{
+			if (Attack.LimbSockets.Num() == FCompiledAttack::MaxLimbs)
+			{
+				AG_LOG(Combat, WARNING, "Attack catalogue: row {} has more than {} limbs, the rest are ignored", FName(Defaults.RowName), FCompiledAttack::MaxLimbs);
+				break;
+			}
+			Attack.LimbSockets.Add(Socket);
+		}
+		Attack.EnabledProfileName = EnabledProfileName;
+		Attack.DisabledProfileName = DisabledProfileName;
+		Attack.bMovementEnabled = Defaults.bMovementEnabled;
+		Attack.bAnimationBlended = Defaults.bAnimationBlended;
+		Attack.Cooldown = FMath::Max(Row->Cooldown, 0.f);
+		const float LungeDistance = Row->LungeDistance != 0.f ? Row->LungeDistance : Defaults.LungeDistance;
+		Attack.LungeDuration = Row->LungeDuration > 0.f ? Row->LungeDuration : Defaults.LungeDuration;
+		Attack.LungeSpeed = LungeDistance > 0.f ? LungeDistance / Attack.LungeDuration : 0.f;
+		Attack.Damage = Row->Damage > 0.f ? Row->Damage : Defaults.Damage;
+		Attack.HitStopDuration = Row->HitStopDuration > 0.f ? Row->HitStopDuration : Defaults.HitStopDuration;
+		Attack.HitStopPlayRate = FMath::Clamp(Row->HitStopPlayRate > 0.f ? Row->HitStopPlayRate : Defaults.HitStopPlayRate, KINDA_SMALL_NUMBER, 1.f);
+		Attack.HitStopTimeDilation = Row->HitStopTimeDilation > 0.f ? FMath::Clamp(Row->HitStopTimeDilation, KINDA_SMALL_NUMBER, 1.f) : 1.f;
+		Attack.ProjectileSpeed = Row->ProjectileSpeed > 0.f ? Row->ProjectileSpeed : Defaults.ProjectileSpeed;
+		Attack.ProjectileRadius = Row->ProjectileRadius > 0.f ? Row->ProjectileRadius : Defaults.ProjectileRadius;
+		const float ProjectileRange = Row->ProjectileRange > 0.f ? Row->ProjectileRange : Defaults.ProjectileRange;
+		Attack.ProjectileLifetime = Attack.ProjectileSpeed > 0.f ? ProjectileRange / Attack.ProjectileSpeed : 0.f;
+		Attack.ProjectileMesh = Row->ProjectileMesh.Get();
+
+		Attack.SectionNames.Reserve(Row->AnimationSectionCount);
+		for (int32 SectionIndex = 1; SectionIndex <= Row->AnimationSectionCount; ++SectionIndex)
+		{
+			const FName SectionName(*FString::Printf(TEXT("%s%d"), AttackSectionPrefix, SectionIndex));
+			const int32 MontageSectionIndex = Attack.Montage->GetSectionIndex(SectionName);
+			if (MontageSectionIndex == INDEX_NONE)
+			{
+				AG_LOG(Combat, WARNING, "Attack catalogue: montage {} has no section {}", Attack.Montage->GetFName(), SectionName);
+				continue;
+			}
+			Attack.SectionNames.Add(SectionName);
+
+			// attack windows run on montage time, not on notifies fired by animation evaluation
+			float SectionStart, SectionEnd;
+			Attack.Montage->GetSectionStartAndEndTime(MontageSectionIndex, SectionStart, SectionEnd);
+			Attack.SectionLengths.Add(SectionEnd - SectionStart);
+			const int32 TimelineStart = Attack.Timeline.Num();
+			Attack.SectionTimelineStarts.Add(TimelineStart);
+			ExtractSectionTimeline(Attack.Montage, SectionStart, SectionEnd, Attack.Timeline);
+
+			// limb changes only go on a timeline the section already has, notify driven sections use the section's limbs throughout
+			const bool bHasTimeline = Attack.Timeline.Num() > TimelineStart;
+			Attack.SectionLimbMasks.Add(CompileSectionLimbs(Attack, Row->LimbSchedule, SectionName, SectionEnd - SectionStart, bHasTimeline ? &Attack.Timeline : nullptr));
+			if (bHasTimeline)
+			{
+				MakeArrayView(Attack.Timeline.GetData() + TimelineStart, Attack.Timeline.Num() - TimelineStart).StableSort([](const FAttackTimelineEvent& A, const FAttackTimelineEvent& B)
+				{
+					return A.Time < B.Time;
+				});
+			}
+		}
+		Attack.SectionTimelineStarts.Add(Attack.Timeline.Num());
+	}
+
+	for (int32 Type = 0; Type < static_cast<int32>(EAttackType::MAX); ++Type)
+	{
+		if (Rows[Type])
+		{
+			CompileComboTransitions(Attacks[Type], Rows[Type]->ComboLinks, Attacks);
+		}
+	}
+
+	// move sets compile the same table again after every unload, the gap is told once
+	static TSet<FName> ReportedTables;
+	if (!MissingRows.IsEmpty() && !ReportedTables.Contains(DataTable->GetFName()))
+	{
+		ReportedTables.Add(DataTable->GetFName());
+		AG_LOG(Combat, INFO, "Attack catalogue: {} has no rows for {}, those attacks are unavailable", DataTable->GetFName(), MissingRows);
+	}
+}
@@ -0,0 +1,358 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataTable.h"
+#include "UObject/SoftObjectPtr.h"
+
+#include "AttackCatalogue.generated.h"
+
+class UStaticMesh;
+
+
+UENUM(BlueprintType)
+enum class EAttackType: uint8 {
+	MELEE_FIST	UMETA(DisplayName = "Melee - Fist"),
+	MELEE_KICK  UMETA(DisplayName = "Melee - Kick"),
+	RANGED_BLAST	UMETA(DisplayName = "Ranged - Blast"),
+
+	MAX			UMETA(Hidden)
+};
+
+
+/** Part of a montage section during which one limb can hit **/
+USTRUCT(BlueprintType)
+struct FAttackLimbWindow
+{
+	GENERATED_BODY()
+
+	/** Montage section ("start_1", "start_2", ...) the window belongs to - None for every section **/
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	FName Section;
+
+	/** Socket of the limb - the row's left, right or one of its extra limb sockets **/
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	FName Socket;
+
+	/** Seconds into the section the limb starts hitting **/
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	float Start;
+
+	/** Seconds into the section the limb stops hitting - 0 runs to the end of the section **/
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	float End;
+};
+
+
+/** Attack an input may cancel a montage section into, and when **/
+USTRUCT(BlueprintType)
+struct FAttackComboLink
+{
+	GENERATED_BODY()
+
+	/** Montage section ("start_1", "start_2", ...) the link leaves from - None for every section **/
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	FName FromSection;
+
+	/** Attack input taking the link **/
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	EAttackType Input;
+
+	/** Section of the input's attack the link plays - None picks one at random **/
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	FName ToSection;
+
+	/** Seconds into FromSection the cancel window opens **/
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	float CancelStart;
+
+	/** Seconds into FromSection the cancel window closes - 0 runs to the end of the section **/
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	float CancelEnd;
+};
+
+
+USTRUCT(BlueprintType)
+struct FPlayAttackMontage : public FTableRowBase
+{
+	GENERATED_BODY()
+
+	/** Animation Montage, streamed in with the move set of the characters using the table **/
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	TSoftObjectPtr<UAnimMontage> Montage;
+
+	/** Montage Section Cound **/
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	int32 AnimationSectionCount;
+
+	/** Discription **/
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	FString Description;
+
+	/** Socket the left collision box is attached to - None uses the attack type default **/
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	FName LeftSocketName;
+
+	/** Socket the right collision box is attached to - None uses the attack type default **/
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	FName RightSocketName;
+
+	/** Sockets of limbs after the left and right one, such as weapons **/
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	TArray<FName> ExtraLimbSockets;
+
+	/**
+	 * Which limbs hit in which section and when, inside the section's attack window.
+	 * Sections without an entry hit with every limb, an empty schedule keeps that for all sections.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	TArray<FAttackLimbWindow> LimbSchedule;
+
+	/**
+	 * Attacks the row's sections can be cancelled into, and when. Inputs without a link wait for
+	 * the section to end. A row without links can be cancelled into any attack at any time.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	TArray<FAttackComboLink> ComboLinks;
+
+	/** Seconds before the attack can be used again **/
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	float Cooldown;
+
+	/** Distance the attacker lunges forward when the attack starts - 0 uses the attack type default, negative for none **/
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	float LungeDistance;
+
+	/** Seconds the lunge takes - 0 uses the attack type default **/
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	float LungeDuration;
+
+	/** Health the victim loses when the attack lands - 0 uses the attack type default **/
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	float Damage;
+
+	/** Seconds the attacker and victim freeze when the attack lands - 0 uses the attack type default **/
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	float HitStopDuration;
+
+	/** Montage play rate scale during the hit stop - 0 uses the attack type default **/
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	float HitStopPlayRate;
+
+	/** Custom time dilation of attacker and victim during the hit stop - 0 leaves time dilation alone **/
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	float HitStopTimeDilation;
+
+	/** Speed of the projectile a ranged attack launches when its window opens - 0 uses the attack type default **/
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	float ProjectileSpeed;
+
+	/** Radius the projectile hits with - 0 uses the attack type default **/
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	float ProjectileRadius;
+
+	/** Distance the projectile flies before it is dropped - 0 uses the attack type default **/
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	float ProjectileRange;
+
+	/** Mesh drawn for the projectile, streamed in with the move set - None draws nothing **/
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	TSoftObjectPtr<UStaticMesh> ProjectileMesh;
+};
+
+
+USTRUCT(BlueprintType)
+struct FMeleeCollisionProfile
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FName Enabled;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FName Disabled;
+
+	// default constructor
+	FMeleeCollisionProfile()
+	{
+		Enabled = FName(TEXT("Weapon"));
+		Disabled = FName(TEXT("NoCollision"));
+	}
+};
+
+
+/** Gameplay moment of an attack, extracted from the montage's notify states and the limb schedule **/
+enum class EAttackTimelineEvent : uint8
+{
+	WindowOpen,
+	WindowClose,
+	ThrowSound,
+	LimbMask,
+};
+
+struct FAttackTimelineEvent
+{
+	/** seconds from the start of the section at play rate 1 **/
+	float Time;
+	EAttackTimelineEvent Type;
+
+	/** limbs that can hit from here on, bit N for limb N - LimbMask events only **/
+	uint8 LimbMask;
+};
+
+
+/** What an attack input does while a section plays, one cell of the combo table **/
+struct FComboTransition
+{
+	/** ToSection values that are not a section index **/
+	static const int8 NoTransition = -1;
+	static const int8 RandomSection = -2;
+
+	/** section of the input's attack to play **/
+	int8 ToSection;
+
+	/** seconds into the playing section the input is allowed in, at play rate 1 **/
+	float CancelStart;
+	float CancelEnd;
+
+	FORCEINLINE bool IsAllowedAt(float Time) const { return ToSection != NoTransition && Time >= CancelStart && Time <= CancelEnd; }
+};
+
+
+/**
+ * One attack resolved from its data table row. Everything the attack input
+ * needs is stored ready to use, so starting an attack does no row lookup,
+ * string building or name hashing.
+ */
+struct FCompiledAttack
+{
+	/** limbs an attack can hit with, the bits of a limb mask **/
+	static const int32 MaxLimbs = 4;
+
+	/** montage to play - kept alive by the data table the catalogue was built from **/
+	UAnimMontage* Montage;
+
+	/** playable montage sections ("start_1", "start_2", ...) **/
+	TArray<FName> SectionNames;
+
+	/** length of each section in seconds **/
+	TArray<float> SectionLengths;
+
+	/**
+	 * Attack windows and sounds of every section, in time order per section. Section N owns
+	 * Timeline[SectionTimelineStarts[N]] up to SectionTimelineStarts[N + 1].
+	 */
+	TArray<FAttackTimelineEvent> Timeline;
+	TArray<int32> SectionTimelineStarts;
+
+	/** sockets the limb collision boxes are attached to, left and right first **/
+	TArray<FName, TInlineAllocator<MaxLimbs>> LimbSockets;
+
+	/**
+	 * Limbs hitting in each section, bit N for limb N. Sections on the timeline narrow
+	 * it down over time with LimbMask events, the others use it for the whole window.
+	 */
+	TArray<uint8> SectionLimbMasks;
+
+	/** combo table, EAttackType::MAX cells per section indexed by the attack input **/
+	TArray<FComboTransition> ComboTransitions;
+
+	/** collision profiles applied to the boxes while the attack window is open / closed **/
+	FName EnabledProfileName;
+	FName DisabledProfileName;
+
+	/** whether the character can move while the attack plays **/
+	bool bMovementEnabled;
+
+	/** whether the attack montage is blended with the locomotion pose **/
+	bool bAnimationBlended;
+
+	/** seconds before the attack can be used again **/
+	float Cooldown;
+
+	/** forward speed and seconds of the lunge at the start of the attack, predicted by the movement component **/
+	float LungeSpeed;
+	float LungeDuration;
+
+	/** health taken from each victim, once per swing **/
+	float Damage;
+
+	/** hit stop applied to attacker and victim the first time the attack lands in a swing **/
+	float HitStopDuration;
+	float HitStopPlayRate;
+	float HitStopTimeDilation;
+
+	/** projectile launched when the attack window opens, ranged attacks only - kept alive by the move set **/
+	float ProjectileSpeed;
+	float ProjectileRadius;
+	float ProjectileLifetime;
+	UStaticMesh* ProjectileMesh;
+
+	FCompiledAttack()
+		: Montage(nullptr)
+		, bMovementEnabled(true)
+		, bAnimationBlended(true)
+		, Cooldown(0.f)
+		, LungeSpeed(0.f)
+		, LungeDuration(0.f)
+		, Damage(0.f)
+		, HitStopDuration(0.f)
+		, HitStopPlayRate(1.f)
+		, HitStopTimeDilation(1.f)
+		, ProjectileSpeed(0.f)
+		, ProjectileRadius(0.f)
+		, ProjectileLifetime(0.f)
+		, ProjectileMesh(nullptr)
+	{
+	}
+
+	bool IsValid() const { return Montage != nullptr && SectionNames.Num() > 0; }
+
+	/** Whether Section is driven by the timeline rather than by its notifies firing **/
+	bool HasTimeline(int32 Section) const { return SectionTimelineStarts.IsValidIndex(Section + 1) && SectionTimelineStarts[Section + 1] > SectionTimelineStarts[Section]; }
+
+	bool HasLunge() const { return LungeSpeed > 0.f && LungeDuration > 0.f; }
+
+	bool HasHitStop() const { return HitStopDuration > 0.f && (HitStopPlayRate < 1.f || HitStopTimeDilation < 1.f); }
+
+	/** Whether the attack hits with a projectile rather than with its limbs **/
+	bool IsRanged() const { return ProjectileSpeed > 0.f && ProjectileLifetime > 0.f; }
+
+	/** Transition Input takes while Section plays, a constant time lookup **/
+	FORCEINLINE const FComboTransition& GetComboTransition(int32 Section, EAttackType Input) const { return ComboTransitions[Section * static_cast<int32>(EAttackType::MAX) + static_cast<int32>(Input)]; }
+	FORCEINLINE FComboTransition& GetComboTransitionCell(int32 Section, EAttackType Input) { return ComboTransitions[Section * static_cast<int32>(EAttackType::MAX) + static_cast<int32>(Input)]; }
+
+	uint8 GetSectionLimbMask(int32 Section) const { return SectionLimbMasks.IsValidIndex(Section) ? SectionLimbMasks[Section] : 0; }
+};
+
+
+/**
+ * Flat table of compiled attacks indexed by EAttackType.
+ *
+ * Built once per attack data table and shared by every character using it, for
+ * as long as one of them holds it. Rows whose montage is not resident are skipped,
+ * the combat move set builds it once the montages have streamed in.
+ */
+class ACTIONGAME_API FAttackCatalogue
+{
+public:
+	/** Returns the catalogue compiled from DataTable, building it when nobody holds one yet **/
+	static TSharedPtr<const FAttackCatalogue> Get(const UDataTable* DataTable);
+
+	/** Returns the compiled attack for Type or nullptr when the table has no usable row for it **/
+	FORCEINLINE const FCompiledAttack* Find(EAttackType Type) const
+	{
+		if (Type >= EAttackType::MAX)
+		{
+			return nullptr;
+		}
+		const FCompiledAttack& Attack = Attacks[static_cast<uint8>(Type)];
+		return Attack.IsValid() ? &Attack : nullptr;
+	}
+
+private:
+	void Build(const UDataTable* DataTable);
+
+	FCompiledAttack Attacks[static_cast<uint8>(EAttackType::MAX)];
+};
@@ -0,0 +1,65 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "AttackEvent.h"
+
+
+static_assert(static_cast<int32>(EAttackType::MAX) <= (1 << FAttackEvent::AttackTypeBits), "EAttackType does not fit FAttackEvent::AttackTypeBits");
+
+
+void FAttackEvent::SetStartTime(float ServerWorldSeconds)
+{
+	StartTime = WrapTime(ServerWorldSeconds);
+}
+
+float FAttackEvent::GetStartTime(float ServerWorldSeconds) const
+{
+	return UnwrapTime(StartTime, ServerWorldSeconds);
+}
+
+uint16 FAttackEvent::WrapTime(float ServerWorldSeconds)
+{
+	const uint32 Milliseconds = static_cast<uint32>(FMath::Max(ServerWorldSeconds, 0.f) * 1000.f);
+	return static_cast<uint16>(Milliseconds & 0xFFFF);
+}
+
+float FAttackEvent::UnwrapTime(uint16 WrappedTime, float ServerWorldSeconds)
+{
+	const int64 Now = static_cast<int64>(FMath::Max(ServerWorldSeconds, 0.f) * 1000.f);
+
+	// the wrapped time closest to now
+	int64 Milliseconds = (Now & ~static_cast<int64>(0xFFFF)) | WrappedTime;
+	if (Milliseconds > Now + 0x8000)
+	{
+		Milliseconds -= 0x10000;
+	}
+	else if (Milliseconds < Now - 0x8000)
+	{
+		Milliseconds += 0x10000;
+	}
+	return Milliseconds / 1000.f;
+}
+
+bool FAttackEvent::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	uint32 Packed = 0;
+	if (Ar.IsSaving())
+	{
+		Packed = static_cast<uint32>(AttackType & ((1 << AttackTypeBits) - 1));
+		Packed |= static_cast<uint32>(SectionIndex & ((1 << SectionBits) - 1)) << AttackTypeBits;
+		Packed |= static_cast<uint32>(Counter & ((1 << CounterBits) - 1)) << (AttackTypeBits + SectionBits);
+		Packed |= static_cast<uint32>(StartTime) << (AttackTypeBits + SectionBits + CounterBits);
+	}
+
+	Ar.SerializeBits(&Packed, GetSerializedBits());
+
+	if (Ar.IsLoading())
+	{
+		AttackType = static_cast<uint8>(Packed & ((1 << AttackTypeBits) - 1));
+		SectionIndex = static_cast<uint8>((Packed >> AttackTypeBits) & ((1 << SectionBits) - 1));
+		Counter = static_cast<uint8>((Packed >> (AttackTypeBits + SectionBits)) & ((1 << CounterBits) - 1));
+		StartTime = static_cast<uint16>(Packed >> (AttackTypeBits + SectionBits + CounterBits));
+	}
+
+	bOutSuccess = !Ar.IsError();
+	return true;
+}
@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Class.h"
+
+#include "AttackCatalogue.h"
+
+#include "AttackEvent.generated.h"
+
+
+/**
+ * An attack started on the server, replicated instead of montage state.
+ *
+ * Serialized in 28 bits: attack type, montage section, a rolling counter so the
+ * same attack twice in a row still replicates, and the server time the attack
+ * started in milliseconds wrapped to 16 bits (unwrapped against the receiver's
+ * estimate of server time, good for 32 seconds either way).
+ */
+USTRUCT()
+struct ACTIONGAME_API FAttackEvent
+{
+	GENERATED_BODY()
+
+	static const int32 AttackTypeBits = 3;
+	static const int32 SectionBits = 5;
+	static const int32 CounterBits = 4;
+	static const int32 StartTimeBits = 16;
+
+	/** sections past this cannot be replicated **/
+	static const int32 MaxSections = 1 << SectionBits;
+
+	UPROPERTY()
+	uint8 AttackType;
+
+	/** index into the compiled attack's section names **/
+	UPROPERTY()
+	uint8 SectionIndex;
+
+	UPROPERTY()
+	uint8 Counter;
+
+	/** server world time in milliseconds, wrapped **/
+	UPROPERTY()
+	uint16 StartTime;
+
+	FAttackEvent()
+		: AttackType(0)
+		, SectionIndex(0)
+		, Counter(0)
+		, StartTime(0)
+	{
+	}
+
+	FORCEINLINE EAttackType GetAttackType() const { return static_cast<EAttackType>(AttackType); }
+
+	void SetStartTime(float ServerWorldSeconds);
+
+	/** Returns the server time the attack started at, ServerWorldSeconds being the receiver's current estimate **/
+	float GetStartTime(float ServerWorldSeconds) const;
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+
+	/** Server time in milliseconds wrapped to 16 bits, and back against the receiver's estimate of server time **/
+	static uint16 WrapTime(float ServerWorldSeconds);
+	static float UnwrapTime(uint16 WrappedTime, float ServerWorldSeconds);
+
+	/** bits one event takes on the wire **/
+	static int32 GetSerializedBits() { return AttackTypeBits + SectionBits + CounterBits + StartTimeBits; }
+};
+
+template<>
+struct TStructOpsTypeTraits<FAttackEvent> : public TStructOpsTypeTraitsBase2<FAttackEvent>
+{
+	enum
+	{
+		WithNetSerializer = true,
+	};
+};
@@ -0,0 +1,174 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CombatAIController.h"
+#include "ActionGameCharacter.h"
+#include "CombatAIScheduler.h"
+#include "CombatManager.h"
+#include "Components/CapsuleComponent.h"
+#include "Engine/CollisionProfile.h"
+
+
+namespace
+{
+	const FName EnemyCollisionProfile(TEXT("Enemy"));
+}
+
+
+ACombatAIController::ACombatAIController()
+{
+	// thinking and steering are run by the scheduler
+	PrimaryActorTick.bCanEverTick = false;
+
+	Team = 1;
+	AttackRange = 150.f;
+	SightRange = 3000.f;
+	RetreatDistance = 350.f;
+	RetreatSeconds = 0.8f;
+	KickChance = 0.3f;
+	EvadeChance = 0.4f;
+
+	State = ECombatAIState::IDLE;
+	MoveDirection = FVector::ZeroVector;
+	MoveScale = 0.f;
+	RetreatTimeLeft = 0.f;
+}
+
+void ACombatAIController::Possess(APawn* InPawn)
+{
+	Super::Possess(InPawn);
+
+	Fighter = Cast<AActionGameCharacter>(InPawn);
+	if (!Fighter.IsValid())
+	{
+		return;
+	}
+
+	Random.Initialize(static_cast<int32>(FPlatformTime::Cycles()) ^ GetUniqueID());
+	State = ECombatAIState::IDLE;
+	MoveScale = 0.f;
+
+	// enemies collide on their own channel when the project has it
+	UCapsuleComponent* Capsule = Fighter->GetCapsuleComponent();
+	PreviousCollisionProfile = Capsule->GetCollisionProfileName();
+	FCollisionResponseTemplate Template;
+	if (UCollisionProfile::Get()->GetProfileTemplate(EnemyCollisionProfile, Template))
+	{
+		Capsule->SetCollisionProfileName(EnemyCollisionProfile);
+	}
+
+	if (ACombatAIScheduler* Scheduler = ACombatAIScheduler::Get(this))
+	{
+		Scheduler->Register(this);
+	}
+}
+
+void ACombatAIController::UnPossess()
+{
+	if (ACombatAIScheduler* Scheduler = ACombatAIScheduler::Get(this))
+	{
+		Scheduler->Unregister(this);
+	}
+
+	if (Fighter.IsValid() && !PreviousCollisionProfile.IsNone())
+	{
+		Fighter->GetCapsuleComponent()->SetCollisionProfileName(PreviousCollisionProfile);
+	}
+	Fighter.Reset();
+
+	Super::UnPossess();
+}
+
+void ACombatAIController::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (ACombatAIScheduler* Scheduler = ACombatAIScheduler::Get(this))
+	{
+		Scheduler->Unregister(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void ACombatAIController::Think(const ACombatManager& CombatManager, float SecondsSinceThink)
+{
+	AActionGameCharacter* Character = Fighter.Get();
+	if (Character == nullptr || Character->IsDefeated())
+	{
+		State = ECombatAIState::IDLE;
+		MoveScale = 0.f;
+		return;
+	}
+
+	// the nearest fighter of another team in sight, without a direction the grid search scores by distance alone
+	const FVector Location = Character->GetActorLocation();
+	const AActionGameCharacter* Target = CombatManager.FindTarget(Location, FVector::ZeroVector, SightRange, -1.f, Team, Character);
+	if (Target == nullptr)
+	{
+		State = ECombatAIState::IDLE;
+		MoveScale = 0.f;
+		return;
+	}
+
+	const FVector TargetLocation = Target->GetActorLocation();
+	const float Distance = FVector::Dist2D(TargetLocation, Location);
+	const FVector ToTarget = (TargetLocation - Location).GetSafeNormal2D();
+	const bool bTargetAttacking = Target->GetCombatantId() != INDEX_NONE && CombatManager.IsAttackWindowOpen(Target->GetCombatantId());
+
+	// back off once the attack is out
+	if (State == ECombatAIState::ATTACK)
+	{
+		State = ECombatAIState::RETREAT;
+		RetreatTimeLeft = RetreatSeconds;
+	}
+
+	if (State == ECombatAIState::RETREAT)
+	{
+		RetreatTimeLeft -= SecondsSinceThink;
+		if (RetreatTimeLeft > 0.f && Distance < RetreatDistance)
+		{
+			MoveDirection = -ToTarget;
+			MoveScale = 1.f;
+			return;
+		}
+	}
+
+	if (bTargetAttacking && Distance < AttackRange * 1.5f && State != ECombatAIState::RETREAT && Random.FRand() < EvadeChance)
+	{
+		// step out of the swing
+		State = ECombatAIState::RETREAT;
+		RetreatTimeLeft = RetreatSeconds * 0.5f;
+		MoveDirection = -ToTarget;
+		MoveScale = 1.f;
+	}
+	else if (Distance > AttackRange)
+	{
+		State = ECombatAIState::APPROACH;
+		MoveDirection = ToTarget;
+		MoveScale = 1.f;
+	}
+	else
+	{
+		State = ECombatAIState::ATTACK;
+		MoveScale = 0.f;
+
+		Character->SetActorRotation(FRotator(0.f, ToTarget.Rotation().Yaw, 0.f));
+		if (Random.FRand() < KickChance)
+		{
+			Character->KickInput();
+		}
+		else
+		{
+			Character->PunchInput();
+		}
+	}
+}
+
+void ACombatAIController::Steer()
+{
+	if (MoveScale > 0.f)
+	{
+		if (AActionGameCharacter* Character = Fighter.Get())
+		{
+			Character->AddMovementInput(MoveDirection, MoveScale);
+		}
+	}
+}
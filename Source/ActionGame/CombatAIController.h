@@ -0,0 +1,95 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Controller.h"
+
+#include "CombatAIController.generated.h"
+
+class AActionGameCharacter;
+class ACombatManager;
+
+
+UENUM(BlueprintType)
+enum class ECombatAIState : uint8 {
+	IDLE		UMETA(DisplayName = "Idle"),
+	APPROACH	UMETA(DisplayName = "Approach"),
+	ATTACK		UMETA(DisplayName = "Attack"),
+	RETREAT		UMETA(DisplayName = "Retreat")
+};
+
+
+/**
+ * Enemy fighter controlling an AActionGameCharacter.
+ *
+ * Closes in on the nearest fighter of another team, punches or kicks once in
+ * range and backs off after attacking or when the target swings first. The
+ * controller never ticks: the combat AI scheduler calls Think under its frame
+ * budget, less often the further the enemy is from a player, and Steer every
+ * frame to keep following the last decision.
+ */
+UCLASS(NotBlueprintable)
+class ACTIONGAME_API ACombatAIController : public AController
+{
+	GENERATED_BODY()
+
+public:
+	ACombatAIController();
+
+	virtual void Possess(APawn* InPawn) override;
+	virtual void UnPossess() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/** Makes a decision against the fighters registered with CombatManager, SecondsSinceThink after the previous one **/
+	void Think(const ACombatManager& CombatManager, float SecondsSinceThink);
+
+	/** Follows the last decision, cheap enough for every frame **/
+	void Steer();
+
+	FORCEINLINE ECombatAIState GetState() const { return State; }
+
+	/** fighters of the same team never target each other, players are team 0 **/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = AI)
+	uint8 Team;
+
+	/** distance attacks are started from **/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = AI)
+	float AttackRange;
+
+	/** distance targets are noticed from **/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = AI)
+	float SightRange;
+
+	/** distance backed off to after an attack **/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = AI)
+	float RetreatDistance;
+
+	/** longest time spent backing off **/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = AI)
+	float RetreatSeconds;
+
+	/** chance of kicking rather than punching **/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = AI)
+	float KickChance;
+
+	/** chance of backing off when the target swings first **/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = AI)
+	float EvadeChance;
+
+private:
+	ECombatAIState State;
+
+	TWeakObjectPtr<AActionGameCharacter> Fighter;
+
+	/** movement input applied every frame until the next decision **/
+	FVector MoveDirection;
+	float MoveScale;
+
+	float RetreatTimeLeft;
+
+	FRandomStream Random;
+
+	/** capsule profile the character had before it became an enemy **/
+	FName PreviousCollisionProfile;
+};
@@ -0,0 +1,275 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CombatAIScheduler.h"
+#include "ActionGameCharacter.h"
+#include "ActionGameGameMode.h"
+#include "ActionGameLog.h"
+#include "CombatAIController.h"
+#include "CombatLatencyTracer.h"
+#include "CombatManager.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+
+
+DECLARE_CYCLE_STAT(TEXT("AI scheduler"), STAT_AIScheduler, STATGROUP_ActionGameCombat);
+DECLARE_CYCLE_STAT(TEXT("AI think"), STAT_AIThink, STATGROUP_ActionGameCombat);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("AI agents"), STAT_AIAgents, STATGROUP_ActionGameCombat);
+DECLARE_DWORD_COUNTER_STAT(TEXT("AI thinks"), STAT_AIThinks, STATGROUP_ActionGameCombat);
+DECLARE_DWORD_COUNTER_STAT(TEXT("AI agents overdue"), STAT_AIOverdue, STATGROUP_ActionGameCombat);
+
+namespace
+{
+	TMap<TWeakObjectPtr<UWorld>, TWeakObjectPtr<ACombatAIScheduler>> Schedulers;
+
+	float ThinkBudgetMilliseconds = 1.f;
+	FAutoConsoleVariableRef CVarAIBudget(TEXT("ActionGame.AI.BudgetMs"), ThinkBudgetMilliseconds, TEXT("Game thread time enemies may spend thinking per frame"));
+
+	float NearDistance = 1500.f;
+	FAutoConsoleVariableRef CVarAINearDistance(TEXT("ActionGame.AI.NearDistance"), NearDistance, TEXT("Distance to a player within which enemies think at the near interval"));
+
+	float FarDistance = 6000.f;
+	FAutoConsoleVariableRef CVarAIFarDistance(TEXT("ActionGame.AI.FarDistance"), FarDistance, TEXT("Distance to a player beyond which enemies think at the far interval"));
+
+	float NearThinkInterval = 0.1f;
+	FAutoConsoleVariableRef CVarAINearInterval(TEXT("ActionGame.AI.NearInterval"), NearThinkInterval, TEXT("Seconds between decisions of enemies near a player"));
+
+	float FarThinkInterval = 1.f;
+	FAutoConsoleVariableRef CVarAIFarInterval(TEXT("ActionGame.AI.FarInterval"), FarThinkInterval, TEXT("Seconds between decisions of enemies far from every player"));
+
+	FAutoConsoleCommandWithWorldAndArgs SpawnEnemiesCommand(
+		TEXT("ActionGame.AI.SpawnEnemies"),
+		TEXT("Spawns enemies in a ring around the first player. Usage: ActionGame.AI.SpawnEnemies [Count] [Radius]"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+		{
+			AActionGameGameMode* GameMode = World ? World->GetAuthGameMode<AActionGameGameMode>() : nullptr;
+			APlayerController* PlayerController = World ? World->GetFirstPlayerController() : nullptr;
+			if (GameMode == nullptr || GameMode->DefaultPawnClass == nullptr || !GameMode->DefaultPawnClass->IsChildOf(AActionGameCharacter::StaticClass()))
+			{
+				AG_LOG(Combat, WARNING, "Enemies can only be spawned on the server of an ActionGame game mode");
+				return;
+			}
+
+			const int32 Count = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 10;
+			const float Radius = Args.Num() > 1 ? FCString::Atof(*Args[1]) : 800.f;
+			const FVector Center = PlayerController && PlayerController->GetPawn() ? PlayerController->GetPawn()->GetActorLocation() : FVector(0.f, 0.f, 300.f);
+
+			for (int32 Index = 0; Index < Count; ++Index)
+			{
+				const float Angle = 2.f * PI * Index / Count;
+				const FVector Location = Center + FVector(FMath::Cos(Angle), FMath::Sin(Angle), 0.f) * Radius;
+				const FRotator Rotation(0.f, (Center - Location).Rotation().Yaw, 0.f);
+
+				AActionGameCharacter* Character = GameMode->AcquireCharacter(*GameMode->DefaultPawnClass, FTransform(Rotation, Location));
+				ACombatAIController* Controller = Character ? World->SpawnActor<ACombatAIController>() : nullptr;
+				if (Controller)
+				{
+					Controller->Possess(Character);
+				}
+			}
+		}));
+
+	FAutoConsoleCommandWithWorldAndArgs ClearEnemiesCommand(
+		TEXT("ActionGame.AI.ClearEnemies"),
+		TEXT("Returns every enemy to the character pool"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+		{
+			AActionGameGameMode* GameMode = World ? World->GetAuthGameMode<AActionGameGameMode>() : nullptr;
+			const ACombatAIScheduler* Scheduler = GameMode ? ACombatAIScheduler::Get(World) : nullptr;
+			if (Scheduler == nullptr)
+			{
+				return;
+			}
+
+			// releasing unpossesses, which unregisters from the scheduler
+			TArray<AActionGameCharacter*> Enemies;
+			for (const TWeakObjectPtr<ACombatAIController>& Controller : Scheduler->GetAgents())
+			{
+				if (AActionGameCharacter* Character = Controller.IsValid() ? Cast<AActionGameCharacter>(Controller->GetPawn()) : nullptr)
+				{
+					Enemies.Add(Character);
+				}
+			}
+			for (AActionGameCharacter* Character : Enemies)
+			{
+				GameMode->ReleaseCharacter(Character);
+			}
+		}));
+}
+
+
+ACombatAIScheduler::ACombatAIScheduler()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	// decide before the movement components consume this frame's input
+	PrimaryActorTick.TickGroup = TG_PrePhysics;
+
+	SetReplicates(false);
+
+	NextAgent = 0;
+}
+
+ACombatAIScheduler* ACombatAIScheduler::Get(const UObject* WorldContextObject)
+{
+	UWorld* World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull);
+	if (World == nullptr || !World->IsGameWorld() || World->bIsTearingDown)
+	{
+		return nullptr;
+	}
+
+	TWeakObjectPtr<ACombatAIScheduler>& Scheduler = Schedulers.FindOrAdd(World);
+	if (!Scheduler.IsValid())
+	{
+		FActorSpawnParameters SpawnParameters;
+		SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		SpawnParameters.ObjectFlags |= RF_Transient;
+
+		Scheduler = World->SpawnActor<ACombatAIScheduler>(SpawnParameters);
+	}
+	return Scheduler.Get();
+}
+
+void ACombatAIScheduler::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	Schedulers.Remove(GetWorld());
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void ACombatAIScheduler::Register(ACombatAIController* Controller)
+{
+	if (Controller == nullptr || Controllers.Contains(Controller))
+	{
+		return;
+	}
+
+	Controllers.Add(Controller);
+	// newcomers think on their first turn
+	SecondsSinceThink.Add(FLT_MAX);
+	ThinkIntervals.Add(NearThinkInterval);
+}
+
+void ACombatAIScheduler::Unregister(ACombatAIController* Controller)
+{
+	const int32 Index = Controllers.IndexOfByKey(Controller);
+	if (Index == INDEX_NONE)
+	{
+		return;
+	}
+
+	Controllers.RemoveAtSwap(Index, 1, false);
+	SecondsSinceThink.RemoveAtSwap(Index, 1, false);
+	ThinkIntervals.RemoveAtSwap(Index, 1, false);
+}
+
+void ACombatAIScheduler::Tick(float DeltaSeconds)
+{
+	SCOPE_CYCLE_COUNTER(STAT_AIScheduler);
+	Super::Tick(DeltaSeconds);
+
+	const int32 NumAgents = Controllers.Num();
+	SET_DWORD_STAT(STAT_AIAgents, NumAgents);
+	if (NumAgents == 0)
+	{
+		return;
+	}
+
+	GatherPlayerLocations();
+
+	// every enemy keeps moving on its last decision
+	for (int32 Agent = 0; Agent < NumAgents; ++Agent)
+	{
+		SecondsSinceThink[Agent] += DeltaSeconds;
+		if (ACombatAIController* Controller = Controllers[Agent].Get())
+		{
+			Controller->Steer();
+		}
+	}
+
+	// targets are found in the combat manager's grid
+	const ACombatManager* CombatManager = ACombatManager::Get(this);
+	if (CombatManager == nullptr)
+	{
+		return;
+	}
+
+	// due enemies think until the budget is spent, the rest go first next frame
+	const double Deadline = FPlatformTime::Seconds() + ThinkBudgetMilliseconds / 1000.0;
+	NextAgent = NextAgent < NumAgents ? NextAgent : 0;
+	int32 Visited = 0;
+	for (; Visited < NumAgents; ++Visited)
+	{
+		const int32 Agent = (NextAgent + Visited) % NumAgents;
+		if (SecondsSinceThink[Agent] < ThinkIntervals[Agent])
+		{
+			continue;
+		}
+
+		ACombatAIController* Controller = Controllers[Agent].Get();
+		if (Controller == nullptr)
+		{
+			continue;
+		}
+
+		{
+			SCOPE_CYCLE_COUNTER(STAT_AIThink);
+			Controller->Think(*CombatManager, FMath::Min(SecondsSinceThink[Agent], FarThinkInterval * 2.f));
+		}
+		INC_DWORD_STAT(STAT_AIThinks);
+
+		SecondsSinceThink[Agent] = 0.f;
+		const APawn* Pawn = Controller->GetPawn();
+		ThinkIntervals[Agent] = Pawn ? GetThinkInterval(Pawn->GetActorLocation()) : FarThinkInterval;
+
+		if (FPlatformTime::Seconds() >= Deadline)
+		{
+			++Visited;
+			break;
+		}
+	}
+	NextAgent = (NextAgent + Visited) % NumAgents;
+
+#if STATS
+	for (int32 Agent = 0; Agent < NumAgents; ++Agent)
+	{
+		if (SecondsSinceThink[Agent] > ThinkIntervals[Agent] * 2.f)
+		{
+			INC_DWORD_STAT(STAT_AIOverdue);
+		}
+	}
+#endif
+}
+
+void ACombatAIScheduler::GatherPlayerLocations()
+{
+	PlayerLocations.Reset();
+
+	UWorld* World = GetWorld();
+	for (FConstPlayerControllerIterator It = World->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* PlayerController = It->Get();
+		if (PlayerController && PlayerController->GetPawn())
+		{
+			PlayerLocations.Add(PlayerController->GetPawn()->GetActorLocation());
+		}
+	}
+}
+
+float ACombatAIScheduler::GetThinkInterval(const FVector& Location) const
+{
+	float NearestDistanceSquared = MAX_flt;
+	for (const FVector& PlayerLocation : PlayerLocations)
+	{
+		NearestDistanceSquared = FMath::Min(NearestDistanceSquared, FVector::DistSquared(PlayerLocation, Location));
+	}
+
+	// without players everyone thinks at the near interval, fights between enemies stay responsive
+	if (PlayerLocations.Num() == 0)
+	{
+		return NearThinkInterval;
+	}
+
+	const float Alpha = FMath::Clamp((FMath::Sqrt(NearestDistanceSquared) - NearDistance) / FMath::Max(FarDistance - NearDistance, 1.f), 0.f, 1.f);
+	return FMath::Lerp(NearThinkInterval, FarThinkInterval, Alpha);
+}
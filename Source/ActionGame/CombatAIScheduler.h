@@ -0,0 +1,62 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+
+#include "CombatAIScheduler.generated.h"
+
+class ACombatAIController;
+
+
+/**
+ * Time sliced update of every enemy controller.
+ *
+ * Each frame all enemies follow their last decision, then enemies whose think
+ * interval has passed make a new one, round robin from where the previous frame
+ * stopped, until the frame's budget is spent. The interval grows with distance
+ * to the nearest player, so enemies in the fight decide often and distant ones
+ * rarely, and the cost per frame stays flat however many enemies there are.
+ * Enemies look for targets in the combat manager's spatial grid, so a decision
+ * only reads the fighters within sight.
+ *
+ * Spawned on demand, one per game world.
+ */
+UCLASS(NotBlueprintable, Transient)
+class ACTIONGAME_API ACombatAIScheduler : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	ACombatAIScheduler();
+
+	/** Returns the AI scheduler of WorldContextObject's world, spawning it when needed **/
+	static ACombatAIScheduler* Get(const UObject* WorldContextObject);
+
+	virtual void Tick(float DeltaSeconds) override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	void Register(ACombatAIController* Controller);
+	void Unregister(ACombatAIController* Controller);
+
+	FORCEINLINE int32 GetNumAgents() const { return Controllers.Num(); }
+	FORCEINLINE const TArray<TWeakObjectPtr<ACombatAIController>>& GetAgents() const { return Controllers; }
+
+private:
+	void GatherPlayerLocations();
+
+	/** Think interval for an enemy at Location **/
+	float GetThinkInterval(const FVector& Location) const;
+
+	//========= AGENTS, ONE ENTRY EACH =========//
+
+	TArray<TWeakObjectPtr<ACombatAIController>> Controllers;
+	TArray<float> SecondsSinceThink;
+	TArray<float> ThinkIntervals;
+
+	/** agent the next frame starts thinking from **/
+	int32 NextAgent;
+
+	TArray<FVector> PlayerLocations;
+};
@@ -0,0 +1,249 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CombatAudioManager.h"
+#include "ActionGameLog.h"
+#include "Components/AudioComponent.h"
+#include "Sound/SoundBase.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "Engine/World.h"
+#include "Engine/Engine.h"
+
+
+namespace
+{
+	TMap<TWeakObjectPtr<UWorld>, TWeakObjectPtr<ACombatAudioManager>> CombatAudioManagers;
+
+	/** priority of each combat sound, impacts win over whooshes **/
+	const float SoundPriorities[] =
+	{
+		1.f,	// PUNCH_IMPACT
+		0.5f,	// PUNCH_THROW
+	};
+
+	static_assert(ARRAY_COUNT(SoundPriorities) == static_cast<uint8>(ECombatSound::MAX), "Every ECombatSound needs a priority");
+
+	int32 MaxVoices = 16;
+	FAutoConsoleVariableRef CVarAudioMaxVoices(TEXT("ActionGame.Audio.MaxVoices"), MaxVoices, TEXT("Voices in the combat sound pool"));
+
+	int32 MaxVoiceStartsPerFrame = 4;
+	FAutoConsoleVariableRef CVarAudioVoiceStartsPerFrame(TEXT("ActionGame.Audio.VoiceStartsPerFrame"), MaxVoiceStartsPerFrame, TEXT("Maximum combat sounds started per frame"));
+
+	int32 MaxVirtualSounds = 64;
+	FAutoConsoleVariableRef CVarAudioMaxVirtualSounds(TEXT("ActionGame.Audio.MaxVirtualSounds"), MaxVirtualSounds, TEXT("Maximum combat sounds kept virtual, the least important are dropped"));
+
+	float MaxAudibleDistance = 4000.f;
+	FAutoConsoleVariableRef CVarAudioMaxDistance(TEXT("ActionGame.Audio.MaxDistance"), MaxAudibleDistance, TEXT("Distance to the closest listener beyond which combat sounds are virtual"));
+}
+
+
+ACombatAudioManager::ACombatAudioManager()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	// start the sounds requested by this frame's hits and notifies
+	PrimaryActorTick.TickGroup = TG_PostUpdateWork;
+
+	SetReplicates(false);
+
+	RootComponent = CreateDefaultSubobject<USceneComponent>(TEXT("Root"));
+}
+
+ACombatAudioManager* ACombatAudioManager::Get(const UObject* WorldContextObject)
+{
+	UWorld* World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull);
+	if (World == nullptr || !World->IsGameWorld())
+	{
+		return nullptr;
+	}
+
+	TWeakObjectPtr<ACombatAudioManager>& AudioManager = CombatAudioManagers.FindOrAdd(World);
+	if (!AudioManager.IsValid())
+	{
+		FActorSpawnParameters SpawnParameters;
+		SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		SpawnParameters.ObjectFlags |= RF_Transient;
+
+		AudioManager = World->SpawnActor<ACombatAudioManager>(SpawnParameters);
+	}
+	return AudioManager.Get();
+}
+
+void ACombatAudioManager::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	CombatAudioManagers.Remove(GetWorld());
+
+	for (UAudioComponent* Voice : Voices)
+	{
+		if (Voice)
+		{
+			Voice->Stop();
+		}
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void ACombatAudioManager::PlaySound(USoundBase* Sound, const FVector& Location, ECombatSound Type, float PitchMultiplier)
+{
+	if (Sound == nullptr || Type >= ECombatSound::MAX)
+	{
+		return;
+	}
+
+	FSoundRequest& Request = PendingSounds[PendingSounds.AddUninitialized()];
+	Request.Sound = Sound;
+	Request.Location = Location;
+	Request.Priority = SoundPriorities[static_cast<uint8>(Type)];
+	Request.PitchMultiplier = PitchMultiplier;
+	Request.StartTime = GetWorld()->GetTimeSeconds();
+	Request.Duration = Sound->GetDuration();
+	Request.Score = 0.f;
+}
+
+void ACombatAudioManager::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	// dedicated servers and -nosound runs never play anything
+	UWorld* World = GetWorld();
+	if (World->GetAudioDevice() == nullptr || !GatherListeners())
+	{
+		PendingSounds.Reset();
+		VirtualSounds.Reset();
+		return;
+	}
+
+	const float Now = World->GetTimeSeconds();
+
+	// new requests compete with the virtual sounds that have not ended yet, sounds unloaded meanwhile are dropped
+	Candidates.Reset();
+	for (const FSoundRequest& Request : PendingSounds)
+	{
+		if (Request.Sound.IsValid())
+		{
+			Candidates.Add(Request);
+		}
+	}
+	PendingSounds.Reset();
+	for (const FSoundRequest& Request : VirtualSounds)
+	{
+		if (Now - Request.StartTime < Request.Duration && Request.Sound.IsValid())
+		{
+			Candidates.Add(Request);
+		}
+	}
+	VirtualSounds.Reset();
+
+	for (FSoundRequest& Request : Candidates)
+	{
+		Request.Score = ScoreRequest(Request);
+	}
+	Candidates.Sort([](const FSoundRequest& A, const FSoundRequest& B) { return A.Score > B.Score; });
+
+	int32 VoiceStarts = 0;
+	for (const FSoundRequest& Request : Candidates)
+	{
+		if (Request.Score > 0.f && VoiceStarts < MaxVoiceStartsPerFrame)
+		{
+			const int32 VoiceIndex = FindVoice(Request.Score);
+			if (VoiceIndex != INDEX_NONE)
+			{
+				StartVoice(VoiceIndex, Request, Now - Request.StartTime);
+				++VoiceStarts;
+				continue;
+			}
+		}
+
+		// candidates are sorted, the least important ones are dropped first
+		if (VirtualSounds.Num() < MaxVirtualSounds)
+		{
+			VirtualSounds.Add(Request);
+		}
+	}
+}
+
+bool ACombatAudioManager::GatherListeners()
+{
+	ListenerLocations.Reset();
+
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		APlayerController* PlayerController = It->Get();
+		if (PlayerController && PlayerController->IsLocalController())
+		{
+			FVector Location, FrontDirection, RightDirection;
+			PlayerController->GetAudioListenerPosition(Location, FrontDirection, RightDirection);
+			ListenerLocations.Add(Location);
+		}
+	}
+	return ListenerLocations.Num() > 0;
+}
+
+float ACombatAudioManager::ScoreRequest(const FSoundRequest& Request) const
+{
+	float ClosestDistanceSquared = MAX_FLT;
+	for (const FVector& ListenerLocation : ListenerLocations)
+	{
+		ClosestDistanceSquared = FMath::Min(ClosestDistanceSquared, FVector::DistSquared(ListenerLocation, Request.Location));
+	}
+
+	if (ClosestDistanceSquared >= FMath::Square(MaxAudibleDistance))
+	{
+		return 0.f;
+	}
+	return Request.Priority * (1.f - FMath::Sqrt(ClosestDistanceSquared) / MaxAudibleDistance);
+}
+
+int32 ACombatAudioManager::FindVoice(float Score)
+{
+	const int32 VoiceBudget = FMath::Max(MaxVoices, 1);
+
+	int32 StealIndex = INDEX_NONE;
+	float StealScore = Score;
+	for (int32 VoiceIndex = 0; VoiceIndex < Voices.Num() && VoiceIndex < VoiceBudget; ++VoiceIndex)
+	{
+		UAudioComponent* Voice = Voices[VoiceIndex];
+		if (!Voice->IsPlaying())
+		{
+			return VoiceIndex;
+		}
+		if (VoiceScores[VoiceIndex] < StealScore)
+		{
+			StealIndex = VoiceIndex;
+			StealScore = VoiceScores[VoiceIndex];
+		}
+	}
+
+	if (Voices.Num() < VoiceBudget)
+	{
+		UAudioComponent* Voice = NewObject<UAudioComponent>(this);
+		Voice->bAutoActivate = false;
+		Voice->bAutoDestroy = false;
+		Voice->bAllowSpatialization = true;
+		Voice->SetupAttachment(RootComponent);
+		Voice->SetAbsolute(true, true, true);
+		Voice->RegisterComponent();
+
+		VoiceScores.Add(0.f);
+		return Voices.Add(Voice);
+	}
+
+	// the least important voice is cut for a more important sound
+	if (StealIndex != INDEX_NONE)
+	{
+		AG_LOG(Audio, TRACE, "Combat audio: voice {} stolen", StealIndex);
+		Voices[StealIndex]->Stop();
+	}
+	return StealIndex;
+}
+
+void ACombatAudioManager::StartVoice(int32 VoiceIndex, const FSoundRequest& Request, float PlaybackTime)
+{
+	UAudioComponent* Voice = Voices[VoiceIndex];
+	VoiceScores[VoiceIndex] = Request.Score;
+
+	Voice->SetWorldLocation(Request.Location);
+	Voice->SetSound(Request.Sound.Get());
+	Voice->SetPitchMultiplier(Request.PitchMultiplier);
+	Voice->Play(FMath::Max(PlaybackTime, 0.f));
+}
@@ -0,0 +1,96 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+
+#include "CombatAudioManager.generated.h"
+
+class UAudioComponent;
+class USoundBase;
+
+
+UENUM(BlueprintType)
+enum class ECombatSound : uint8 {
+	PUNCH_IMPACT	UMETA(DisplayName = "Punch impact"),
+	PUNCH_THROW		UMETA(DisplayName = "Punch throw"),
+
+	MAX				UMETA(Hidden)
+};
+
+
+/**
+ * Shared voice pool for combat sounds.
+ *
+ * Characters request sounds instead of owning audio components. Requests are
+ * gathered over the frame and started once per tick by score (sound priority
+ * scaled down with distance to the closest listener), at most a few starts per
+ * frame and never more than the pool size. Sounds that are out of range or lose
+ * the competition for a voice are kept virtual and start at their current
+ * playback position if they become audible before they would have ended.
+ *
+ * Spawned on demand, one per game world. Does nothing without an audio device.
+ */
+UCLASS(NotBlueprintable, Transient)
+class ACTIONGAME_API ACombatAudioManager : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	ACombatAudioManager();
+
+	/** Returns the combat audio manager of WorldContextObject's world, spawning it when needed **/
+	static ACombatAudioManager* Get(const UObject* WorldContextObject);
+
+	virtual void Tick(float DeltaSeconds) override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/** Queues Sound at Location, it is started, virtualized or culled on the next tick **/
+	void PlaySound(USoundBase* Sound, const FVector& Location, ECombatSound Type, float PitchMultiplier = 1.f);
+
+	FORCEINLINE int32 GetNumVoices() const { return Voices.Num(); }
+	FORCEINLINE int32 GetNumVirtualSounds() const { return VirtualSounds.Num(); }
+
+private:
+	struct FSoundRequest
+	{
+		/** weak, move sets unload their cues once no character holds them and virtual sounds may outlive that **/
+		TWeakObjectPtr<USoundBase> Sound;
+		FVector Location;
+		float Priority;
+		float PitchMultiplier;
+
+		/** world time the sound was requested at and its length **/
+		float StartTime;
+		float Duration;
+
+		/** priority after distance attenuation, 0 when out of range **/
+		float Score;
+	};
+
+	bool GatherListeners();
+	float ScoreRequest(const FSoundRequest& Request) const;
+
+	/** returns the voice Request should play on, INDEX_NONE when every voice plays something more important **/
+	int32 FindVoice(float Score);
+
+	void StartVoice(int32 VoiceIndex, const FSoundRequest& Request, float PlaybackTime);
+
+	/** pooled voices, grown up to the voice budget **/
+	UPROPERTY()
+	TArray<UAudioComponent*> Voices;
+
+	/** score of the sound each voice plays **/
+	TArray<float> VoiceScores;
+
+	/** requested this frame **/
+	TArray<FSoundRequest> PendingSounds;
+
+	/** logically playing without a voice **/
+	TArray<FSoundRequest> VirtualSounds;
+
+	/** reused by the tick **/
+	TArray<FSoundRequest> Candidates;
+	TArray<FVector, TInlineAllocator<4>> ListenerLocations;
+};
@@ -0,0 +1,460 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CombatBenchmark.h"
+#include "ActionGame.h"
+#include "ActionGameCharacter.h"
+#include "ActionGameGameMode.h"
+#include "ActionGameLog.h"
+#include "CombatAIController.h"
+#include "CombatManager.h"
+#include "CombatStatistics.h"
+#include "EngineUtils.h"
+#include "Engine/World.h"
+#include "GameFramework/GameModeBase.h"
+#include "GameFramework/PlayerStart.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformMemory.h"
+#include "Misc/App.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Policies/PrettyJsonPrintPolicy.h"
+#include "Serialization/JsonWriter.h"
+
+
+namespace
+{
+	FAutoConsoleCommandWithWorldAndArgs BenchmarkCommand(
+		TEXT("ActionGame.Benchmark"),
+		TEXT("Runs the combat benchmark. Usage: ActionGame.Benchmark [Counts, e.g. 10,100,500] [Frames]"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+		{
+			FString Params = TEXT("-NoQuit");
+			if (Args.Num() > 0)
+			{
+				Params += FString::Printf(TEXT(" -Counts=%s"), *Args[0]);
+			}
+			if (Args.Num() > 1)
+			{
+				Params += FString::Printf(TEXT(" -Frames=%s"), *Args[1]);
+			}
+			ACombatBenchmark::Start(World, *Params);
+		}));
+}
+
+
+ACombatBenchmark::ACombatBenchmark()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.TickGroup = TG_PrePhysics;
+
+	WarmupFrames = 120;
+	MeasureFrames = 600;
+	bQuitWhenDone = true;
+	bUsePool = false;
+	bUseAI = false;
+	TargetQueryRadius = 500.f;
+	ProjectileCount = 0;
+
+	Stage = EStage::Spawn;
+	RunIndex = 0;
+	StageFrame = 0;
+	LastFrameTime = 0.0;
+	HitCountAtStart = 0;
+	MemoryBeforeSpawn = 0;
+}
+
+ACombatBenchmark* ACombatBenchmark::Start(UWorld* World, const TCHAR* Params)
+{
+	if (World == nullptr || !World->IsGameWorld())
+	{
+		return nullptr;
+	}
+
+	ACombatBenchmark* Benchmark = World->SpawnActor<ACombatBenchmark>();
+	if (Benchmark == nullptr)
+	{
+		return nullptr;
+	}
+
+	FString Counts = TEXT("10,100,500,1000");
+	FParse::Value(Params, TEXT("Counts="), Counts);
+
+	TArray<FString> CountStrings;
+	Counts.ParseIntoArray(CountStrings, TEXT(","));
+	for (const FString& CountString : CountStrings)
+	{
+		Benchmark->CharacterCounts.Add(FMath::Max(FCString::Atoi(*CountString), 1));
+	}
+
+	FParse::Value(Params, TEXT("Frames="), Benchmark->MeasureFrames);
+	FParse::Value(Params, TEXT("WarmupFrames="), Benchmark->WarmupFrames);
+	FParse::Value(Params, TEXT("TargetRadius="), Benchmark->TargetQueryRadius);
+	FParse::Value(Params, TEXT("Projectiles="), Benchmark->ProjectileCount);
+	Benchmark->ProjectileCount = FMath::Clamp(Benchmark->ProjectileCount, 0, ACombatManager::MaxProjectiles);
+	Benchmark->bQuitWhenDone = !FParse::Param(Params, TEXT("NoQuit"));
+	Benchmark->bUsePool = FParse::Param(Params, TEXT("Pooled"));
+	Benchmark->bUseAI = FParse::Param(Params, TEXT("AI"));
+
+	if (!FParse::Value(Params, TEXT("BenchmarkOutput="), Benchmark->OutputPath))
+	{
+		Benchmark->OutputPath = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Benchmarks"), FString::Printf(TEXT("CombatBenchmark-%s.json"), *FDateTime::Now().ToString()));
+	}
+
+	// the game's pawn when it is a combat character, the native class otherwise
+	AGameModeBase* GameMode = World->GetAuthGameMode();
+	if (GameMode && GameMode->DefaultPawnClass && GameMode->DefaultPawnClass->IsChildOf(AActionGameCharacter::StaticClass()))
+	{
+		Benchmark->CharacterClass = *GameMode->DefaultPawnClass;
+	}
+	else
+	{
+		Benchmark->CharacterClass = AActionGameCharacter::StaticClass();
+	}
+
+	AG_LOG(Combat, INFO, "Combat benchmark started, {} runs of {} frames", Benchmark->CharacterCounts.Num(), Benchmark->MeasureFrames);
+	return Benchmark;
+}
+
+void ACombatBenchmark::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	DestroyCharacters();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void ACombatBenchmark::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	const double Now = FPlatformTime::Seconds();
+	const float FrameMilliseconds = LastFrameTime > 0.0 ? static_cast<float>((Now - LastFrameTime) * 1000.0) : 0.f;
+	LastFrameTime = Now;
+
+	ACombatManager* CombatManager = ACombatManager::Get(this);
+
+	switch (Stage)
+	{
+	case EStage::Spawn:
+	{
+		if (RunIndex >= CharacterCounts.Num())
+		{
+			Stage = EStage::Done;
+			break;
+		}
+
+		MemoryBeforeSpawn = FPlatformMemory::GetStats().UsedPhysical;
+		const AActionGameGameMode* GameMode = GetWorld()->GetAuthGameMode<AActionGameGameMode>();
+		const uint32 PoolHitsBefore = GameMode ? GameMode->GetPoolHits() : 0;
+		const double SpawnStart = FPlatformTime::Seconds();
+		SpawnCharacters(CharacterCounts[RunIndex]);
+
+		Results.AddDefaulted();
+		Results.Last().CharacterCount = Characters.Num();
+		Results.Last().SpawnMilliseconds = static_cast<float>((FPlatformTime::Seconds() - SpawnStart) * 1000.0);
+		Results.Last().PooledCount = bUsePool && GameMode ? static_cast<int32>(GameMode->GetPoolHits() - PoolHitsBefore) : 0;
+		Stage = EStage::Warmup;
+		StageFrame = 0;
+		break;
+	}
+
+	case EStage::Warmup:
+		DriveCharacters();
+		LaunchProjectiles(CombatManager);
+		if (++StageFrame >= WarmupFrames)
+		{
+			FRunResult& Result = Results.Last();
+			Result.MemoryBytes = static_cast<int64>(FPlatformMemory::GetStats().UsedPhysical) - static_cast<int64>(MemoryBeforeSpawn);
+			Result.FrameMilliseconds.Reserve(MeasureFrames);
+			Result.GameThreadMilliseconds.Reserve(MeasureFrames);
+			Result.TargetQueryMicroseconds.Reserve(MeasureFrames);
+			Result.ProjectileUpdateMicroseconds.Reserve(MeasureFrames);
+			Result.ProjectilesInFlight.Reserve(MeasureFrames);
+			Result.MeasuredSeconds = 0.0;
+			HitCountAtStart = CombatManager ? CombatManager->GetHitCount() : 0;
+
+			Stage = EStage::Measure;
+			StageFrame = 0;
+		}
+		break;
+
+	case EStage::Measure:
+	{
+		FRunResult& Result = Results.Last();
+		Result.FrameMilliseconds.Add(FrameMilliseconds);
+		Result.GameThreadMilliseconds.Add(static_cast<float>(FPlatformTime::ToMilliseconds(GGameThreadTime)));
+		Result.MeasuredSeconds += FrameMilliseconds / 1000.0;
+
+		DriveCharacters();
+		MeasureTargetQueries(Result, CombatManager);
+		if (CombatManager && ProjectileCount > 0)
+		{
+			// the update that ran last frame, then the pool topped up for the next one
+			Result.ProjectileUpdateMicroseconds.Add(CombatManager->GetProjectileUpdateMicroseconds());
+			Result.ProjectilesInFlight.Add(static_cast<float>(CombatManager->GetNumProjectiles()));
+			LaunchProjectiles(CombatManager);
+		}
+		if (++StageFrame >= MeasureFrames)
+		{
+			Result.HitCount = (CombatManager ? CombatManager->GetHitCount() : 0) - HitCountAtStart;
+
+			AG_LOG(Combat, INFO, "Combat benchmark: {} characters, p50 frame {} ms, p50 target query {} us", Result.CharacterCount, FCombatStatistics::GetPercentile(Result.FrameMilliseconds, 0.5f), FCombatStatistics::GetPercentile(Result.TargetQueryMicroseconds, 0.5f));
+
+			DestroyCharacters();
+			Stage = EStage::Cleanup;
+			StageFrame = 0;
+		}
+		break;
+	}
+
+	case EStage::Cleanup:
+		// give garbage collection a few frames before the next wave
+		if (StageFrame++ == 0)
+		{
+			GetWorld()->ForceGarbageCollection(true);
+		}
+		else if (StageFrame > 10)
+		{
+			++RunIndex;
+			Stage = EStage::Spawn;
+		}
+		break;
+
+	case EStage::Done:
+		WriteReport();
+		SetActorTickEnabled(false);
+		if (bQuitWhenDone)
+		{
+			FPlatformMisc::RequestExit(false);
+		}
+		else
+		{
+			Destroy();
+		}
+		break;
+	}
+}
+
+void ACombatBenchmark::SpawnCharacters(int32 Count)
+{
+	UWorld* World = GetWorld();
+
+	FVector Origin(0.f, 0.f, 300.f);
+	for (TActorIterator<APlayerStart> It(World); It; ++It)
+	{
+		Origin = It->GetActorLocation();
+		break;
+	}
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+
+	AActionGameGameMode* GameMode = bUsePool ? World->GetAuthGameMode<AActionGameGameMode>() : nullptr;
+
+	// pairs facing each other so the attacks connect, pairs laid out on a square grid
+	const float PairSpacing = 100.f;
+	const float GridSpacing = 300.f;
+	const int32 PairsPerRow = FMath::Max(FMath::CeilToInt(FMath::Sqrt(Count / 2.f)), 1);
+
+	Characters.Reserve(Count);
+	for (int32 Index = 0; Index < Count; ++Index)
+	{
+		const int32 Pair = Index / 2;
+		const bool bSecondOfPair = (Index % 2) == 1;
+
+		const FVector Location = Origin + FVector((Pair % PairsPerRow) * GridSpacing + (bSecondOfPair ? PairSpacing : 0.f), (Pair / PairsPerRow) * GridSpacing, 0.f);
+		const FRotator Rotation(0.f, bSecondOfPair ? 180.f : 0.f, 0.f);
+
+		AActionGameCharacter* Character = GameMode
+			? GameMode->AcquireCharacter(CharacterClass, FTransform(Rotation, Location))
+			: World->SpawnActor<AActionGameCharacter>(CharacterClass, Location, Rotation, SpawnParameters);
+		if (Character)
+		{
+			if (bUseAI)
+			{
+				// alternating teams, each pair fights
+				if (ACombatAIController* Controller = World->SpawnActor<ACombatAIController>())
+				{
+					Controller->Team = 1 + Index % 2;
+					Controller->Possess(Character);
+				}
+			}
+			else
+			{
+				// an AI controller makes the character movement consume the scripted input
+				Character->SpawnDefaultController();
+			}
+			// same attack sections on every run of the same wave
+			Character->SetAttackRandomSeed(Index);
+			Characters.Add(Character);
+		}
+	}
+}
+
+void ACombatBenchmark::DestroyCharacters()
+{
+	// pooled waves hand their characters back for the next wave
+	AActionGameGameMode* GameMode = bUsePool ? GetWorld()->GetAuthGameMode<AActionGameGameMode>() : nullptr;
+
+	for (AActionGameCharacter* Character : Characters)
+	{
+		if (GameMode)
+		{
+			GameMode->ReleaseCharacter(Character);
+		}
+		else if (Character && !Character->IsPendingKill())
+		{
+			if (AController* Controller = Character->GetController())
+			{
+				Controller->Destroy();
+			}
+			Character->Destroy();
+		}
+	}
+	Characters.Reset();
+}
+
+void ACombatBenchmark::DriveCharacters()
+{
+	if (bUseAI)
+	{
+		return;
+	}
+
+	// every character follows the same script, offset in time by its index
+	for (int32 Index = 0; Index < Characters.Num(); ++Index)
+	{
+		AActionGameCharacter* Character = Characters[Index];
+		if (Character == nullptr)
+		{
+			continue;
+		}
+
+		const int32 Phase = StageFrame + Index * 7;
+		if (Phase % 45 == 0)
+		{
+			Character->PunchInput();
+		}
+		else if (Phase % 90 == 30)
+		{
+			Character->KickInput();
+		}
+
+		// step in and out of range
+		const float Step = FMath::Sin(Phase * 0.05f) * 0.5f;
+		Character->AddMovementInput(Character->GetActorForwardVector(), Step);
+	}
+}
+
+void ACombatBenchmark::MeasureTargetQueries(FRunResult& Result, const ACombatManager* CombatManager) const
+{
+	if (CombatManager == nullptr || Characters.Num() == 0)
+	{
+		return;
+	}
+
+	// a fixed batch per frame, from characters spread over the wave, so waves compare per query
+	const int32 QueriesPerFrame = 64;
+
+	// a team nobody is on, every character in range is a candidate the query scores
+	const uint8 QueryTeam = MAX_uint8;
+
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+	for (int32 Query = 0; Query < QueriesPerFrame; ++Query)
+	{
+		const AActionGameCharacter* Character = Characters[(StageFrame * QueriesPerFrame + Query) % Characters.Num()];
+		if (Character)
+		{
+			CombatManager->FindTarget(Character->GetActorLocation(), Character->GetActorForwardVector(), TargetQueryRadius, -1.f, QueryTeam, Character);
+		}
+	}
+	Result.TargetQueryMicroseconds.Add(static_cast<float>(FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles) * 1000.0 / QueriesPerFrame));
+}
+
+void ACombatBenchmark::LaunchProjectiles(ACombatManager* CombatManager)
+{
+	if (CombatManager == nullptr || Characters.Num() == 0)
+	{
+		return;
+	}
+
+	// up and away over the wave, so they fly their whole life rather than end on the first character
+	const float Speed = 1500.f;
+	const float Lifetime = 1.f;
+	for (int32 Launch = CombatManager->GetNumProjectiles(), Index = StageFrame; Launch < ProjectileCount; ++Launch, ++Index)
+	{
+		const AActionGameCharacter* Character = Characters[Index % Characters.Num()];
+		if (Character && Character->GetCombatantId() != INDEX_NONE)
+		{
+			const FVector Direction = (Character->GetActorForwardVector() + FVector(0.f, 0.f, 1.f)).GetSafeNormal();
+			CombatManager->LaunchProjectile(Character->GetCombatantId(), Character->GetActorLocation(), Direction * Speed, 15.f, 0.f, Lifetime, nullptr);
+		}
+	}
+}
+
+void ACombatBenchmark::WriteReport() const
+{
+	FString Json;
+	TSharedRef<TJsonWriter<TCHAR, TPrettyJsonPrintPolicy<TCHAR>>> Writer = TJsonWriterFactory<TCHAR, TPrettyJsonPrintPolicy<TCHAR>>::Create(&Json);
+
+	Writer->WriteObjectStart();
+
+	FCombatStatistics::WriteBuild(Writer);
+
+	Writer->WriteValue(TEXT("map"), GetWorld()->GetMapName());
+	Writer->WriteValue(TEXT("character_class"), CharacterClass ? CharacterClass->GetPathName() : FString());
+	Writer->WriteValue(TEXT("warmup_frames"), WarmupFrames);
+	Writer->WriteValue(TEXT("measure_frames"), MeasureFrames);
+	Writer->WriteValue(TEXT("pooled"), bUsePool);
+	Writer->WriteValue(TEXT("ai"), bUseAI);
+	Writer->WriteValue(TEXT("presentation"), FActionGameProfile::HasPresentation());
+	Writer->WriteValue(TEXT("target_query_radius"), TargetQueryRadius);
+	Writer->WriteValue(TEXT("projectiles"), ProjectileCount);
+
+	Writer->WriteArrayStart(TEXT("runs"));
+	for (const FRunResult& Result : Results)
+	{
+		const float AverageGameThreadMilliseconds = FCombatStatistics::GetAverage(Result.GameThreadMilliseconds);
+
+		Writer->WriteObjectStart();
+		Writer->WriteValue(TEXT("characters"), Result.CharacterCount);
+		Writer->WriteValue(TEXT("frames"), Result.FrameMilliseconds.Num());
+		Writer->WriteValue(TEXT("spawn_ms"), Result.SpawnMilliseconds);
+		Writer->WriteValue(TEXT("characters_from_pool"), Result.PooledCount);
+		FCombatStatistics::WriteDistribution(Writer, TEXT("frame_ms"), Result.FrameMilliseconds);
+		FCombatStatistics::WriteDistribution(Writer, TEXT("game_thread_ms"), Result.GameThreadMilliseconds);
+		FCombatStatistics::WriteDistribution(Writer, TEXT("target_query_us"), Result.TargetQueryMicroseconds);
+		if (Result.ProjectileUpdateMicroseconds.Num() > 0)
+		{
+			FCombatStatistics::WriteDistribution(Writer, TEXT("projectile_update_us"), Result.ProjectileUpdateMicroseconds);
+			Writer->WriteValue(TEXT("projectiles_in_flight"), FCombatStatistics::GetAverage(Result.ProjectilesInFlight));
+		}
+		Writer->WriteValue(TEXT("game_thread_us_per_character"), Result.CharacterCount > 0 ? AverageGameThreadMilliseconds * 1000.f / Result.CharacterCount : 0.f);
+		Writer->WriteValue(TEXT("hits"), static_cast<int64>(Result.HitCount));
+		Writer->WriteValue(TEXT("hits_per_second"), Result.MeasuredSeconds > 0.0 ? Result.HitCount / Result.MeasuredSeconds : 0.0);
+		Writer->WriteValue(TEXT("memory_bytes_per_character"), Result.CharacterCount > 0 ? Result.MemoryBytes / Result.CharacterCount : 0);
+		Writer->WriteObjectEnd();
+	}
+	Writer->WriteArrayEnd();
+
+	// over every run, a press that waited for its combo transition shows up here
+	if (const ACombatManager* CombatManager = ACombatManager::Get(this))
+	{
+		Writer->WriteObjectStart(TEXT("input_buffer"));
+		FCombatStatistics::WriteDistribution(Writer, TEXT("wait_ms"), CombatManager->GetBufferedInputWaits());
+		Writer->WriteValue(TEXT("expired"), static_cast<int64>(CombatManager->GetBufferedInputsExpired()));
+		Writer->WriteObjectEnd();
+	}
+
+	Writer->WriteObjectEnd();
+	Writer->Close();
+
+	if (FFileHelper::SaveStringToFile(Json, *OutputPath))
+	{
+		AG_LOG(Combat, INFO, "Combat benchmark report written to {}", OutputPath);
+	}
+	else
+	{
+		AG_LOG(Combat, ERROR, "Combat benchmark could not write {}", OutputPath);
+	}
+}
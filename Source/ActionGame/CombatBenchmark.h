@@ -0,0 +1,131 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+
+#include "CombatBenchmark.generated.h"
+
+class AActionGameCharacter;
+
+
+/**
+ * Headless combat stress test.
+ *
+ * Spawns waves of characters, drives scripted movement, punches and kicks and
+ * measures frame time, game thread cost, hit rate and memory per character.
+ * Every measured frame also times a fixed batch of target queries against the
+ * combat manager's spatial grid, their cost per query should not grow with the
+ * wave. With -Projectiles=N the wave keeps N projectiles in flight and the
+ * combat manager's cost of moving them is reported per frame.
+ * With -Pooled the waves come out of the game mode's character pool, compare
+ * the spawn time of each wave against a run without it. With -AI the characters
+ * fight each other under the combat AI scheduler instead of the script.
+ * With -ServerProfile the characters are built and animated as on a dedicated
+ * server, compare game_thread_us_per_character against a run without it.
+ * Results are written as JSON to Saved/Benchmarks.
+ *
+ * Run with
+ *     ActionGame -nullrhi -unattended -CombatBenchmark [-Counts=10,100,500,1000] [-Frames=600] [-WarmupFrames=120] [-TargetRadius=500] [-Projectiles=0] [-BenchmarkOutput=<file>] [-Pooled] [-AI] [-ServerProfile] [-NoQuit]
+ * or from the console with "ActionGame.Benchmark 10,100,500,1000".
+ */
+UCLASS(NotBlueprintable, Transient)
+class ACTIONGAME_API ACombatBenchmark : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	ACombatBenchmark();
+
+	/** Spawns a benchmark in World configured from Params (command line style) **/
+	static ACombatBenchmark* Start(UWorld* World, const TCHAR* Params);
+
+	virtual void Tick(float DeltaSeconds) override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/** number of characters of each run **/
+	TArray<int32> CharacterCounts;
+
+	/** frames run before measuring a wave **/
+	int32 WarmupFrames;
+
+	/** frames measured per wave **/
+	int32 MeasureFrames;
+
+	/** JSON report file **/
+	FString OutputPath;
+
+	/** exit the game once the report is written **/
+	bool bQuitWhenDone;
+
+	/** waves are taken from and returned to the game mode's character pool **/
+	bool bUsePool;
+
+	/** characters are driven by enemy AI controllers, two teams, instead of the script **/
+	bool bUseAI;
+
+	/** radius of the timed target queries **/
+	float TargetQueryRadius;
+
+	/** projectiles kept in flight by the wave **/
+	int32 ProjectileCount;
+
+	UPROPERTY()
+	TSubclassOf<AActionGameCharacter> CharacterClass;
+
+private:
+	enum class EStage : uint8 { Spawn, Warmup, Measure, Cleanup, Done };
+
+	struct FRunResult
+	{
+		int32 CharacterCount;
+		TArray<float> FrameMilliseconds;
+		TArray<float> GameThreadMilliseconds;
+
+		/** average cost of one target query, per frame **/
+		TArray<float> TargetQueryMicroseconds;
+
+		/** combat manager cost of the projectile update and projectiles in flight, per frame **/
+		TArray<float> ProjectileUpdateMicroseconds;
+		TArray<float> ProjectilesInFlight;
+
+		uint64 HitCount;
+		double MeasuredSeconds;
+		int64 MemoryBytes;
+
+		/** time the wave took to spawn, and how many of its characters were reused **/
+		float SpawnMilliseconds;
+		int32 PooledCount;
+
+		FRunResult()
+			: CharacterCount(0)
+			, HitCount(0)
+			, MeasuredSeconds(0.0)
+			, MemoryBytes(0)
+			, SpawnMilliseconds(0.f)
+			, PooledCount(0)
+		{
+		}
+	};
+
+	void SpawnCharacters(int32 Count);
+	void DestroyCharacters();
+	void DriveCharacters();
+	void MeasureTargetQueries(FRunResult& Result, const class ACombatManager* CombatManager) const;
+	void LaunchProjectiles(class ACombatManager* CombatManager);
+	void WriteReport() const;
+
+	UPROPERTY()
+	TArray<AActionGameCharacter*> Characters;
+
+	TArray<FRunResult> Results;
+
+	EStage Stage;
+	int32 RunIndex;
+	int32 StageFrame;
+
+	double LastFrameTime;
+	uint64 HitCountAtStart;
+	uint64 MemoryBeforeSpawn;
+};
@@ -0,0 +1,92 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CombatDebugDraw.h"
+
+#if COMBAT_DEBUG_DRAW
+
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+
+
+namespace
+{
+	int32 DrawHitboxes = 0;
+	FAutoConsoleVariableRef CVarDrawHitboxes(TEXT("ActionGame.Debug.Hitboxes"), DrawHitboxes, TEXT("Draw the limb boxes that can hit right now"));
+
+	int32 DrawSweeps = 0;
+	FAutoConsoleVariableRef CVarDrawSweeps(TEXT("ActionGame.Debug.Sweeps"), DrawSweeps, TEXT("Draw the path each limb sweep covered this frame, red when it found something"));
+
+	int32 DrawWindows = 0;
+	FAutoConsoleVariableRef CVarDrawWindows(TEXT("ActionGame.Debug.Windows"), DrawWindows, TEXT("Draw a bar over each attacking character, its section progress and whether the attack window is open"));
+
+	int32 DrawHits = 0;
+	FAutoConsoleVariableRef CVarDrawHits(TEXT("ActionGame.Debug.Hits"), DrawHits, TEXT("Draw where resolved hits landed"));
+
+	int32 DrawProjectiles = 0;
+	FAutoConsoleVariableRef CVarDrawProjectiles(TEXT("ActionGame.Debug.Projectiles"), DrawProjectiles, TEXT("Draw every projectile in flight and the step it moved this frame"));
+
+	float HitSeconds = 1.f;
+	FAutoConsoleVariableRef CVarHitSeconds(TEXT("ActionGame.Debug.HitSeconds"), HitSeconds, TEXT("Seconds a hit point stays drawn"));
+
+	const float LineThickness = 1.f;
+}
+
+
+uint8 FCombatDebugDraw::GetChannels()
+{
+	return (DrawHitboxes ? CHANNEL_Hitboxes : 0)
+		| (DrawSweeps ? CHANNEL_Sweeps : 0)
+		| (DrawWindows ? CHANNEL_Windows : 0)
+		| (DrawHits ? CHANNEL_Hits : 0)
+		| (DrawProjectiles ? CHANNEL_Projectiles : 0);
+}
+
+float FCombatDebugDraw::GetHitSeconds()
+{
+	return HitSeconds;
+}
+
+void FCombatDebugDraw::AddLine(const FVector& Start, const FVector& End, const FColor& Color)
+{
+	Lines.Add(FBatchedLine(Start, End, FLinearColor(Color), 0.f, LineThickness, SDPG_Foreground));
+}
+
+void FCombatDebugDraw::AddBox(const FTransform& Transform, const FVector& Extent, const FColor& Color)
+{
+	FVector Corners[8];
+	for (int32 Corner = 0; Corner < 8; ++Corner)
+	{
+		const FVector Local((Corner & 1) ? Extent.X : -Extent.X, (Corner & 2) ? Extent.Y : -Extent.Y, (Corner & 4) ? Extent.Z : -Extent.Z);
+		Corners[Corner] = Transform.TransformPositionNoScale(Local);
+	}
+
+	// corners one bit apart share an edge
+	for (int32 Corner = 0; Corner < 8; ++Corner)
+	{
+		for (int32 Bit = 1; Bit < 8; Bit <<= 1)
+		{
+			if ((Corner & Bit) == 0)
+			{
+				AddLine(Corners[Corner], Corners[Corner | Bit], Color);
+			}
+		}
+	}
+}
+
+void FCombatDebugDraw::AddPoint(const FVector& Location, float Size, const FColor& Color)
+{
+	AddLine(Location - FVector(Size, 0.f, 0.f), Location + FVector(Size, 0.f, 0.f), Color);
+	AddLine(Location - FVector(0.f, Size, 0.f), Location + FVector(0.f, Size, 0.f), Color);
+	AddLine(Location - FVector(0.f, 0.f, Size), Location + FVector(0.f, 0.f, Size), Color);
+}
+
+void FCombatDebugDraw::Flush(UWorld* World)
+{
+	if (Lines.Num() > 0 && World && World->LineBatcher)
+	{
+		World->LineBatcher->DrawLines(Lines);
+	}
+	Lines.Reset();
+}
+
+#endif
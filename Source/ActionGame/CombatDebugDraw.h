@@ -0,0 +1,65 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** Combat debug drawing is compiled in everywhere but Shipping **/
+#ifndef COMBAT_DEBUG_DRAW
+	#define COMBAT_DEBUG_DRAW !UE_BUILD_SHIPPING
+#endif
+
+#if COMBAT_DEBUG_DRAW
+
+#include "Components/LineBatchComponent.h"
+
+class UWorld;
+
+
+/**
+ * Frame batch of combat debug lines.
+ *
+ * The combat manager adds hitboxes, sweep paths, attack windows, projectiles and hit
+ * points of every combatant while it updates them and hands the whole frame to the world's
+ * line batcher in one call, so drawing 500 characters costs one array copy rather
+ * than a render state per component. Each channel has its console variable:
+ *     ActionGame.Debug.Hitboxes, ActionGame.Debug.Sweeps, ActionGame.Debug.Windows, ActionGame.Debug.Hits,
+ *     ActionGame.Debug.Projectiles
+ */
+class ACTIONGAME_API FCombatDebugDraw
+{
+public:
+	enum EChannel : uint8
+	{
+		CHANNEL_Hitboxes	= 1 << 0,
+		CHANNEL_Sweeps		= 1 << 1,
+		CHANNEL_Windows		= 1 << 2,
+		CHANNEL_Hits		= 1 << 3,
+		CHANNEL_Projectiles	= 1 << 4,
+	};
+
+	/** Channels switched on by their console variables **/
+	static uint8 GetChannels();
+
+	FORCEINLINE static bool IsEnabled(EChannel Channel) { return (GetChannels() & Channel) != 0; }
+
+	/** seconds a hit point stays drawn **/
+	static float GetHitSeconds();
+
+	void AddLine(const FVector& Start, const FVector& End, const FColor& Color);
+
+	/** Adds the 12 edges of a box with Extent half size, placed by Transform without its scale **/
+	void AddBox(const FTransform& Transform, const FVector& Extent, const FColor& Color);
+
+	/** Adds a three axis cross of Size half length **/
+	void AddPoint(const FVector& Location, float Size, const FColor& Color);
+
+	/** Hands the lines added since the last flush to World's line batcher, drawn for one frame **/
+	void Flush(UWorld* World);
+
+private:
+	/** kept between frames, only its content is thrown away **/
+	TArray<FBatchedLine> Lines;
+};
+
+#endif
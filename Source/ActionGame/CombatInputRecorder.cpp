@@ -0,0 +1,503 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CombatInputRecorder.h"
+#include "ActionGameCharacter.h"
+#include "ActionGameLog.h"
+#include "EngineUtils.h"
+#include "Engine/World.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/App.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+
+namespace
+{
+	const uint32 RecordingMagic = 0x52494741; // "AGIR"
+	const int32 RecordingVersion = 1;
+
+	/** axis values are stored in 1/1024 steps **/
+	const float AxisSteps = 1024.f;
+
+	/** frame record flags, one bit per axis followed by these **/
+	const uint8 FRAME_Actions = 1 << FCombatInputFrame::AXIS_Count;
+	const uint8 FRAME_DeltaTime = FRAME_Actions << 1;
+
+	static_assert(FCombatInputFrame::AXIS_Count <= 6, "Frame flags hold one bit per axis plus actions and frame time");
+
+	FORCEINLINE int32 QuantizeAxis(float Value)
+	{
+		return FMath::RoundToInt(Value * AxisSteps);
+	}
+
+	FORCEINLINE uint32 ZigZagEncode(int32 Value)
+	{
+		return (static_cast<uint32>(Value) << 1) ^ static_cast<uint32>(Value >> 31);
+	}
+
+	FORCEINLINE int32 ZigZagDecode(uint32 Value)
+	{
+		return static_cast<int32>(Value >> 1) ^ -static_cast<int32>(Value & 1);
+	}
+
+	void WriteVarInt(TArray<uint8>& Data, uint32 Value)
+	{
+		while (Value >= 0x80)
+		{
+			Data.Add(static_cast<uint8>(Value | 0x80));
+			Value >>= 7;
+		}
+		Data.Add(static_cast<uint8>(Value));
+	}
+
+	bool ReadVarInt(const TArray<uint8>& Data, int32& Offset, uint32& OutValue)
+	{
+		OutValue = 0;
+		for (int32 Shift = 0; Shift < 35; Shift += 7)
+		{
+			if (Offset >= Data.Num())
+			{
+				return false;
+			}
+			const uint8 Byte = Data[Offset++];
+			OutValue |= static_cast<uint32>(Byte & 0x7F) << Shift;
+			if ((Byte & 0x80) == 0)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	FAutoConsoleCommandWithWorldAndArgs RecordCommand(
+		TEXT("ActionGame.Record"),
+		TEXT("Records the local player's combat input. Usage: ActionGame.Record [Name]"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+		{
+			ACombatInputRecorder::StartRecording(World, Args.Num() > 0 ? Args[0] : FString::Printf(TEXT("Fight-%s"), *FDateTime::Now().ToString()));
+		}));
+
+	FAutoConsoleCommandWithWorldAndArgs RecordStopCommand(
+		TEXT("ActionGame.Record.Stop"),
+		TEXT("Saves and stops the running input recording"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+		{
+			ACombatInputRecorder::StopRecording(World);
+		}));
+
+	FAutoConsoleCommandWithWorldAndArgs ReplayCommand(
+		TEXT("ActionGame.Replay"),
+		TEXT("Replays a combat input recording. Usage: ActionGame.Replay Name"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+		{
+			if (Args.Num() > 0)
+			{
+				ACombatInputRecorder::StartReplay(World, Args[0], false);
+			}
+		}));
+}
+
+
+//========= STREAM =========//
+
+FCombatInputStream::FCombatInputStream()
+	: RandomSeed(0)
+	, StartLocation(FVector::ZeroVector)
+	, StartRotation(FRotator::ZeroRotator)
+	, StartControlRotation(FRotator::ZeroRotator)
+	, NumFrames(0)
+{
+	ResetCursor();
+}
+
+void FCombatInputStream::ResetCursor()
+{
+	FMemory::Memzero(PreviousAxes);
+	PreviousDeltaMicroseconds = 0;
+	ReadOffset = 0;
+	FramesRead = 0;
+}
+
+void FCombatInputStream::WriteFrame(const FCombatInputFrame& Frame)
+{
+	int32 Axes[FCombatInputFrame::AXIS_Count];
+	uint8 Changed = 0;
+	for (int32 Axis = 0; Axis < FCombatInputFrame::AXIS_Count; ++Axis)
+	{
+		Axes[Axis] = QuantizeAxis(Frame.Axes[Axis]);
+		if (Axes[Axis] != PreviousAxes[Axis])
+		{
+			Changed |= 1 << Axis;
+		}
+	}
+
+	const int32 DeltaMicroseconds = FMath::RoundToInt(Frame.DeltaSeconds * 1000000.f);
+	if (Frame.Actions != 0)
+	{
+		Changed |= FRAME_Actions;
+	}
+	if (DeltaMicroseconds != PreviousDeltaMicroseconds)
+	{
+		Changed |= FRAME_DeltaTime;
+	}
+
+	Frames.Add(Changed);
+	for (int32 Axis = 0; Axis < FCombatInputFrame::AXIS_Count; ++Axis)
+	{
+		if (Changed & (1 << Axis))
+		{
+			WriteVarInt(Frames, ZigZagEncode(Axes[Axis] - PreviousAxes[Axis]));
+			PreviousAxes[Axis] = Axes[Axis];
+		}
+	}
+	if (Changed & FRAME_Actions)
+	{
+		Frames.Add(Frame.Actions);
+	}
+	if (Changed & FRAME_DeltaTime)
+	{
+		WriteVarInt(Frames, ZigZagEncode(DeltaMicroseconds - PreviousDeltaMicroseconds));
+		PreviousDeltaMicroseconds = DeltaMicroseconds;
+	}
+
+	++NumFrames;
+}
+
+bool FCombatInputStream::ReadFrame(FCombatInputFrame& OutFrame)
+{
+	if (FramesRead >= NumFrames || ReadOffset >= Frames.Num())
+	{
+		return false;
+	}
+
+	const uint8 Changed = Frames[ReadOffset++];
+	uint32 Value;
+	for (int32 Axis = 0; Axis < FCombatInputFrame::AXIS_Count; ++Axis)
+	{
+		if (Changed & (1 << Axis))
+		{
+			if (!ReadVarInt(Frames, ReadOffset, Value))
+			{
+				return false;
+			}
+			PreviousAxes[Axis] += ZigZagDecode(Value);
+		}
+		OutFrame.Axes[Axis] = PreviousAxes[Axis] / AxisSteps;
+	}
+
+	OutFrame.Actions = 0;
+	if (Changed & FRAME_Actions)
+	{
+		if (ReadOffset >= Frames.Num())
+		{
+			return false;
+		}
+		OutFrame.Actions = Frames[ReadOffset++];
+	}
+
+	if (Changed & FRAME_DeltaTime)
+	{
+		if (!ReadVarInt(Frames, ReadOffset, Value))
+		{
+			return false;
+		}
+		PreviousDeltaMicroseconds += ZigZagDecode(Value);
+	}
+	OutFrame.DeltaSeconds = PreviousDeltaMicroseconds / 1000000.f;
+
+	++FramesRead;
+	return true;
+}
+
+bool FCombatInputStream::Save(const FString& InPath) const
+{
+	TArray<uint8> FileData;
+	FMemoryWriter Writer(FileData);
+
+	uint32 Magic = RecordingMagic;
+	int32 Version = RecordingVersion;
+	int32 Seed = RandomSeed;
+	FVector Location = StartLocation;
+	FRotator Rotation = StartRotation;
+	FRotator ControlRotation = StartControlRotation;
+	int32 FrameCount = NumFrames;
+
+	Writer << Magic << Version << Seed << Location << Rotation << ControlRotation << FrameCount;
+	Writer << const_cast<TArray<uint8>&>(Frames);
+
+	return FFileHelper::SaveArrayToFile(FileData, *InPath);
+}
+
+bool FCombatInputStream::Load(const FString& InPath)
+{
+	TArray<uint8> FileData;
+	if (!FFileHelper::LoadFileToArray(FileData, *InPath))
+	{
+		return false;
+	}
+
+	FMemoryReader Reader(FileData);
+
+	uint32 Magic = 0;
+	int32 Version = 0;
+	Reader << Magic << Version;
+	if (Magic != RecordingMagic || Version != RecordingVersion)
+	{
+		AG_LOG(Combat, ERROR, "Input recording {} has an unknown format (version {})", InPath, Version);
+		return false;
+	}
+
+	Reader << RandomSeed << StartLocation << StartRotation << StartControlRotation << NumFrames;
+	Reader << Frames;
+
+	ResetCursor();
+	return !Reader.IsError();
+}
+
+FString FCombatInputStream::ResolvePath(const FString& Name)
+{
+	if (!FPaths::GetPath(Name).IsEmpty())
+	{
+		return Name;
+	}
+	const FString FileName = FPaths::GetExtension(Name).IsEmpty() ? Name + TEXT(".agrec") : Name;
+	return FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("InputRecordings"), FileName);
+}
+
+
+//========= RECORDER =========//
+
+ACombatInputRecorder::ACombatInputRecorder()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.TickGroup = TG_PrePhysics;
+
+	SetReplicates(false);
+
+	Character = nullptr;
+	Mode = EMode::Record;
+	bStarted = false;
+	bQuitWhenDone = false;
+	bHasNextFrame = false;
+	ReplayStartTime = 0.0;
+}
+
+ACombatInputRecorder* ACombatInputRecorder::StartRecording(UWorld* World, const FString& Name)
+{
+	if (World == nullptr || !World->IsGameWorld())
+	{
+		return nullptr;
+	}
+
+	StopRecording(World);
+
+	ACombatInputRecorder* Recorder = World->SpawnActor<ACombatInputRecorder>();
+	if (Recorder)
+	{
+		Recorder->Mode = EMode::Record;
+		Recorder->Path = FCombatInputStream::ResolvePath(Name);
+		// recorded once the frame's input has been handled
+		Recorder->SetTickGroup(TG_PostPhysics);
+	}
+	return Recorder;
+}
+
+ACombatInputRecorder* ACombatInputRecorder::StartReplay(UWorld* World, const FString& Name, bool bQuitWhenDone)
+{
+	if (World == nullptr || !World->IsGameWorld())
+	{
+		return nullptr;
+	}
+
+	const FString ReplayPath = FCombatInputStream::ResolvePath(Name);
+
+	ACombatInputRecorder* Recorder = World->SpawnActor<ACombatInputRecorder>();
+	if (Recorder == nullptr)
+	{
+		return nullptr;
+	}
+
+	if (!Recorder->Stream.Load(ReplayPath))
+	{
+		AG_LOG(Combat, ERROR, "Cannot load input recording {}", ReplayPath);
+		Recorder->Destroy();
+		return nullptr;
+	}
+
+	Recorder->Mode = EMode::Replay;
+	Recorder->Path = ReplayPath;
+	Recorder->bQuitWhenDone = bQuitWhenDone;
+	return Recorder;
+}
+
+void ACombatInputRecorder::StopRecording(UWorld* World)
+{
+	if (World == nullptr)
+	{
+		return;
+	}
+
+	for (TActorIterator<ACombatInputRecorder> It(World); It; ++It)
+	{
+		if (It->Mode == EMode::Record && !It->IsPendingKill())
+		{
+			It->Destroy();
+		}
+	}
+}
+
+void ACombatInputRecorder::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (bStarted)
+	{
+		if (Mode == EMode::Record)
+		{
+			FinishRecording();
+		}
+		else
+		{
+			FinishReplay();
+		}
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+bool ACombatInputRecorder::AcquireCharacter()
+{
+	if (Character && !Character->IsPendingKill())
+	{
+		return true;
+	}
+
+	APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
+	Character = PlayerController ? Cast<AActionGameCharacter>(PlayerController->GetPawn()) : nullptr;
+	return Character != nullptr;
+}
+
+void ACombatInputRecorder::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	// the player's pawn may be spawned after the recorder
+	if (!AcquireCharacter())
+	{
+		if (bStarted)
+		{
+			Destroy();
+		}
+		return;
+	}
+
+	if (!bStarted)
+	{
+		bStarted = true;
+		if (Mode == EMode::Record)
+		{
+			BeginRecording();
+		}
+		else
+		{
+			BeginReplay();
+		}
+		return;
+	}
+
+	if (Mode == EMode::Record)
+	{
+		FCombatInputFrame Frame = Character->GetInputFrame();
+		Frame.DeltaSeconds = static_cast<float>(FApp::GetDeltaTime());
+		Stream.WriteFrame(Frame);
+		Character->ResetInputFrame();
+		return;
+	}
+
+	if (!bHasNextFrame)
+	{
+		Destroy();
+		return;
+	}
+	Character->ReplayInputFrame(NextFrame);
+
+	// the following frame runs with the time step it was recorded with
+	bHasNextFrame = Stream.ReadFrame(NextFrame);
+	if (bHasNextFrame && NextFrame.DeltaSeconds > 0.f)
+	{
+		FApp::SetFixedDeltaTime(NextFrame.DeltaSeconds);
+	}
+}
+
+void ACombatInputRecorder::BeginRecording()
+{
+	// a fresh seed, stored so the replay picks the same attack sections
+	Stream.RandomSeed = static_cast<int32>(FPlatformTime::Cycles());
+	Character->SetAttackRandomSeed(Stream.RandomSeed);
+
+	Stream.StartLocation = Character->GetActorLocation();
+	Stream.StartRotation = Character->GetActorRotation();
+	Stream.StartControlRotation = Character->GetControlRotation();
+	Character->ResetInputFrame();
+
+	AG_LOG(Combat, INFO, "Recording combat input to {}", Path);
+}
+
+void ACombatInputRecorder::FinishRecording()
+{
+	const bool bSaved = Stream.Save(Path);
+	AG_LOG(Combat, INFO, "Input recording {}: {} frames, {} bytes, saved {}", Path, Stream.GetNumFrames(), Stream.GetNumBytes(), bSaved);
+}
+
+void ACombatInputRecorder::BeginReplay()
+{
+	// the recorded frames drive the character, live input would diverge from them
+	Character->DisableInput(nullptr);
+	Character->SetAttackRandomSeed(Stream.RandomSeed);
+	Character->SetActorLocationAndRotation(Stream.StartLocation, Stream.StartRotation, false, nullptr, ETeleportType::TeleportPhysics);
+	Character->GetCharacterMovement()->StopMovementImmediately();
+	if (AController* Controller = Character->GetController())
+	{
+		Controller->SetControlRotation(Stream.StartControlRotation);
+
+		// feed the frame before the controller applies rotation input and the movement consumes it
+		Controller->AddTickPrerequisiteActor(this);
+	}
+	Character->GetCharacterMovement()->AddTickPrerequisiteActor(this);
+
+	// frames are read one ahead, the time step of a frame has to be set before it starts
+	bHasNextFrame = Stream.ReadFrame(NextFrame);
+	if (bHasNextFrame && NextFrame.DeltaSeconds > 0.f)
+	{
+		FApp::SetFixedDeltaTime(NextFrame.DeltaSeconds);
+	}
+	FApp::SetUseFixedTimeStep(true);
+
+	ReplayStartTime = FPlatformTime::Seconds();
+	AG_LOG(Combat, INFO, "Replaying {} frames of combat input from {}", Stream.GetNumFrames(), Path);
+}
+
+void ACombatInputRecorder::FinishReplay()
+{
+	FApp::SetUseFixedTimeStep(false);
+
+	if (Character && !Character->IsPendingKill())
+	{
+		if (AController* Controller = Character->GetController())
+		{
+			Controller->RemoveTickPrerequisiteActor(this);
+		}
+		Character->GetCharacterMovement()->RemoveTickPrerequisiteActor(this);
+		Character->EnableInput(nullptr);
+	}
+
+	AG_LOG(Combat, INFO, "Replay of {} finished in {} s", Path, FPlatformTime::Seconds() - ReplayStartTime);
+
+	if (bQuitWhenDone)
+	{
+		FPlatformMisc::RequestExit(false);
+	}
+}
@@ -0,0 +1,160 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+
+#include "CombatInputRecorder.generated.h"
+
+class AActionGameCharacter;
+
+
+/** Input a character received during one frame **/
+struct FCombatInputFrame
+{
+	enum EAxis
+	{
+		AXIS_MoveForward,
+		AXIS_MoveRight,
+		AXIS_Turn,
+		AXIS_TurnRate,
+		AXIS_LookUp,
+		AXIS_LookUpRate,
+
+		AXIS_Count
+	};
+
+	enum EAction : uint8
+	{
+		ACTION_Punch		= 1 << 0,
+		ACTION_Kick			= 1 << 1,
+		ACTION_JumpPressed	= 1 << 2,
+		ACTION_JumpReleased	= 1 << 3,
+		ACTION_LockOn		= 1 << 4,
+	};
+
+	/** last value of each axis binding **/
+	float Axes[AXIS_Count];
+
+	/** EAction bits pressed or released this frame **/
+	uint8 Actions;
+
+	/** world delta time of the frame **/
+	float DeltaSeconds;
+
+	FCombatInputFrame()
+	{
+		Reset();
+	}
+
+	void Reset()
+	{
+		FMemory::Memzero(Axes);
+		Actions = 0;
+		DeltaSeconds = 0.f;
+	}
+};
+
+
+/**
+ * Delta encoded input recording.
+ *
+ * A header (format version, attack random seed and starting transforms) followed
+ * by one record per frame: a byte flagging what changed since the previous frame,
+ * then the changed quantized axes and frame time as zigzag varint deltas and the
+ * action bits. Idle frames take a single byte.
+ */
+class ACTIONGAME_API FCombatInputStream
+{
+public:
+	FCombatInputStream();
+
+	int32 RandomSeed;
+	FVector StartLocation;
+	FRotator StartRotation;
+	FRotator StartControlRotation;
+
+	/** Appends Frame, quantizing it the way a replay will read it back **/
+	void WriteFrame(const FCombatInputFrame& Frame);
+
+	/** Reads the next frame, returns false at the end of the stream **/
+	bool ReadFrame(FCombatInputFrame& OutFrame);
+
+	bool Save(const FString& Path) const;
+	bool Load(const FString& Path);
+
+	FORCEINLINE int32 GetNumFrames() const { return NumFrames; }
+	FORCEINLINE int32 GetNumBytes() const { return Frames.Num(); }
+
+	/** Recordings without a directory are kept in Saved/InputRecordings **/
+	static FString ResolvePath(const FString& Name);
+
+private:
+	void ResetCursor();
+
+	TArray<uint8> Frames;
+	int32 NumFrames;
+
+	/** previous frame's quantized values, shared by the writer and the reader **/
+	int32 PreviousAxes[FCombatInputFrame::AXIS_Count];
+	int32 PreviousDeltaMicroseconds;
+	int32 ReadOffset;
+	int32 FramesRead;
+};
+
+
+/**
+ * Records the local player's input to an FCombatInputStream, or replays one.
+ *
+ * Replays disable live input, put the character back where the recording started,
+ * reseed its attack random stream and feed each recorded frame through the same
+ * input handlers at the recorded frame time, so the fight plays out the same way
+ * on every build. Works headless:
+ *     ActionGame -nullrhi -unattended -CombatReplay=<name> [-NoQuit]
+ * Record with -CombatRecord=<name>, or use the ActionGame.Record, ActionGame.Record.Stop
+ * and ActionGame.Replay console commands.
+ */
+UCLASS(NotBlueprintable, Transient)
+class ACTIONGAME_API ACombatInputRecorder : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	ACombatInputRecorder();
+
+	static ACombatInputRecorder* StartRecording(UWorld* World, const FString& Name);
+	static ACombatInputRecorder* StartReplay(UWorld* World, const FString& Name, bool bQuitWhenDone);
+
+	/** Saves and stops the recording running in World, if any **/
+	static void StopRecording(UWorld* World);
+
+	virtual void Tick(float DeltaSeconds) override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+	enum class EMode : uint8 { Record, Replay };
+
+	/** waits for the local player's character, returns false until it exists **/
+	bool AcquireCharacter();
+
+	void BeginRecording();
+	void BeginReplay();
+	void FinishRecording();
+	void FinishReplay();
+
+	UPROPERTY()
+	AActionGameCharacter* Character;
+
+	FCombatInputStream Stream;
+
+	/** replayed on the next tick **/
+	FCombatInputFrame NextFrame;
+	bool bHasNextFrame;
+
+	FString Path;
+	EMode Mode;
+	bool bStarted;
+	bool bQuitWhenDone;
+	double ReplayStartTime;
+};
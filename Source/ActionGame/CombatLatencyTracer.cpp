@@ -0,0 +1,229 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CombatLatencyTracer.h"
+#include "ActionGameLog.h"
+#include "CombatStatistics.h"
+#include "CoreGlobals.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Traced attacks"), STAT_TracedAttacks, STATGROUP_ActionGameCombat);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Input to montage p50 (ms)"), STAT_InputToMontageP50, STATGROUP_ActionGameCombat);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Input to montage p95 (ms)"), STAT_InputToMontageP95, STATGROUP_ActionGameCombat);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Input to montage p99 (ms)"), STAT_InputToMontageP99, STATGROUP_ActionGameCombat);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Input to active frame p50 (ms)"), STAT_InputToActiveP50, STATGROUP_ActionGameCombat);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Input to active frame p95 (ms)"), STAT_InputToActiveP95, STATGROUP_ActionGameCombat);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Input to active frame p99 (ms)"), STAT_InputToActiveP99, STATGROUP_ActionGameCombat);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Input to hit p50 (ms)"), STAT_InputToHitP50, STATGROUP_ActionGameCombat);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Input to hit p95 (ms)"), STAT_InputToHitP95, STATGROUP_ActionGameCombat);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Input to hit p99 (ms)"), STAT_InputToHitP99, STATGROUP_ActionGameCombat);
+
+
+int32 FCombatLatencyTracer::Enabled = 0;
+
+namespace
+{
+	FAutoConsoleVariableRef CVarLatencyTrace(TEXT("ActionGame.Latency.Trace"), FCombatLatencyTracer::Enabled, TEXT("Traces the latency of every local attack from input to hit (0 off, 1 on)"));
+
+	/** traced attacks kept, the oldest are overwritten **/
+	const int32 MaxTracedAttacks = 4096;
+
+	/** an attack with no hit this long after its input is done **/
+	const double MaxTraceSeconds = 2.0;
+
+	const TCHAR* StageNames[FCombatLatencyTracer::NumStages] = { TEXT("montage"), TEXT("active"), TEXT("hit") };
+
+	struct FTracedAttack
+	{
+		EAttackType AttackType;
+		uint64 InputCycles;
+		uint64 InputFrame;
+
+		/** milliseconds and frames from the input to each stage, negative when not reached **/
+		float StageMilliseconds[FCombatLatencyTracer::NumStages];
+		int32 StageFrames[FCombatLatencyTracer::NumStages];
+	};
+
+	struct FOpenTrace : FTracedAttack
+	{
+		const AActor* Attacker;
+	};
+
+	/** few attackers are local at once, open traces are searched linearly **/
+	TArray<FOpenTrace, TInlineAllocator<4>> OpenTraces;
+
+	TArray<FTracedAttack> TracedAttacks;
+	int32 NextTracedAttack = 0;
+
+	void UpdateStats()
+	{
+#if STATS
+		TArray<float> Samples[FCombatLatencyTracer::NumStages];
+		for (const FTracedAttack& Attack : TracedAttacks)
+		{
+			for (int32 Stage = 0; Stage < FCombatLatencyTracer::NumStages; ++Stage)
+			{
+				if (Attack.StageMilliseconds[Stage] >= 0.f)
+				{
+					Samples[Stage].Add(Attack.StageMilliseconds[Stage]);
+				}
+			}
+		}
+
+		SET_DWORD_STAT(STAT_TracedAttacks, TracedAttacks.Num());
+		SET_FLOAT_STAT(STAT_InputToMontageP50, FCombatStatistics::GetPercentile(Samples[0], 0.50f));
+		SET_FLOAT_STAT(STAT_InputToMontageP95, FCombatStatistics::GetPercentile(Samples[0], 0.95f));
+		SET_FLOAT_STAT(STAT_InputToMontageP99, FCombatStatistics::GetPercentile(Samples[0], 0.99f));
+		SET_FLOAT_STAT(STAT_InputToActiveP50, FCombatStatistics::GetPercentile(Samples[1], 0.50f));
+		SET_FLOAT_STAT(STAT_InputToActiveP95, FCombatStatistics::GetPercentile(Samples[1], 0.95f));
+		SET_FLOAT_STAT(STAT_InputToActiveP99, FCombatStatistics::GetPercentile(Samples[1], 0.99f));
+		SET_FLOAT_STAT(STAT_InputToHitP50, FCombatStatistics::GetPercentile(Samples[2], 0.50f));
+		SET_FLOAT_STAT(STAT_InputToHitP95, FCombatStatistics::GetPercentile(Samples[2], 0.95f));
+		SET_FLOAT_STAT(STAT_InputToHitP99, FCombatStatistics::GetPercentile(Samples[2], 0.99f));
+#endif
+	}
+
+	/** Keeps the trace at Index, when the attack got as far as playing, and removes it from the open ones **/
+	void CloseTrace(int32 Index)
+	{
+		const FTracedAttack& Trace = OpenTraces[Index];
+		if (Trace.StageMilliseconds[static_cast<int32>(ECombatLatencyStage::MontageStart)] >= 0.f)
+		{
+			if (TracedAttacks.Num() < MaxTracedAttacks)
+			{
+				TracedAttacks.Add(Trace);
+			}
+			else
+			{
+				TracedAttacks[NextTracedAttack] = Trace;
+			}
+			NextTracedAttack = (NextTracedAttack + 1) % MaxTracedAttacks;
+			UpdateStats();
+		}
+		OpenTraces.RemoveAtSwap(Index, 1, false);
+	}
+
+	FAutoConsoleCommand LatencyExportCommand(
+		TEXT("ActionGame.Latency.Export"),
+		TEXT("Writes the traced attack latencies as CSV. Usage: ActionGame.Latency.Export [Path]"),
+		FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+		{
+			const FString Path = Args.Num() > 0 ? Args[0] : FPaths::Combine(FPaths::ProfilingDir(), FString::Printf(TEXT("CombatLatency-%s.csv"), *FDateTime::Now().ToString()));
+			FCombatLatencyTracer::ExportCsv(Path);
+		}));
+
+	FAutoConsoleCommand LatencyResetCommand(
+		TEXT("ActionGame.Latency.Reset"),
+		TEXT("Drops the traced attack latencies"),
+		FConsoleCommandDelegate::CreateStatic(&FCombatLatencyTracer::Reset));
+}
+
+
+void FCombatLatencyTracer::Begin(const AActor* Attacker, EAttackType Type)
+{
+	const uint64 Now = FPlatformTime::Cycles64();
+
+	// the attacker's previous attack and attacks long past their input are done
+	for (int32 Index = OpenTraces.Num() - 1; Index >= 0; --Index)
+	{
+		if (OpenTraces[Index].Attacker == Attacker || FPlatformTime::ToSeconds64(Now - OpenTraces[Index].InputCycles) > MaxTraceSeconds)
+		{
+			CloseTrace(Index);
+		}
+	}
+
+	FOpenTrace& Trace = OpenTraces[OpenTraces.AddDefaulted()];
+	Trace.Attacker = Attacker;
+	Trace.AttackType = Type;
+	Trace.InputCycles = Now;
+	Trace.InputFrame = GFrameCounter;
+	for (int32 Stage = 0; Stage < NumStages; ++Stage)
+	{
+		Trace.StageMilliseconds[Stage] = -1.f;
+		Trace.StageFrames[Stage] = -1;
+	}
+}
+
+void FCombatLatencyTracer::Mark(const AActor* Attacker, ECombatLatencyStage Stage)
+{
+	const int32 Index = OpenTraces.IndexOfByPredicate([Attacker](const FOpenTrace& Trace) { return Trace.Attacker == Attacker; });
+	if (Index == INDEX_NONE)
+	{
+		return;
+	}
+
+	FOpenTrace& Trace = OpenTraces[Index];
+	const int32 StageIndex = static_cast<int32>(Stage);
+	if (Trace.StageMilliseconds[StageIndex] >= 0.f)
+	{
+		return;
+	}
+
+	Trace.StageMilliseconds[StageIndex] = static_cast<float>(FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - Trace.InputCycles));
+	Trace.StageFrames[StageIndex] = static_cast<int32>(GFrameCounter - Trace.InputFrame);
+
+	// the first hit is the last stage
+	if (Stage == ECombatLatencyStage::Hit)
+	{
+		CloseTrace(Index);
+	}
+}
+
+bool FCombatLatencyTracer::ExportCsv(const FString& Path)
+{
+	FString Csv = TEXT("attack_type,input_frame");
+	for (const TCHAR* StageName : StageNames)
+	{
+		Csv += FString::Printf(TEXT(",%s_ms"), StageName);
+	}
+	for (const TCHAR* StageName : StageNames)
+	{
+		Csv += FString::Printf(TEXT(",%s_frames"), StageName);
+	}
+	Csv += LINE_TERMINATOR;
+
+	// oldest first, unreached stages are left empty
+	TArray<float> Samples[NumStages];
+	for (int32 Offset = 0; Offset < TracedAttacks.Num(); ++Offset)
+	{
+		const FTracedAttack& Attack = TracedAttacks[(NextTracedAttack + Offset) % TracedAttacks.Num()];
+		Csv += FString::Printf(TEXT("%d,%llu"), static_cast<int32>(Attack.AttackType), Attack.InputFrame);
+		for (int32 Stage = 0; Stage < NumStages; ++Stage)
+		{
+			Csv += Attack.StageMilliseconds[Stage] >= 0.f ? FString::Printf(TEXT(",%.3f"), Attack.StageMilliseconds[Stage]) : FString(TEXT(","));
+			if (Attack.StageMilliseconds[Stage] >= 0.f)
+			{
+				Samples[Stage].Add(Attack.StageMilliseconds[Stage]);
+			}
+		}
+		for (int32 Stage = 0; Stage < NumStages; ++Stage)
+		{
+			Csv += Attack.StageFrames[Stage] >= 0 ? FString::Printf(TEXT(",%d"), Attack.StageFrames[Stage]) : FString(TEXT(","));
+		}
+		Csv += LINE_TERMINATOR;
+	}
+
+	if (!FFileHelper::SaveStringToFile(Csv, *Path))
+	{
+		AG_LOG(Combat, ERROR, "Attack latencies could not be written to {}", Path);
+		return false;
+	}
+
+	AG_LOG(Combat, INFO, "{} attack latencies written to {}", TracedAttacks.Num(), Path);
+	for (int32 Stage = 0; Stage < NumStages; ++Stage)
+	{
+		AG_LOG(Combat, INFO, "Input to {}: p50 {} ms, p95 {} ms, p99 {} ms", StageNames[Stage],
+			FCombatStatistics::GetPercentile(Samples[Stage], 0.50f), FCombatStatistics::GetPercentile(Samples[Stage], 0.95f), FCombatStatistics::GetPercentile(Samples[Stage], 0.99f));
+	}
+	return true;
+}
+
+void FCombatLatencyTracer::Reset()
+{
+	OpenTraces.Reset();
+	TracedAttacks.Reset();
+	NextTracedAttack = 0;
+	UpdateStats();
+}
@@ -0,0 +1,71 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+
+#include "AttackCatalogue.h"
+
+class AActor;
+
+
+/** "stat ActionGameCombat": cycle counters of the attack pipeline and the traced attack latencies **/
+DECLARE_STATS_GROUP(TEXT("ActionGameCombat"), STATGROUP_ActionGameCombat, STATCAT_Advanced);
+
+
+/** Points an attack passes after its input, in order **/
+enum class ECombatLatencyStage : uint8
+{
+	MontageStart,
+	FirstActiveFrame,
+	Hit,
+
+	MAX
+};
+
+
+/**
+ * Per-attack latency tracing, from the attack input to the montage starting, to the first
+ * frame with the attack window open, to the first hit landed.
+ *
+ * Off unless ActionGame.Latency.Trace is set, every call is then a single branch. Traced
+ * attacks are kept in a bounded window, their percentiles are shown in the stat group and
+ * ActionGame.Latency.Export writes them as CSV to Saved/Profiling.
+ */
+class ACTIONGAME_API FCombatLatencyTracer
+{
+public:
+	static const int32 NumStages = static_cast<int32>(ECombatLatencyStage::MAX);
+
+	/** Starts a trace for Attacker's attack input, ending any trace it still had open **/
+	static FORCEINLINE void BeginAttack(const AActor* Attacker, EAttackType Type)
+	{
+		if (Enabled)
+		{
+			Begin(Attacker, Type);
+		}
+	}
+
+	/** Marks Stage for Attacker's open trace, only the first time it is reached **/
+	static FORCEINLINE void MarkStage(const AActor* Attacker, ECombatLatencyStage Stage)
+	{
+		if (Enabled)
+		{
+			Mark(Attacker, Stage);
+		}
+	}
+
+	/** Writes the traced attacks as CSV, returns false when the file cannot be written **/
+	static bool ExportCsv(const FString& Path);
+
+	/** Drops every traced attack and open trace **/
+	static void Reset();
+
+	/** ActionGame.Latency.Trace **/
+	static int32 Enabled;
+
+private:
+	static void Begin(const AActor* Attacker, EAttackType Type);
+	static void Mark(const AActor* Attacker, ECombatLatencyStage Stage);
+};
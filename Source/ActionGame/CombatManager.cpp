@@ -0,0 +1,1700 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CombatManager.h"
+#include "ActionGame.h"
+#include "ActionGameCharacter.h"
+#include "CombatLatencyTracer.h"
+#include "Components/BoxComponent.h"
+#include "Components/CapsuleComponent.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Animation/AnimInstance.h"
+#include "Engine/World.h"
+#include "Engine/Engine.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/MemStack.h"
+#include "Algo/Sort.h"
+
+
+DECLARE_CYCLE_STAT(TEXT("CombatManager Tick"), STAT_CombatManagerTick, STATGROUP_ActionGameCombat);
+DECLARE_CYCLE_STAT(TEXT("Resolve hits"), STAT_ResolveHits, STATGROUP_ActionGameCombat);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Hits queued"), STAT_HitsQueued, STATGROUP_ActionGameCombat);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Hits resolved"), STAT_HitsResolved, STATGROUP_ActionGameCombat);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Buffered attack inputs"), STAT_BufferedInputs, STATGROUP_ActionGameCombat);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Buffered attack inputs expired"), STAT_BufferedInputsExpired, STATGROUP_ActionGameCombat);
+DECLARE_CYCLE_STAT(TEXT("Spatial grid update"), STAT_SpatialGridUpdate, STATGROUP_ActionGameCombat);
+DECLARE_CYCLE_STAT(TEXT("Find target"), STAT_FindTarget, STATGROUP_ActionGameCombat);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Grid cell changes"), STAT_GridCellChanges, STATGROUP_ActionGameCombat);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Target candidates tested"), STAT_TargetCandidates, STATGROUP_ActionGameCombat);
+DECLARE_CYCLE_STAT(TEXT("Update projectiles"), STAT_UpdateProjectiles, STATGROUP_ActionGameCombat);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Projectiles in flight"), STAT_ProjectilesInFlight, STATGROUP_ActionGameCombat);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Projectiles dropped, pool full"), STAT_ProjectilesDropped, STATGROUP_ActionGameCombat);
+
+namespace
+{
+	TMap<TWeakObjectPtr<UWorld>, TWeakObjectPtr<ACombatManager>> CombatManagers;
+
+	const int32 NumAttackTypes = static_cast<int32>(EAttackType::MAX);
+
+	/** received attack event delays kept for the net report **/
+	const int32 MaxAttackEventLatencies = 4096;
+
+	/** buffered press waits kept for the stats and the benchmark **/
+	const int32 MaxBufferedInputWaits = 4096;
+
+	float InputBufferSeconds = 0.2f;
+	FAutoConsoleVariableRef CVarInputBufferSeconds(TEXT("ActionGame.Combo.BufferSeconds"), InputBufferSeconds, TEXT("Seconds an attack press waits for its combo transition before it is dropped"));
+
+	/** spatial grid cell side, about a lock-on radius so a query reads a few cells **/
+	const float GridCellSize = 500.f;
+
+	/** buckets the grid cells hash into, a power of two **/
+	const int32 NumGridBuckets = 4096;
+
+	FORCEINLINE FIntPoint GetGridCell(const FVector& Location)
+	{
+		return FIntPoint(FMath::FloorToInt(Location.X / GridCellSize), FMath::FloorToInt(Location.Y / GridCellSize));
+	}
+
+	FORCEINLINE int32 GetGridBucket(const FIntPoint& Cell)
+	{
+		// large primes spread neighbouring cells over the buckets
+		return static_cast<int32>(((static_cast<uint32>(Cell.X) * 73856093u) ^ (static_cast<uint32>(Cell.Y) * 19349663u)) & (NumGridBuckets - 1));
+	}
+
+	/** widest capsule a projectile step looks for around itself **/
+	const float ProjectileCapsuleReach = 100.f;
+
+	float MaxRewindMilliseconds = 300.f;
+	FAutoConsoleVariableRef CVarMaxRewind(TEXT("ActionGame.LagCompensation.MaxRewindMs"), MaxRewindMilliseconds, TEXT("Oldest client hit claim the server rewinds to, older claims are rejected"));
+
+	float FutureToleranceMilliseconds = 50.f;
+	FAutoConsoleVariableRef CVarFutureTolerance(TEXT("ActionGame.LagCompensation.FutureToleranceMs"), FutureToleranceMilliseconds, TEXT("Newest client hit claim ahead of the server clock that is accepted, newer claims are rejected"));
+
+	float HitTolerance = 15.f;
+	FAutoConsoleVariableRef CVarHitTolerance(TEXT("ActionGame.LagCompensation.Tolerance"), HitTolerance, TEXT("Distance a rewound limb may miss the victim capsule by and still hit"));
+
+	/** Whether the limb box (unscaled transform, scaled extent) comes within Tolerance of the capsule **/
+	bool LimbTouchesCapsule(const FTransform& LimbTransform, const FVector& LimbExtent, const FVector& CapsuleCenter, float Radius, float HalfHeight, float Tolerance)
+	{
+		// the point of the capsule axis closest to the limb, then that point against the box
+		const FVector AxisOffset(0.f, 0.f, FMath::Max(HalfHeight - Radius, 0.f));
+		const FVector AxisPoint = FMath::ClosestPointOnSegment(LimbTransform.GetLocation(), CapsuleCenter - AxisOffset, CapsuleCenter + AxisOffset);
+
+		const FVector Local = LimbTransform.InverseTransformPositionNoScale(AxisPoint);
+		const FVector Clamped(FMath::Clamp(Local.X, -LimbExtent.X, LimbExtent.X), FMath::Clamp(Local.Y, -LimbExtent.Y, LimbExtent.Y), FMath::Clamp(Local.Z, -LimbExtent.Z, LimbExtent.Z));
+		return FVector::DistSquared(Local, Clamped) <= FMath::Square(Radius + Tolerance);
+	}
+
+	/** RemoveAtSwap for arrays holding Stride elements per combatant **/
+	template <typename ElementType, typename AllocatorType>
+	void RemoveStrideAtSwap(TArray<ElementType, AllocatorType>& Array, int32 Index, int32 Stride)
+	{
+		const int32 LastIndex = Array.Num() / Stride - 1;
+		if (Index != LastIndex)
+		{
+			for (int32 Element = 0; Element < Stride; ++Element)
+			{
+				Array[Index * Stride + Element] = MoveTemp(Array[LastIndex * Stride + Element]);
+			}
+		}
+		Array.RemoveAt(LastIndex * Stride, Stride, false);
+	}
+}
+
+
+ACombatManager::ACombatManager()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	// sweep once the animation has moved the limbs for this frame
+	PrimaryActorTick.TickGroup = TG_PostPhysics;
+
+	SetReplicates(false);
+
+	HitCount = 0;
+	AttackEventsSent = 0;
+	AttackEventsReceived = 0;
+	HitClaimsAccepted = 0;
+	HitClaimsRejected = 0;
+	BufferedInputsExecuted = 0;
+	BufferedInputsExpired = 0;
+	ProjectileUpdateMicroseconds = 0.f;
+
+	FMemory::Memzero(HistoryTimes);
+	HistoryHead = 0;
+	HistoryCount = 0;
+
+	QueuedHits.Reserve(64);
+	GridBuckets.Init(INDEX_NONE, NumGridBuckets);
+	Projectiles.Reserve(MaxProjectiles);
+}
+
+ACombatManager* ACombatManager::Get(const UObject* WorldContextObject)
+{
+	UWorld* World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull);
+	if (World == nullptr || !World->IsGameWorld())
+	{
+		return nullptr;
+	}
+
+	TWeakObjectPtr<ACombatManager>& CombatManager = CombatManagers.FindOrAdd(World);
+	if (!CombatManager.IsValid())
+	{
+		FActorSpawnParameters SpawnParameters;
+		SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		SpawnParameters.ObjectFlags |= RF_Transient;
+
+		CombatManager = World->SpawnActor<ACombatManager>(SpawnParameters);
+	}
+	return CombatManager.Get();
+}
+
+void ACombatManager::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	for (const FHitStop& HitStop : HitStops)
+	{
+		EndHitStop(HitStop);
+	}
+	HitStops.Reset();
+	QueuedHits.Reset();
+	Projectiles.Reset();
+
+	CombatManagers.Remove(GetWorld());
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void ACombatManager::Tick(float DeltaSeconds)
+{
+	SCOPE_CYCLE_COUNTER(STAT_CombatManagerTick);
+	Super::Tick(DeltaSeconds);
+
+	UpdateSpatialGrid();
+	UpdateCooldowns(DeltaSeconds);
+	UpdateAttackTimelines(DeltaSeconds);
+	UpdateInputBuffers();
+	UpdateAttackWindows(DeltaSeconds);
+	UpdateHitStops(DeltaSeconds);
+	RunMeleeSweeps();
+	UpdateProjectiles(DeltaSeconds);
+	ResolveHits();
+	RecordHistory();
+
+#if COMBAT_DEBUG_DRAW
+	DrawDebug();
+#endif
+}
+
+
+//========= COMBATANTS =========//
+
+int32 ACombatManager::RegisterCombatant(AActionGameCharacter* Character, TArrayView<UBoxComponent*> LimbBoxes, EMeleeHitDetection HitDetection)
+{
+	check(Character);
+	check(LimbBoxes.Num() <= MaxLimbsPerCombatant);
+
+	const int32 DenseIndex = Characters.Add(Character);
+
+	int32 CombatantId;
+	if (FreeIds.Num() > 0)
+	{
+		CombatantId = FreeIds.Pop(false);
+		DenseIndices[CombatantId] = DenseIndex;
+	}
+	else
+	{
+		CombatantId = DenseIndices.Add(DenseIndex);
+	}
+	CombatantIds.Add(CombatantId);
+
+	AttackTypes.Add(EAttackType::MELEE_FIST);
+	Attacks.Add(nullptr);
+	Flags.Add(static_cast<uint8>(FLAG_MovementEnabled | FLAG_AnimationBlended | (HitDetection == EMeleeHitDetection::SWEEP ? FLAG_SweepLimbs : 0)));
+	WindowTimes.Add(0.f);
+	AttackSections.Add(0);
+	AttackTimes.Add(0.f);
+	TimelineCursors.Add(INDEX_NONE);
+	TimelineRates.Add(1.f);
+	Cooldowns.AddZeroed(NumAttackTypes);
+
+	LimbMasks.Add(0);
+	for (int32 Limb = 0; Limb < MaxLimbsPerCombatant; ++Limb)
+	{
+		Limbs.Add(LimbBoxes.IsValidIndex(Limb) ? LimbBoxes[Limb] : nullptr);
+	}
+	PreviousLimbLocations.AddZeroed(MaxLimbsPerCombatant);
+
+	SwingIds.Add(0);
+	SwingHits.AddDefaulted();
+	BufferedAttacks.AddZeroed(InputBufferSize);
+	BufferedCounts.Add(0);
+
+	// a new combatant has no history yet, its slots read as where it is now
+	const FVector SpawnLocation = Character->GetActorLocation();
+	for (int32 Sample = 0; Sample < HistorySamples; ++Sample)
+	{
+		CapsuleHistory.Add(SpawnLocation);
+	}
+	AttackHistory.AddZeroed(HistorySamples);
+
+	const FIntPoint SpawnCell = GetGridCell(SpawnLocation);
+	GridLocations.Add(SpawnLocation);
+	GridCells.Add(SpawnCell);
+	GridBucketIndices.Add(INDEX_NONE);
+	GridPrevious.Add(INDEX_NONE);
+	GridNext.Add(INDEX_NONE);
+	LinkGridBucket(DenseIndex, GetGridBucket(SpawnCell));
+	for (int32 Limb = 0; Limb < MaxLimbsPerCombatant; ++Limb)
+	{
+		const UBoxComponent* LimbBox = Limbs[DenseIndex * MaxLimbsPerCombatant + Limb];
+		FLimbSample LimbSample;
+		LimbSample.Set(LimbBox ? LimbBox->GetComponentQuat() : FQuat::Identity, LimbBox ? LimbBox->GetComponentLocation() : FVector::ZeroVector);
+		for (int32 Sample = 0; Sample < HistorySamples; ++Sample)
+		{
+			LimbHistory.Add(LimbSample);
+		}
+	}
+
+	return CombatantId;
+}
+
+void ACombatManager::UnregisterCombatant(int32 CombatantId)
+{
+	const int32 DenseIndex = DenseIndices[CombatantId];
+	check(DenseIndex != INDEX_NONE);
+
+	// the last combatant moves into the freed dense slot
+	const int32 MovedId = CombatantIds.Last();
+	DenseIndices[MovedId] = DenseIndex;
+	DenseIndices[CombatantId] = INDEX_NONE;
+	FreeIds.Add(CombatantId);
+
+	// its grid bucket neighbours follow it there
+	UnlinkGridBucket(DenseIndex);
+	const int32 LastIndex = CombatantIds.Num() - 1;
+	if (LastIndex != DenseIndex)
+	{
+		if (GridPrevious[LastIndex] != INDEX_NONE)
+		{
+			GridNext[GridPrevious[LastIndex]] = DenseIndex;
+		}
+		else
+		{
+			GridBuckets[GridBucketIndices[LastIndex]] = DenseIndex;
+		}
+		if (GridNext[LastIndex] != INDEX_NONE)
+		{
+			GridPrevious[GridNext[LastIndex]] = DenseIndex;
+		}
+	}
+
+	CombatantIds.RemoveAtSwap(DenseIndex, 1, false);
+	Characters.RemoveAtSwap(DenseIndex, 1, false);
+	AttackTypes.RemoveAtSwap(DenseIndex, 1, false);
+	Attacks.RemoveAtSwap(DenseIndex, 1, false);
+	Flags.RemoveAtSwap(DenseIndex, 1, false);
+	WindowTimes.RemoveAtSwap(DenseIndex, 1, false);
+	AttackSections.RemoveAtSwap(DenseIndex, 1, false);
+	AttackTimes.RemoveAtSwap(DenseIndex, 1, false);
+	TimelineCursors.RemoveAtSwap(DenseIndex, 1, false);
+	TimelineRates.RemoveAtSwap(DenseIndex, 1, false);
+	LimbMasks.RemoveAtSwap(DenseIndex, 1, false);
+	SwingIds.RemoveAtSwap(DenseIndex, 1, false);
+	SwingHits.RemoveAtSwap(DenseIndex, 1, false);
+	BufferedCounts.RemoveAtSwap(DenseIndex, 1, false);
+	GridLocations.RemoveAtSwap(DenseIndex, 1, false);
+	GridCells.RemoveAtSwap(DenseIndex, 1, false);
+	GridBucketIndices.RemoveAtSwap(DenseIndex, 1, false);
+	GridPrevious.RemoveAtSwap(DenseIndex, 1, false);
+	GridNext.RemoveAtSwap(DenseIndex, 1, false);
+	RemoveStrideAtSwap(BufferedAttacks, DenseIndex, InputBufferSize);
+	RemoveStrideAtSwap(Cooldowns, DenseIndex, NumAttackTypes);
+	RemoveStrideAtSwap(Limbs, DenseIndex, MaxLimbsPerCombatant);
+	RemoveStrideAtSwap(PreviousLimbLocations, DenseIndex, MaxLimbsPerCombatant);
+	RemoveStrideAtSwap(CapsuleHistory, DenseIndex, HistorySamples);
+	RemoveStrideAtSwap(AttackHistory, DenseIndex, HistorySamples);
+	RemoveStrideAtSwap(LimbHistory, DenseIndex, MaxLimbsPerCombatant * HistorySamples);
+}
+
+bool ACombatManager::StartAttack(int32 CombatantId, EAttackType Type, const FCompiledAttack* Attack, int32 Section, bool bIgnoreCooldown)
+{
+	check(Attack);
+
+	const int32 DenseIndex = DenseIndices[CombatantId];
+
+	float& Cooldown = Cooldowns[DenseIndex * NumAttackTypes + static_cast<int32>(Type)];
+	if (Cooldown > 0.f && !bIgnoreCooldown)
+	{
+		return false;
+	}
+	Cooldown = Attack->Cooldown;
+
+	// a window left open by the interrupted attack would never get its close event, it closes on the old attack's limbs
+	if ((Flags[DenseIndex] & FLAG_WindowOpen) && Characters[DenseIndex])
+	{
+		Characters[DenseIndex]->AttackNotifyEnd();
+	}
+	SwingHits[DenseIndex].Reset();
+
+	AttackTypes[DenseIndex] = Type;
+	Attacks[DenseIndex] = Attack;
+	SetFlag(DenseIndex, FLAG_MovementEnabled, Attack->bMovementEnabled);
+	SetFlag(DenseIndex, FLAG_AnimationBlended, Attack->bAnimationBlended);
+	SetFlag(DenseIndex, FLAG_HitStopUsed, false);
+	SetFlag(DenseIndex, FLAG_AttackPlaying, true);
+
+	// every attack is a new swing, victims of the last one can be hit again
+	++SwingIds[DenseIndex];
+
+	// the timeline narrows the limbs down as the section plays
+	LimbMasks[DenseIndex] = Attack->GetSectionLimbMask(Section);
+
+	AttackSections[DenseIndex] = Section;
+	AttackTimes[DenseIndex] = 0.f;
+	TimelineCursors[DenseIndex] = Attack->HasTimeline(Section) ? Attack->SectionTimelineStarts[Section] : INDEX_NONE;
+	return true;
+}
+
+void ACombatManager::SkipAttackTime(int32 CombatantId, float Seconds)
+{
+	const int32 DenseIndex = DenseIndices[CombatantId];
+	const FCompiledAttack* Attack = Attacks[DenseIndex];
+	int32& Cursor = TimelineCursors[DenseIndex];
+	if (Attack == nullptr || (Flags[DenseIndex] & FLAG_AttackPlaying) == 0)
+	{
+		return;
+	}
+
+	// the combo table reads the clock of notify driven sections too
+	AttackTimes[DenseIndex] += Seconds;
+	if (Cursor == INDEX_NONE)
+	{
+		return;
+	}
+
+	// events in the skipped time are dropped, only the window state they leave behind is kept
+	const int32 SectionEnd = Attack->SectionTimelineStarts[AttackSections[DenseIndex] + 1];
+	bool bWindowOpen = (Flags[DenseIndex] & FLAG_WindowOpen) != 0;
+	for (; Cursor < SectionEnd && Attack->Timeline[Cursor].Time <= AttackTimes[DenseIndex]; ++Cursor)
+	{
+		const FAttackTimelineEvent& Event = Attack->Timeline[Cursor];
+		if (Event.Type == EAttackTimelineEvent::LimbMask)
+		{
+			LimbMasks[DenseIndex] = Event.LimbMask;
+		}
+		else if (Event.Type != EAttackTimelineEvent::ThrowSound)
+		{
+			bWindowOpen = Event.Type == EAttackTimelineEvent::WindowOpen;
+		}
+	}
+
+	if (bWindowOpen != ((Flags[DenseIndex] & FLAG_WindowOpen) != 0) && Characters[DenseIndex])
+	{
+		if (bWindowOpen)
+		{
+			Characters[DenseIndex]->AttackNotifyStart();
+		}
+		else
+		{
+			Characters[DenseIndex]->AttackNotifyEnd();
+		}
+	}
+}
+
+void ACombatManager::StopAttack(int32 CombatantId)
+{
+	const int32 DenseIndex = DenseIndices[CombatantId];
+	TimelineCursors[DenseIndex] = INDEX_NONE;
+	SetFlag(DenseIndex, FLAG_AttackPlaying, false);
+	BufferedCounts[DenseIndex] = 0;
+	if ((Flags[DenseIndex] & FLAG_WindowOpen) && Characters[DenseIndex])
+	{
+		Characters[DenseIndex]->AttackNotifyEnd();
+	}
+}
+
+bool ACombatManager::IsTimelineDriven(int32 CombatantId) const
+{
+	const int32 DenseIndex = DenseIndices[CombatantId];
+	const FCompiledAttack* Attack = Attacks[DenseIndex];
+	return Attack != nullptr && Attack->HasTimeline(AttackSections[DenseIndex]);
+}
+
+uint8 ACombatManager::GetSectionLimbMask(int32 CombatantId) const
+{
+	const int32 DenseIndex = DenseIndices[CombatantId];
+	const FCompiledAttack* Attack = Attacks[DenseIndex];
+	return Attack ? Attack->GetSectionLimbMask(AttackSections[DenseIndex]) : 0;
+}
+
+void ACombatManager::OpenAttackWindow(int32 CombatantId)
+{
+	const int32 DenseIndex = DenseIndices[CombatantId];
+
+	// the hit list belongs to the swing, a window reopened by a restarted montage changes nothing
+	if (Flags[DenseIndex] & FLAG_WindowOpen)
+	{
+		return;
+	}
+
+	SetFlag(DenseIndex, FLAG_WindowOpen, true);
+	WindowTimes[DenseIndex] = 0.f;
+
+	// attacks that root the character hold it for the whole window
+	const FCompiledAttack* Attack = Attacks[DenseIndex];
+	if (Attack)
+	{
+		SetFlag(DenseIndex, FLAG_MovementEnabled, Attack->bMovementEnabled);
+	}
+
+	// ranged attacks throw from the first limb the section strikes with, along the attacker's facing
+	if (Attack && Attack->IsRanged() && Characters[DenseIndex])
+	{
+		const uint8 LimbMask = LimbMasks[DenseIndex];
+		const UBoxComponent* LimbBox = Limbs[DenseIndex * MaxLimbsPerCombatant + (LimbMask != 0 ? FMath::CountTrailingZeros(LimbMask) : 0)];
+		const AActionGameCharacter* Attacker = Characters[DenseIndex];
+		const FVector Location = LimbBox ? LimbBox->GetComponentLocation() : Attacker->GetActorLocation();
+		LaunchProjectile(CombatantId, Location, Attacker->GetActorForwardVector() * Attack->ProjectileSpeed, Attack->ProjectileRadius, Attack->Damage, Attack->ProjectileLifetime, Attack->ProjectileMesh);
+	}
+
+	for (int32 Limb = 0; Limb < MaxLimbsPerCombatant; ++Limb)
+	{
+		const int32 LimbIndex = DenseIndex * MaxLimbsPerCombatant + Limb;
+		if (Limbs[LimbIndex])
+		{
+			PreviousLimbLocations[LimbIndex] = Limbs[LimbIndex]->GetComponentLocation();
+		}
+	}
+}
+
+void ACombatManager::CloseAttackWindow(int32 CombatantId)
+{
+	const int32 DenseIndex = DenseIndices[CombatantId];
+
+	SetFlag(DenseIndex, FLAG_WindowOpen, false);
+	SetFlag(DenseIndex, FLAG_MovementEnabled, true);
+}
+
+void ACombatManager::SetMovementEnabled(int32 CombatantId, bool bEnabled)
+{
+	SetFlag(DenseIndices[CombatantId], FLAG_MovementEnabled, bEnabled);
+}
+
+void ACombatManager::ApplyHitStop(int32 CombatantId, AActor* Victim)
+{
+	const int32 DenseIndex = DenseIndices[CombatantId];
+
+	const FCompiledAttack* Attack = Attacks[DenseIndex];
+	if (Attack == nullptr || !Attack->HasHitStop() || (Flags[DenseIndex] & FLAG_HitStopUsed))
+	{
+		return;
+	}
+	SetFlag(DenseIndex, FLAG_HitStopUsed, true);
+
+	StartHitStop(Characters[DenseIndex], CombatantId, *Attack);
+	if (Victim)
+	{
+		const AActionGameCharacter* VictimCharacter = Cast<AActionGameCharacter>(Victim);
+		StartHitStop(Victim, VictimCharacter ? VictimCharacter->GetCombatantId() : INDEX_NONE, *Attack);
+	}
+}
+
+void ACombatManager::SetHitsClaimedByClient(int32 CombatantId, bool bClaimed)
+{
+	SetFlag(DenseIndices[CombatantId], FLAG_ClaimedHits, bClaimed);
+}
+
+void ACombatManager::RecordAttackEventReceived(float LatencySeconds)
+{
+	if (AttackEventLatencies.Num() < MaxAttackEventLatencies)
+	{
+		AttackEventLatencies.Add(LatencySeconds);
+	}
+	else
+	{
+		AttackEventLatencies[AttackEventsReceived % MaxAttackEventLatencies] = LatencySeconds;
+	}
+	++AttackEventsReceived;
+}
+
+void ACombatManager::SetFlag(int32 DenseIndex, uint8 Flag, bool bSet)
+{
+	Flags[DenseIndex] = static_cast<uint8>(bSet ? (Flags[DenseIndex] | Flag) : (Flags[DenseIndex] & ~Flag));
+}
+
+
+//========= BATCHED UPDATE =========//
+
+void ACombatManager::UpdateCooldowns(float DeltaSeconds)
+{
+	float* Cooldown = Cooldowns.GetData();
+	for (int32 Index = 0, Count = Cooldowns.Num(); Index < Count; ++Index)
+	{
+		Cooldown[Index] = FMath::Max(Cooldown[Index] - DeltaSeconds, 0.f);
+	}
+}
+
+void ACombatManager::UpdateAttackTimelines(float DeltaSeconds)
+{
+	for (int32 DenseIndex = 0, Count = TimelineCursors.Num(); DenseIndex < Count; ++DenseIndex)
+	{
+		if ((Flags[DenseIndex] & FLAG_AttackPlaying) == 0)
+		{
+			continue;
+		}
+
+		const FCompiledAttack* Attack = Attacks[DenseIndex];
+		const int32 Section = AttackSections[DenseIndex];
+
+		// the montage's own clock, scaled like its play rate during a hit stop
+		const float Time = AttackTimes[DenseIndex] += DeltaSeconds * TimelineRates[DenseIndex];
+
+		// notify driven sections only keep the clock, for the combo table
+		int32& Cursor = TimelineCursors[DenseIndex];
+		if (Cursor == INDEX_NONE)
+		{
+			if (Time >= Attack->SectionLengths[Section])
+			{
+				SetFlag(DenseIndex, FLAG_AttackPlaying, false);
+			}
+			continue;
+		}
+
+		// a character destroyed this frame is unregistered by its EndPlay, its events are not run meanwhile
+		AActionGameCharacter* Character = Characters[DenseIndex];
+		if (Character == nullptr || Character->IsPendingKill())
+		{
+			continue;
+		}
+		const int32 SectionEnd = Attack->SectionTimelineStarts[Section + 1];
+
+		bool bOpenedThisFrame = false;
+		for (; Cursor < SectionEnd && Attack->Timeline[Cursor].Time <= Time; ++Cursor)
+		{
+			const EAttackTimelineEvent Type = Attack->Timeline[Cursor].Type;
+
+			// a window opened this frame stays open for one sweep, however long the frame was
+			if (Type == EAttackTimelineEvent::WindowClose && bOpenedThisFrame)
+			{
+				break;
+			}
+
+			switch (Type)
+			{
+			case EAttackTimelineEvent::WindowOpen:
+				Character->AttackNotifyStart();
+				bOpenedThisFrame = true;
+				break;
+
+			case EAttackTimelineEvent::WindowClose:
+				Character->AttackNotifyEnd();
+				break;
+
+			case EAttackTimelineEvent::ThrowSound:
+				Character->PlayPunchThrowSound();
+				break;
+
+			case EAttackTimelineEvent::LimbMask:
+				LimbMasks[DenseIndex] = Attack->Timeline[Cursor].LimbMask;
+				break;
+			}
+		}
+
+		if (Cursor >= SectionEnd && Time >= Attack->SectionLengths[Section])
+		{
+			Cursor = INDEX_NONE;
+			SetFlag(DenseIndex, FLAG_AttackPlaying, false);
+		}
+	}
+}
+
+void ACombatManager::UpdateInputBuffers()
+{
+	const float Now = GetWorld()->GetTimeSeconds();
+	for (int32 DenseIndex = 0, Count = BufferedCounts.Num(); DenseIndex < Count; ++DenseIndex)
+	{
+		if (BufferedCounts[DenseIndex] > 0)
+		{
+			RunInputBuffer(DenseIndex, Now);
+		}
+	}
+}
+
+void ACombatManager::UpdateAttackWindows(float DeltaSeconds)
+{
+	for (int32 DenseIndex = 0, Count = Flags.Num(); DenseIndex < Count; ++DenseIndex)
+	{
+		if (Flags[DenseIndex] & FLAG_WindowOpen)
+		{
+			WindowTimes[DenseIndex] += DeltaSeconds;
+		}
+	}
+}
+
+void ACombatManager::UpdateHitStops(float DeltaSeconds)
+{
+	// world time, the actors being slowed down do not slow their own hit stop
+	for (int32 Index = HitStops.Num() - 1; Index >= 0; --Index)
+	{
+		FHitStop& HitStop = HitStops[Index];
+		HitStop.TimeRemaining -= DeltaSeconds;
+		if (HitStop.TimeRemaining <= 0.f || !HitStop.Actor.IsValid())
+		{
+			EndHitStop(HitStop);
+			HitStops.RemoveAtSwap(Index, 1, false);
+		}
+	}
+}
+
+void ACombatManager::RunMeleeSweeps()
+{
+	UWorld* World = GetWorld();
+
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(MeleeSweep), false);
+
+	for (int32 DenseIndex = 0, Count = Flags.Num(); DenseIndex < Count; ++DenseIndex)
+	{
+		const uint8 CombatantFlags = Flags[DenseIndex];
+		const FCompiledAttack* Attack = Attacks[DenseIndex];
+		if ((CombatantFlags & FLAG_WindowOpen) == 0 || (CombatantFlags & FLAG_SweepLimbs) == 0 || (CombatantFlags & FLAG_ClaimedHits) != 0 || Attack == nullptr || Attack->IsRanged())
+		{
+			continue;
+		}
+
+		AActionGameCharacter* Attacker = Characters[DenseIndex];
+
+		QueryParams.ClearIgnoredActors();
+		QueryParams.AddIgnoredActor(Attacker);
+
+		// only the limbs the section strikes with, the others would cost a sweep and hit with the wrong limb
+		const uint8 LimbMask = LimbMasks[DenseIndex];
+		for (int32 Limb = 0; Limb < MaxLimbsPerCombatant; ++Limb)
+		{
+			const int32 LimbIndex = DenseIndex * MaxLimbsPerCombatant + Limb;
+			UBoxComponent* LimbBox = Limbs[LimbIndex];
+			if (LimbBox == nullptr)
+			{
+				continue;
+			}
+			if ((LimbMask & (1 << Limb)) == 0)
+			{
+				// swept from where it is once it joins in
+				PreviousLimbLocations[LimbIndex] = LimbBox->GetComponentLocation();
+				continue;
+			}
+
+			// sweep the limb from where it was last frame, fast limbs cannot tunnel through targets
+			const FTransform& LimbTransform = LimbBox->GetComponentTransform();
+			const FVector Start = PreviousLimbLocations[LimbIndex];
+			const FVector End = LimbTransform.GetLocation();
+			PreviousLimbLocations[LimbIndex] = End;
+
+			SweepHits.Reset();
+			World->SweepMultiByProfile(SweepHits, Start, End, LimbTransform.GetRotation(), Attack->EnabledProfileName, FCollisionShape::MakeBox(LimbBox->GetScaledBoxExtent()), QueryParams);
+
+#if COMBAT_DEBUG_DRAW
+			if (FCombatDebugDraw::IsEnabled(FCombatDebugDraw::CHANNEL_Sweeps))
+			{
+				DebugDraw.AddLine(Start, End, SweepHits.Num() > 0 ? FColor::Red : FColor::Yellow);
+			}
+#endif
+
+			// both limbs may touch the same victim, the resolve keeps one of them
+			for (const FHitResult& Hit : SweepHits)
+			{
+				AActor* HitActor = Hit.GetActor();
+				if (HitActor && !SwingHits[DenseIndex].Contains(HitActor))
+				{
+					QueueHit(CombatantIds[DenseIndex], Limb, HitActor, End);
+				}
+			}
+		}
+	}
+}
+
+void ACombatManager::BufferAttack(int32 CombatantId, EAttackType Type)
+{
+	const int32 DenseIndex = DenseIndices[CombatantId];
+	uint8& BufferedCount = BufferedCounts[DenseIndex];
+	FBufferedAttack* Buffer = &BufferedAttacks[DenseIndex * InputBufferSize];
+
+	// a full buffer drops its oldest press, mashing keeps the latest intent
+	if (BufferedCount == InputBufferSize)
+	{
+		FMemory::Memmove(Buffer, Buffer + 1, (InputBufferSize - 1) * sizeof(FBufferedAttack));
+		--BufferedCount;
+		++BufferedInputsExpired;
+		INC_DWORD_STAT(STAT_BufferedInputsExpired);
+	}
+
+	const float Now = GetWorld()->GetTimeSeconds();
+	Buffer[BufferedCount++] = FBufferedAttack{ Type, Now, FPlatformTime::Cycles64() };
+
+	// a press that is allowed right away runs this frame, the buffer adds no latency to it
+	RunInputBuffer(DenseIndex, Now);
+	if (DenseIndices[CombatantId] == DenseIndex && BufferedCounts[DenseIndex] > 0)
+	{
+		INC_DWORD_STAT(STAT_BufferedInputs);
+	}
+}
+
+void ACombatManager::RunInputBuffer(int32 DenseIndex, float Now)
+{
+	const int32 CombatantId = CombatantIds[DenseIndex];
+	AActionGameCharacter* Character = Characters[DenseIndex];
+
+	while (BufferedCounts[DenseIndex] > 0)
+	{
+		const FBufferedAttack Pressed = BufferedAttacks[DenseIndex * InputBufferSize];
+
+		bool bExpired = Now - Pressed.Time > InputBufferSeconds;
+		bool bAllowed = false;
+		int32 ToSection = FComboTransition::RandomSection;
+		if (!bExpired)
+		{
+			// one table cell per playing section and input, anything is allowed once the section is over
+			const FCompiledAttack* Attack = Attacks[DenseIndex];
+			if (Attack && (Flags[DenseIndex] & FLAG_AttackPlaying))
+			{
+				const FComboTransition& Transition = Attack->GetComboTransition(AttackSections[DenseIndex], Pressed.Type);
+				bAllowed = Transition.IsAllowedAt(AttackTimes[DenseIndex]);
+				ToSection = Transition.ToSection;
+			}
+			else
+			{
+				bAllowed = true;
+			}
+			bAllowed = bAllowed && Cooldowns[DenseIndex * NumAttackTypes + static_cast<int32>(Pressed.Type)] <= 0.f;
+		}
+
+		// the oldest press blocks the ones after it, they keep their order
+		if (!bAllowed && !bExpired)
+		{
+			return;
+		}
+
+		--BufferedCounts[DenseIndex];
+		FMemory::Memmove(&BufferedAttacks[DenseIndex * InputBufferSize], &BufferedAttacks[DenseIndex * InputBufferSize + 1], BufferedCounts[DenseIndex] * sizeof(FBufferedAttack));
+
+		if (bExpired)
+		{
+			++BufferedInputsExpired;
+			INC_DWORD_STAT(STAT_BufferedInputsExpired);
+			continue;
+		}
+
+		const float WaitMilliseconds = static_cast<float>(FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - Pressed.InputCycles));
+		if (BufferedInputWaits.Num() < MaxBufferedInputWaits)
+		{
+			BufferedInputWaits.Add(WaitMilliseconds);
+		}
+		else
+		{
+			BufferedInputWaits[BufferedInputsExecuted % MaxBufferedInputWaits] = WaitMilliseconds;
+		}
+		++BufferedInputsExecuted;
+
+		Character->ExecuteAttack(Pressed.Type, ToSection >= 0 ? ToSection : INDEX_NONE);
+
+		// the attack may have ended the character's fight, its combatant with it
+		if (DenseIndices[CombatantId] != DenseIndex)
+		{
+			return;
+		}
+	}
+}
+
+void ACombatManager::QueueHit(int32 CombatantId, int32 Limb, AActor* Victim, const FVector& Location)
+{
+	const int32 DenseIndex = DenseIndices[CombatantId];
+
+	FQueuedHit& Hit = QueuedHits[QueuedHits.AddDefaulted()];
+	Hit.Attacker = Characters[DenseIndex];
+	Hit.CombatantId = CombatantId;
+	Hit.SwingId = SwingIds[DenseIndex];
+	Hit.Limb = static_cast<uint8>(Limb);
+	Hit.Victim = Victim;
+	Hit.Location = Location;
+	Hit.ProjectileDamage = 0.f;
+}
+
+void ACombatManager::ResolveHits()
+{
+	SCOPE_CYCLE_COUNTER(STAT_ResolveHits);
+
+	const int32 NumQueued = QueuedHits.Num();
+	if (NumQueued == 0)
+	{
+		return;
+	}
+	INC_DWORD_STAT_BY(STAT_HitsQueued, NumQueued);
+
+	/** a queued hit that survived the checks, with everything the reactions need **/
+	struct FResolvedHit
+	{
+		AActionGameCharacter* Attacker;
+		AActor* Victim;
+		float Damage;
+		FVector Location;
+		int32 CombatantId;
+		int32 QueueIndex;
+		uint8 Limb;
+	};
+
+	// scratch of this resolve, given back in one go with the mark
+	FMemMark Mark(FMemStack::Get());
+	TArray<FResolvedHit, TMemStackAllocator<>> Resolved;
+	Resolved.Reserve(NumQueued);
+
+	for (int32 QueueIndex = 0; QueueIndex < NumQueued; ++QueueIndex)
+	{
+		const FQueuedHit& Hit = QueuedHits[QueueIndex];
+
+		// attackers that left, swings replaced since the hit and victims that are gone drop their hits, projectiles outlive their swing
+		AActionGameCharacter* Attacker = Hit.Attacker.Get();
+		AActor* Victim = Hit.Victim.Get();
+		const bool bProjectile = Hit.Limb == ProjectileLimb;
+		const int32 DenseIndex = DenseIndices.IsValidIndex(Hit.CombatantId) ? DenseIndices[Hit.CombatantId] : INDEX_NONE;
+		if (Attacker == nullptr || Victim == nullptr || Victim == Attacker || Victim->IsPendingKill()
+			|| DenseIndex == INDEX_NONE || Characters[DenseIndex] != Attacker || (!bProjectile && (SwingIds[DenseIndex] != Hit.SwingId || Attacks[DenseIndex] == nullptr)))
+		{
+			continue;
+		}
+
+		const float Damage = bProjectile ? Hit.ProjectileDamage : Attacks[DenseIndex]->Damage;
+		Resolved.Add(FResolvedHit{ Attacker, Victim, Damage, Hit.Location, Hit.CombatantId, QueueIndex, Hit.Limb });
+	}
+	QueuedHits.Reset();
+
+	// hits of the same attacker on the same victim line up, first queued first, the swing is the current one for all
+	Algo::Sort(Resolved, [](const FResolvedHit& A, const FResolvedHit& B)
+	{
+		if (A.CombatantId != B.CombatantId)
+		{
+			return A.CombatantId < B.CombatantId;
+		}
+		if (A.Victim != B.Victim)
+		{
+			return A.Victim < B.Victim;
+		}
+		return A.QueueIndex < B.QueueIndex;
+	});
+
+	int32 NumUnique = 0;
+	for (int32 Index = 0; Index < Resolved.Num(); ++Index)
+	{
+		const FResolvedHit& Hit = Resolved[Index];
+
+		// every projectile lands once on its own, only limb hits share the swing
+		if (Hit.Limb == ProjectileLimb)
+		{
+			Resolved[NumUnique++] = Hit;
+			continue;
+		}
+		if (Index > 0 && Resolved[Index - 1].Limb != ProjectileLimb && Resolved[Index - 1].CombatantId == Hit.CombatantId && Resolved[Index - 1].Victim == Hit.Victim)
+		{
+			continue;
+		}
+
+		// a victim takes one hit per swing, however many frames and limbs touch it
+		TArray<TWeakObjectPtr<AActor>, TInlineAllocator<4>>& Hits = SwingHits[DenseIndices[Hit.CombatantId]];
+		if (Hits.Contains(Hit.Victim))
+		{
+			continue;
+		}
+		Hits.Add(Hit.Victim);
+
+		Resolved[NumUnique++] = Hit;
+	}
+	Resolved.SetNum(NumUnique, false);
+	INC_DWORD_STAT_BY(STAT_HitsResolved, NumUnique);
+
+	// damage first, on the server only - every reaction then sees the health the hits left
+	if (GetNetMode() != NM_Client)
+	{
+		for (const FResolvedHit& Hit : Resolved)
+		{
+			Hit.Victim->TakeDamage(Hit.Damage, FDamageEvent(), Hit.Attacker->GetController(), Hit.Attacker);
+		}
+	}
+
+	// reactions may end attacks and unregister combatants, ids are checked again
+	for (const FResolvedHit& Hit : Resolved)
+	{
+		if (Hit.Attacker->IsPendingKill())
+		{
+			continue;
+		}
+		Hit.Attacker->LandHit(Hit.Limb, Hit.Victim, Hit.Location);
+
+#if COMBAT_DEBUG_DRAW
+		if (FCombatDebugDraw::IsEnabled(FCombatDebugDraw::CHANNEL_Hits))
+		{
+			DebugHits.Add(FDebugHit{ Hit.Location, GetWorld()->GetTimeSeconds() });
+		}
+#endif
+
+		// a projectile's attacker is elsewhere by now, only limb hits stop it
+		const int32 DenseIndex = DenseIndices[Hit.CombatantId];
+		if (DenseIndex != INDEX_NONE && Characters[DenseIndex] == Hit.Attacker && Hit.Limb != ProjectileLimb)
+		{
+			ApplyHitStop(Hit.CombatantId, Hit.Victim);
+		}
+	}
+}
+
+
+//========= SPATIAL GRID =========//
+
+void ACombatManager::UpdateSpatialGrid()
+{
+	SCOPE_CYCLE_COUNTER(STAT_SpatialGridUpdate);
+
+	for (int32 DenseIndex = 0, Count = Characters.Num(); DenseIndex < Count; ++DenseIndex)
+	{
+		const AActionGameCharacter* Character = Characters[DenseIndex];
+		if (Character == nullptr)
+		{
+			continue;
+		}
+
+		const FVector Location = Character->GetActorLocation();
+		GridLocations[DenseIndex] = Location;
+
+		// most combatants stay in their cell from one frame to the next, only the others are relinked
+		const FIntPoint Cell = GetGridCell(Location);
+		if (Cell != GridCells[DenseIndex])
+		{
+			GridCells[DenseIndex] = Cell;
+			const int32 Bucket = GetGridBucket(Cell);
+			if (Bucket != GridBucketIndices[DenseIndex])
+			{
+				UnlinkGridBucket(DenseIndex);
+				LinkGridBucket(DenseIndex, Bucket);
+			}
+			INC_DWORD_STAT(STAT_GridCellChanges);
+		}
+	}
+}
+
+void ACombatManager::LinkGridBucket(int32 DenseIndex, int32 Bucket)
+{
+	const int32 Head = GridBuckets[Bucket];
+	GridBucketIndices[DenseIndex] = Bucket;
+	GridPrevious[DenseIndex] = INDEX_NONE;
+	GridNext[DenseIndex] = Head;
+	if (Head != INDEX_NONE)
+	{
+		GridPrevious[Head] = DenseIndex;
+	}
+	GridBuckets[Bucket] = DenseIndex;
+}
+
+void ACombatManager::UnlinkGridBucket(int32 DenseIndex)
+{
+	const int32 Previous = GridPrevious[DenseIndex];
+	const int32 Next = GridNext[DenseIndex];
+	if (Previous != INDEX_NONE)
+	{
+		GridNext[Previous] = Next;
+	}
+	else
+	{
+		GridBuckets[GridBucketIndices[DenseIndex]] = Next;
+	}
+	if (Next != INDEX_NONE)
+	{
+		GridPrevious[Next] = Previous;
+	}
+
+	GridBucketIndices[DenseIndex] = INDEX_NONE;
+	GridPrevious[DenseIndex] = INDEX_NONE;
+	GridNext[DenseIndex] = INDEX_NONE;
+}
+
+AActionGameCharacter* ACombatManager::FindTarget(const FVector& Location, const FVector& Direction, float Radius, float MinDirectionDot, uint8 Team, const AActor* Ignore) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_FindTarget);
+
+	if (Radius <= 0.f)
+	{
+		return nullptr;
+	}
+
+	const FVector Forward = Direction.GetSafeNormal2D();
+	const FIntPoint MinCell = GetGridCell(Location - FVector(Radius, Radius, 0.f));
+	const FIntPoint MaxCell = GetGridCell(Location + FVector(Radius, Radius, 0.f));
+	const float RadiusSquared = FMath::Square(Radius);
+
+	AActionGameCharacter* Target = nullptr;
+	float TargetScore = MAX_flt;
+	uint32 CandidateCount = 0;
+
+	for (int32 Y = MinCell.Y; Y <= MaxCell.Y; ++Y)
+	{
+		for (int32 X = MinCell.X; X <= MaxCell.X; ++X)
+		{
+			const FIntPoint Cell(X, Y);
+			for (int32 DenseIndex = GridBuckets[GetGridBucket(Cell)]; DenseIndex != INDEX_NONE; DenseIndex = GridNext[DenseIndex])
+			{
+				// other cells hashing to the same bucket
+				if (GridCells[DenseIndex] != Cell)
+				{
+					continue;
+				}
+				++CandidateCount;
+
+				FVector Offset = GridLocations[DenseIndex] - Location;
+				Offset.Z = 0.f;
+				const float DistanceSquared = Offset.SizeSquared();
+				if (DistanceSquared > RadiusSquared)
+				{
+					continue;
+				}
+
+				AActionGameCharacter* Character = Characters[DenseIndex];
+				if (Character == nullptr || Character == Ignore || Character->GetTeam() == Team || Character->IsDefeated())
+				{
+					continue;
+				}
+
+				// without a direction only the distance counts
+				const float Distance = FMath::Sqrt(DistanceSquared);
+				const float DirectionDot = Forward.IsZero() || Distance < KINDA_SMALL_NUMBER ? 1.f : FVector::DotProduct(Offset / Distance, Forward);
+				if (DirectionDot < MinDirectionDot)
+				{
+					continue;
+				}
+
+				const float Score = Distance / Radius + (1.f - DirectionDot);
+				if (Score < TargetScore)
+				{
+					Target = Character;
+					TargetScore = Score;
+				}
+			}
+		}
+	}
+
+	INC_DWORD_STAT_BY(STAT_TargetCandidates, CandidateCount);
+	return Target;
+}
+
+
+//========= PROJECTILES =========//
+
+void ACombatManager::LaunchProjectile(int32 CombatantId, const FVector& Location, const FVector& Velocity, float Radius, float Damage, float Lifetime, UStaticMesh* Mesh)
+{
+	const int32 DenseIndex = DenseIndices.IsValidIndex(CombatantId) ? DenseIndices[CombatantId] : INDEX_NONE;
+	if (DenseIndex == INDEX_NONE || Characters[DenseIndex] == nullptr || Lifetime <= 0.f)
+	{
+		return;
+	}
+	if (Projectiles.Num() >= MaxProjectiles)
+	{
+		INC_DWORD_STAT(STAT_ProjectilesDropped);
+		return;
+	}
+
+	FProjectile& Projectile = Projectiles[Projectiles.AddDefaulted()];
+	Projectile.Attacker = Characters[DenseIndex];
+	Projectile.CombatantId = CombatantId;
+	Projectile.Team = Characters[DenseIndex]->GetTeam();
+	Projectile.Location = Location;
+	Projectile.Velocity = Velocity;
+	Projectile.Radius = Radius;
+	Projectile.Damage = Damage;
+	Projectile.TimeRemaining = Lifetime;
+	Projectile.MeshIndex = Mesh ? FindProjectileMesh(Mesh) : INDEX_NONE;
+	Projectile.Trace = TraceProjectileStep(Projectile, GetWorld()->GetDeltaSeconds());
+}
+
+void ACombatManager::UpdateProjectiles(float DeltaSeconds)
+{
+	SCOPE_CYCLE_COUNTER(STAT_UpdateProjectiles);
+
+	if (Projectiles.Num() == 0)
+	{
+		ProjectileUpdateMicroseconds = 0.f;
+		SET_DWORD_STAT(STAT_ProjectilesInFlight, 0);
+		UpdateProjectileMeshes();
+		return;
+	}
+
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+	UWorld* World = GetWorld();
+
+#if COMBAT_DEBUG_DRAW
+	const bool bDrawProjectiles = FCombatDebugDraw::IsEnabled(FCombatDebugDraw::CHANNEL_Projectiles);
+#endif
+
+	// backwards, a projectile that ends swaps in one already updated
+	for (int32 Index = Projectiles.Num() - 1; Index >= 0; --Index)
+	{
+		FProjectile& Projectile = Projectiles[Index];
+
+		// the world along this step was traced last frame, a blocking hit ends the step there
+		const FVector Start = Projectile.Location;
+		const float Step = FMath::Min(DeltaSeconds, Projectile.TimeRemaining);
+		FVector End = Start + Projectile.Velocity * Step;
+		bool bBlocked = false;
+
+		FTraceDatum TraceData;
+		if (Projectile.Trace.IsValid() && World->QueryTraceData(Projectile.Trace, TraceData))
+		{
+			const FHitResult* BlockingHit = TraceData.OutHits.FindByPredicate([](const FHitResult& Hit) { return Hit.bBlockingHit; });
+			if (BlockingHit && FVector::DistSquared(Start, BlockingHit->Location) <= FVector::DistSquared(Start, End))
+			{
+				End = BlockingHit->Location;
+				bBlocked = true;
+			}
+		}
+		Projectile.Trace = FTraceHandle();
+		Projectile.TimeRemaining -= Step;
+
+		// characters are tested now, the first one it meets stops it
+		const bool bHit = HitProjectileStep(Projectile, Start, End);
+
+#if COMBAT_DEBUG_DRAW
+		if (bDrawProjectiles)
+		{
+			DebugDraw.AddLine(Start, End, bHit || bBlocked ? FColor::Red : FColor::Orange);
+			DebugDraw.AddPoint(End, Projectile.Radius, FColor::Orange);
+		}
+#endif
+
+		if (bHit || bBlocked || Projectile.TimeRemaining <= 0.f)
+		{
+			Projectiles.RemoveAtSwap(Index, 1, false);
+			continue;
+		}
+
+		Projectile.Location = End;
+		Projectile.Trace = TraceProjectileStep(Projectile, DeltaSeconds);
+	}
+
+	UpdateProjectileMeshes();
+
+	ProjectileUpdateMicroseconds = static_cast<float>(FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles) * 1000.0);
+	SET_DWORD_STAT(STAT_ProjectilesInFlight, Projectiles.Num());
+}
+
+FTraceHandle ACombatManager::TraceProjectileStep(const FProjectile& Projectile, float DeltaSeconds) const
+{
+	// the next step goes to the physics thread with the others and is read back next frame
+	static const FCollisionObjectQueryParams ObjectParams(FCollisionObjectQueryParams::AllStaticObjects);
+	static const FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(ProjectileTrace), false);
+
+	const FVector End = Projectile.Location + Projectile.Velocity * FMath::Min(DeltaSeconds, Projectile.TimeRemaining);
+	return GetWorld()->AsyncLineTraceByObjectType(EAsyncTraceType::Single, Projectile.Location, End, ObjectParams, QueryParams);
+}
+
+bool ACombatManager::HitProjectileStep(const FProjectile& Projectile, const FVector& Start, const FVector& End)
+{
+	const AActionGameCharacter* Attacker = Projectile.Attacker.Get();
+	const float Reach = Projectile.Radius + ProjectileCapsuleReach;
+	const FIntPoint MinCell = GetGridCell(Start.ComponentMin(End) - FVector(Reach, Reach, 0.f));
+	const FIntPoint MaxCell = GetGridCell(Start.ComponentMax(End) + FVector(Reach, Reach, 0.f));
+
+	// the character closest to the start along the step is the one it meets first
+	AActionGameCharacter* Victim = nullptr;
+	FVector VictimLocation = End;
+	float VictimDistanceSquared = MAX_flt;
+
+	for (int32 Y = MinCell.Y; Y <= MaxCell.Y; ++Y)
+	{
+		for (int32 X = MinCell.X; X <= MaxCell.X; ++X)
+		{
+			const FIntPoint Cell(X, Y);
+			for (int32 DenseIndex = GridBuckets[GetGridBucket(Cell)]; DenseIndex != INDEX_NONE; DenseIndex = GridNext[DenseIndex])
+			{
+				AActionGameCharacter* Character = Characters[DenseIndex];
+				if (GridCells[DenseIndex] != Cell || Character == nullptr || Character == Attacker || Character->GetTeam() == Projectile.Team || Character->IsDefeated())
+				{
+					continue;
+				}
+
+				// the step against the capsule axis, both grown by their radii
+				const UCapsuleComponent* Capsule = Character->GetCapsuleComponent();
+				const float CapsuleRadius = Capsule->GetScaledCapsuleRadius();
+				const FVector AxisOffset(0.f, 0.f, FMath::Max(Capsule->GetScaledCapsuleHalfHeight() - CapsuleRadius, 0.f));
+				const FVector Center = GridLocations[DenseIndex];
+
+				FVector StepPoint;
+				FVector AxisPoint;
+				FMath::SegmentDistToSegmentSafe(Start, End, Center - AxisOffset, Center + AxisOffset, StepPoint, AxisPoint);
+				if (FVector::DistSquared(StepPoint, AxisPoint) > FMath::Square(CapsuleRadius + Projectile.Radius))
+				{
+					continue;
+				}
+
+				const float DistanceSquared = FVector::DistSquared(Start, StepPoint);
+				if (DistanceSquared < VictimDistanceSquared)
+				{
+					Victim = Character;
+					VictimLocation = StepPoint;
+					VictimDistanceSquared = DistanceSquared;
+				}
+			}
+		}
+	}
+
+	if (Victim == nullptr)
+	{
+		return false;
+	}
+
+	QueueHit(Projectile.CombatantId, ProjectileLimb, Victim, VictimLocation);
+	QueuedHits.Last().ProjectileDamage = Projectile.Damage;
+	return true;
+}
+
+void ACombatManager::UpdateProjectileMeshes()
+{
+	if (ProjectileMeshes.Num() == 0)
+	{
+		return;
+	}
+
+	// instances are moved in place, grown or trimmed at the end, never rebuilt
+	TArray<int32, TInlineAllocator<8>> InstanceCounts;
+	InstanceCounts.SetNumZeroed(ProjectileMeshes.Num());
+
+	for (const FProjectile& Projectile : Projectiles)
+	{
+		if (Projectile.MeshIndex == INDEX_NONE)
+		{
+			continue;
+		}
+
+		UInstancedStaticMeshComponent* Mesh = ProjectileMeshes[Projectile.MeshIndex];
+		const FTransform Transform(Projectile.Velocity.Rotation(), Projectile.Location);
+		const int32 Instance = InstanceCounts[Projectile.MeshIndex]++;
+		if (Instance < Mesh->GetInstanceCount())
+		{
+			Mesh->UpdateInstanceTransform(Instance, Transform, true, false, true);
+		}
+		else
+		{
+			Mesh->AddInstanceWorldSpace(Transform);
+		}
+	}
+
+	for (int32 MeshIndex = 0; MeshIndex < ProjectileMeshes.Num(); ++MeshIndex)
+	{
+		// an idle mesh with no instances left keeps its render state
+		UInstancedStaticMeshComponent* Mesh = ProjectileMeshes[MeshIndex];
+		const int32 InstanceCount = Mesh->GetInstanceCount();
+		if (InstanceCount == 0)
+		{
+			continue;
+		}
+		for (int32 Instance = InstanceCount - 1; Instance >= InstanceCounts[MeshIndex]; --Instance)
+		{
+			Mesh->RemoveInstance(Instance);
+		}
+		Mesh->MarkRenderStateDirty();
+	}
+}
+
+int32 ACombatManager::FindProjectileMesh(UStaticMesh* Mesh)
+{
+	for (int32 MeshIndex = 0; MeshIndex < ProjectileMeshes.Num(); ++MeshIndex)
+	{
+		if (ProjectileMeshes[MeshIndex]->GetStaticMesh() == Mesh)
+		{
+			return MeshIndex;
+		}
+	}
+
+	// nothing draws without presentation
+	if (!FActionGameProfile::HasPresentation())
+	{
+		return INDEX_NONE;
+	}
+
+	UInstancedStaticMeshComponent* Component = NewObject<UInstancedStaticMeshComponent>(this);
+	Component->SetMobility(EComponentMobility::Movable);
+	Component->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Component->SetCastShadow(false);
+	Component->SetStaticMesh(Mesh);
+	if (RootComponent == nullptr)
+	{
+		SetRootComponent(Component);
+	}
+	Component->RegisterComponent();
+
+	return ProjectileMeshes.Add(Component);
+}
+
+
+//========= HIT STOP =========//
+
+void ACombatManager::StartHitStop(AActor* Actor, int32 CombatantId, const FCompiledAttack& Attack)
+{
+	// an actor already frozen is held longer, never slowed down twice
+	if (FHitStop* Existing = HitStops.FindByPredicate([Actor](const FHitStop& HitStop) { return HitStop.Actor.Get() == Actor; }))
+	{
+		Existing->TimeRemaining = FMath::Max(Existing->TimeRemaining, Attack.HitStopDuration);
+		return;
+	}
+
+	FHitStop& HitStop = HitStops[HitStops.AddDefaulted()];
+	HitStop.Actor = Actor;
+	HitStop.TimeRemaining = Attack.HitStopDuration;
+	HitStop.RestorePlayRate = 1.f;
+	HitStop.RestoreTimeDilation = Actor->CustomTimeDilation;
+
+	// only a combatant of this manager has a timeline to slow down
+	const int32 DenseIndex = DenseIndices.IsValidIndex(CombatantId) ? DenseIndices[CombatantId] : INDEX_NONE;
+	HitStop.CombatantId = DenseIndex != INDEX_NONE && Characters[DenseIndex] == Actor ? CombatantId : INDEX_NONE;
+	float TimelineRate = 1.f;
+
+	// scale the montage in place - restarting it would fire its blends and notifies again
+	const ACharacter* Character = Cast<ACharacter>(Actor);
+	UAnimInstance* AnimInstance = Character && Character->GetMesh() ? Character->GetMesh()->GetAnimInstance() : nullptr;
+	UAnimMontage* Montage = AnimInstance ? AnimInstance->GetCurrentActiveMontage() : nullptr;
+	if (Montage && Attack.HitStopPlayRate < 1.f)
+	{
+		HitStop.AnimInstance = AnimInstance;
+		HitStop.Montage = Montage;
+		HitStop.RestorePlayRate = AnimInstance->Montage_GetPlayRate(Montage);
+		AnimInstance->Montage_SetPlayRate(Montage, HitStop.RestorePlayRate * Attack.HitStopPlayRate);
+		TimelineRate = Attack.HitStopPlayRate;
+	}
+
+	if (Attack.HitStopTimeDilation < 1.f)
+	{
+		Actor->CustomTimeDilation = HitStop.RestoreTimeDilation * Attack.HitStopTimeDilation;
+		TimelineRate *= Attack.HitStopTimeDilation;
+	}
+
+	// the timeline keeps pace with the montage it stands in for
+	if (HitStop.CombatantId != INDEX_NONE)
+	{
+		TimelineRates[DenseIndices[HitStop.CombatantId]] = TimelineRate;
+	}
+}
+
+void ACombatManager::EndHitStop(const FHitStop& HitStop)
+{
+	if (UAnimInstance* AnimInstance = HitStop.AnimInstance.Get())
+	{
+		// a montage that has ended or been replaced meanwhile is left alone
+		UAnimMontage* Montage = HitStop.Montage.Get();
+		if (Montage && AnimInstance->Montage_IsPlaying(Montage))
+		{
+			AnimInstance->Montage_SetPlayRate(Montage, HitStop.RestorePlayRate);
+		}
+	}
+
+	if (AActor* Actor = HitStop.Actor.Get())
+	{
+		Actor->CustomTimeDilation = HitStop.RestoreTimeDilation;
+
+		// the id may have been reused if the combatant left meanwhile
+		if (HitStop.CombatantId != INDEX_NONE && DenseIndices.IsValidIndex(HitStop.CombatantId))
+		{
+			const int32 DenseIndex = DenseIndices[HitStop.CombatantId];
+			if (Characters.IsValidIndex(DenseIndex) && Characters[DenseIndex] == Actor)
+			{
+				TimelineRates[DenseIndex] = 1.f;
+			}
+		}
+	}
+}
+
+
+//========= LAG COMPENSATION =========//
+
+void ACombatManager::RecordHistory()
+{
+	// only a server has claims to check
+	const ENetMode NetMode = GetNetMode();
+	if (NetMode != NM_DedicatedServer && NetMode != NM_ListenServer)
+	{
+		return;
+	}
+
+	HistoryHead = (HistoryHead + 1) % HistorySamples;
+	HistoryCount = FMath::Min(HistoryCount + 1, HistorySamples);
+	HistoryTimes[HistoryHead] = GetWorld()->GetTimeSeconds();
+
+	for (int32 DenseIndex = 0, Count = Characters.Num(); DenseIndex < Count; ++DenseIndex)
+	{
+		if (const AActionGameCharacter* Character = Characters[DenseIndex])
+		{
+			CapsuleHistory[DenseIndex * HistorySamples + HistoryHead] = Character->GetActorLocation();
+		}
+
+		FAttackSample& AttackSample = AttackHistory[DenseIndex * HistorySamples + HistoryHead];
+		AttackSample.SwingId = SwingIds[DenseIndex];
+		AttackSample.Section = static_cast<int16>(AttackSections[DenseIndex]);
+		AttackSample.Flags = Flags[DenseIndex];
+
+		for (int32 Limb = 0; Limb < MaxLimbsPerCombatant; ++Limb)
+		{
+			const int32 LimbIndex = DenseIndex * MaxLimbsPerCombatant + Limb;
+			if (const UBoxComponent* LimbBox = Limbs[LimbIndex])
+			{
+				LimbHistory[LimbIndex * HistorySamples + HistoryHead].Set(LimbBox->GetComponentQuat(), LimbBox->GetComponentLocation());
+			}
+		}
+	}
+}
+
+bool ACombatManager::FindHistorySlots(float Time, int32& OutOlder, int32& OutNewer) const
+{
+	if (HistoryCount == 0)
+	{
+		return false;
+	}
+
+	// newest sample at or before Time, and the one after it
+	OutOlder = HistoryHead;
+	OutNewer = HistoryHead;
+	for (int32 Step = 0; Step < HistoryCount; ++Step)
+	{
+		const int32 Slot = (HistoryHead - Step + HistorySamples) % HistorySamples;
+		OutOlder = Slot;
+		if (HistoryTimes[Slot] <= Time)
+		{
+			break;
+		}
+		OutNewer = Slot;
+	}
+	return true;
+}
+
+bool ACombatManager::RewindCombatant(int32 DenseIndex, float Time, FVector& OutCapsuleLocation, FTransform* OutLimbTransforms) const
+{
+	int32 Older, Newer;
+	if (!FindHistorySlots(Time, Older, Newer))
+	{
+		return false;
+	}
+
+	const float Span = HistoryTimes[Newer] - HistoryTimes[Older];
+	const float Alpha = Span > KINDA_SMALL_NUMBER ? FMath::Clamp((Time - HistoryTimes[Older]) / Span, 0.f, 1.f) : 0.f;
+
+	const int32 CapsuleBase = DenseIndex * HistorySamples;
+	OutCapsuleLocation = FMath::Lerp(CapsuleHistory[CapsuleBase + Older], CapsuleHistory[CapsuleBase + Newer], Alpha);
+
+	if (OutLimbTransforms)
+	{
+		for (int32 Limb = 0; Limb < MaxLimbsPerCombatant; ++Limb)
+		{
+			const int32 LimbBase = (DenseIndex * MaxLimbsPerCombatant + Limb) * HistorySamples;
+			const FLimbSample& From = LimbHistory[LimbBase + Older];
+			const FLimbSample& To = LimbHistory[LimbBase + Newer];
+			OutLimbTransforms[Limb] = FTransform(FQuat::Slerp(From.GetRotation(), To.GetRotation(), Alpha), FMath::Lerp(From.Location, To.Location, Alpha));
+		}
+	}
+	return true;
+}
+
+bool ACombatManager::IsLimbStrikingAt(int32 DenseIndex, int32 Limb, float Time) const
+{
+	const FCompiledAttack* Attack = Attacks[DenseIndex];
+	if (Attack == nullptr)
+	{
+		return false;
+	}
+
+	const uint8 Striking = FLAG_AttackPlaying | FLAG_WindowOpen;
+	int32 Older, Newer;
+	if (!FindHistorySlots(Time, Older, Newer))
+	{
+		// nothing recorded yet, only the state right now counts
+		return (Flags[DenseIndex] & Striking) == Striking && (Attack->GetSectionLimbMask(AttackSections[DenseIndex]) & (1 << Limb)) != 0;
+	}
+
+	// the claim falls between two server ticks, either of them striking with the current swing will do
+	for (const int32 Slot : { Older, Newer })
+	{
+		const FAttackSample& Sample = AttackHistory[DenseIndex * HistorySamples + Slot];
+		if (Sample.SwingId == SwingIds[DenseIndex] && (Sample.Flags & Striking) == Striking
+			&& (Attack->GetSectionLimbMask(Sample.Section) & (1 << Limb)) != 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+bool ACombatManager::ValidateMeleeHit(int32 CombatantId, int32 Limb, AActor* Victim, float ServerTime)
+{
+	const int32 DenseIndex = DenseIndices.IsValidIndex(CombatantId) ? DenseIndices[CombatantId] : INDEX_NONE;
+	if (DenseIndex == INDEX_NONE)
+	{
+		++HitClaimsRejected;
+		return false;
+	}
+
+	const FCompiledAttack* Attack = Attacks[DenseIndex];
+	UBoxComponent* LimbBox = Limb >= 0 && Limb < MaxLimbsPerCombatant ? Limbs[DenseIndex * MaxLimbsPerCombatant + Limb] : nullptr;
+
+	const float Now = GetWorld()->GetTimeSeconds();
+	const float Rewind = Now - ServerTime;
+
+	// claims a little ahead of the server clock are estimate jitter and clamped to now, further ones are made up
+	const float Time = FMath::Min(ServerTime, Now);
+	bool bValid = Attack != nullptr && LimbBox != nullptr && Victim != nullptr && Victim != Characters[DenseIndex]
+		&& Rewind <= MaxRewindMilliseconds / 1000.f
+		&& Rewind >= -FutureToleranceMilliseconds / 1000.f
+		&& IsLimbStrikingAt(DenseIndex, Limb, Time)
+		&& !SwingHits[DenseIndex].Contains(Victim);
+
+	if (bValid)
+	{
+		FVector AttackerLocation;
+		FTransform LimbTransforms[MaxLimbsPerCombatant];
+		if (!RewindCombatant(DenseIndex, Time, AttackerLocation, LimbTransforms))
+		{
+			LimbTransforms[Limb] = FTransform(LimbBox->GetComponentQuat(), LimbBox->GetComponentLocation());
+		}
+		const FVector LimbExtent = LimbBox->GetScaledBoxExtent();
+
+		const AActionGameCharacter* VictimCharacter = Cast<AActionGameCharacter>(Victim);
+		const int32 VictimId = VictimCharacter ? VictimCharacter->GetCombatantId() : INDEX_NONE;
+		if (VictimId != INDEX_NONE && DenseIndices.IsValidIndex(VictimId) && DenseIndices[VictimId] != INDEX_NONE && Characters[DenseIndices[VictimId]] == VictimCharacter)
+		{
+			FVector VictimLocation;
+			if (!RewindCombatant(DenseIndices[VictimId], Time, VictimLocation, nullptr))
+			{
+				VictimLocation = VictimCharacter->GetActorLocation();
+			}
+
+			float Radius, HalfHeight;
+			VictimCharacter->GetCapsuleComponent()->GetScaledCapsuleSize(Radius, HalfHeight);
+			bValid = LimbTouchesCapsule(LimbTransforms[Limb], LimbExtent, VictimLocation, Radius, HalfHeight, HitTolerance);
+		}
+		else
+		{
+			// anything else has no history, checked where it is now
+			FVector Origin, Extent;
+			Victim->GetActorBounds(true, Origin, Extent);
+			const FBox Bounds(Origin - Extent, Origin + Extent);
+			bValid = Bounds.ComputeSquaredDistanceToPoint(LimbTransforms[Limb].GetLocation()) <= FMath::Square(LimbExtent.Size() + HitTolerance);
+		}
+	}
+
+	if (bValid)
+	{
+		QueueHit(CombatantId, Limb, Victim, LimbBox->GetComponentLocation());
+		++HitClaimsAccepted;
+	}
+	else
+	{
+		++HitClaimsRejected;
+		AG_LOG(Combat, DEBUG, "Hit claim of combatant {} rejected, rewind {} s", CombatantId, Rewind);
+	}
+	return bValid;
+}
+
+bool ACombatManager::ValidateAttack(int32 CombatantId, EAttackType Type, int32 Section) const
+{
+	const int32 DenseIndex = DenseIndices.IsValidIndex(CombatantId) ? DenseIndices[CombatantId] : INDEX_NONE;
+	if (DenseIndex == INDEX_NONE)
+	{
+		return false;
+	}
+
+	// anything may start once the playing section is over, here or on the client
+	const FCompiledAttack* Attack = Attacks[DenseIndex];
+	const int32 FromSection = AttackSections[DenseIndex];
+	if (Attack == nullptr || !(Flags[DenseIndex] & FLAG_AttackPlaying) || !Attack->SectionLengths.IsValidIndex(FromSection))
+	{
+		return true;
+	}
+
+	const float Tolerance = MaxRewindMilliseconds / 1000.f;
+	const float Time = AttackTimes[DenseIndex];
+	if (Time >= Attack->SectionLengths[FromSection] - Tolerance)
+	{
+		return true;
+	}
+
+	const FComboTransition& Transition = Attack->GetComboTransition(FromSection, Type);
+	return Transition.ToSection != FComboTransition::NoTransition
+		&& (Transition.ToSection == FComboTransition::RandomSection || Transition.ToSection == Section)
+		&& Time >= Transition.CancelStart - Tolerance
+		&& Time <= Transition.CancelEnd + Tolerance;
+}
+
+
+//========= DEBUG DRAW =========//
+
+#if COMBAT_DEBUG_DRAW
+
+void ACombatManager::DrawDebug()
+{
+	const uint8 Channels = FCombatDebugDraw::GetChannels();
+	const float Now = GetWorld()->GetTimeSeconds();
+
+	// hits fade out even while the channel is off, so turning it back on starts clean
+	const float HitSeconds = FCombatDebugDraw::GetHitSeconds();
+	const int32 ExpiredHits = DebugHits.IndexOfByPredicate([Now, HitSeconds](const FDebugHit& Hit) { return Now - Hit.Time <= HitSeconds; });
+	DebugHits.RemoveAt(0, ExpiredHits == INDEX_NONE ? DebugHits.Num() : ExpiredHits, false);
+
+	if (Channels == 0)
+	{
+		DebugDraw.Flush(GetWorld());
+		return;
+	}
+
+	for (int32 DenseIndex = 0, Count = Flags.Num(); DenseIndex < Count; ++DenseIndex)
+	{
+		const AActionGameCharacter* Character = Characters[DenseIndex];
+		if (Character == nullptr || Character->IsPendingKill())
+		{
+			continue;
+		}
+
+		const FCompiledAttack* Attack = Attacks[DenseIndex];
+		const bool bWindowOpen = (Flags[DenseIndex] & FLAG_WindowOpen) != 0;
+
+		// limbs that can hit this frame
+		if ((Channels & FCombatDebugDraw::CHANNEL_Hitboxes) && bWindowOpen)
+		{
+			for (int32 Limb = 0; Limb < MaxLimbsPerCombatant; ++Limb)
+			{
+				const UBoxComponent* LimbBox = Limbs[DenseIndex * MaxLimbsPerCombatant + Limb];
+				if (LimbBox && (LimbMasks[DenseIndex] & (1 << Limb)))
+				{
+					DebugDraw.AddBox(LimbBox->GetComponentTransform(), LimbBox->GetScaledBoxExtent(), FColor::Red);
+				}
+			}
+		}
+
+		// a bar over the head, filled up to the time into the section, red while the window is open
+		const bool bTimelineRunning = TimelineCursors[DenseIndex] != INDEX_NONE;
+		if ((Channels & FCombatDebugDraw::CHANNEL_Windows) && Attack && (bWindowOpen || bTimelineRunning))
+		{
+			const float BarLength = 100.f;
+			const FVector Up(0.f, 0.f, Character->GetCapsuleComponent()->GetScaledCapsuleHalfHeight() + 30.f);
+			const FVector Start = Character->GetActorLocation() + Up - Character->GetActorRightVector() * (BarLength * 0.5f);
+			const FVector Direction = Character->GetActorRightVector() * BarLength;
+
+			const int32 Section = AttackSections[DenseIndex];
+			const float Progress = bTimelineRunning && Attack->SectionLengths.IsValidIndex(Section) && Attack->SectionLengths[Section] > 0.f
+				? FMath::Clamp(AttackTimes[DenseIndex] / Attack->SectionLengths[Section], 0.f, 1.f)
+				: 1.f;
+
+			DebugDraw.AddLine(Start, Start + Direction, FColor(64, 64, 64));
+			DebugDraw.AddLine(Start + FVector(0.f, 0.f, 4.f), Start + FVector(0.f, 0.f, 4.f) + Direction * Progress, bWindowOpen ? FColor::Red : FColor::White);
+		}
+	}
+
+	if (Channels & FCombatDebugDraw::CHANNEL_Hits)
+	{
+		for (const FDebugHit& Hit : DebugHits)
+		{
+			DebugDraw.AddPoint(Hit.Location, 12.f, FColor::Magenta);
+		}
+	}
+
+	DebugDraw.Flush(GetWorld());
+}
+
+#endif
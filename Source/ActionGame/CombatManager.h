@@ -0,0 +1,483 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/ArrayView.h"
+#include "GameFramework/Actor.h"
+#include "WorldCollision.h"
+
+#include "AttackCatalogue.h"
+#include "CombatDebugDraw.h"
+
+#include "CombatManager.generated.h"
+
+class AActionGameCharacter;
+class UAnimInstance;
+class UAnimMontage;
+class UBoxComponent;
+class UInstancedStaticMeshComponent;
+class UStaticMesh;
+
+
+UENUM(BlueprintType)
+enum class EMeleeHitDetection : uint8 {
+	PHYSICS_EVENTS	UMETA(DisplayName = "Physics hit events"),
+	SWEEP			UMETA(DisplayName = "Swept shape queries")
+};
+
+
+/**
+ * World level combat update.
+ *
+ * Holds the attack state of every combatant in contiguous arrays (one entry per
+ * combatant, swap-removed on unregister) and advances cooldowns, attack windows
+ * and melee hit resolution for all of them in one batched update per frame.
+ * Characters keep a combatant id and read their state through it.
+ *
+ * Projectiles of ranged attacks are plain data in a preallocated pool, advanced
+ * together once per frame. Their world traces run as one async batch and are read
+ * back the next frame, and characters along each step are found in the spatial grid.
+ *
+ * Hits from every source (limb sweeps, projectiles, physics hit events, accepted client claims)
+ * are queued during the frame and resolved together at the end of the update:
+ * duplicates of the same (attacker, swing, victim) are dropped, damage is applied,
+ * then reactions, sounds and hit stops run for the hits that are left.
+ *
+ * Spawned on demand, one per game world.
+ */
+UCLASS(NotBlueprintable, Transient)
+class ACTIONGAME_API ACombatManager : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	/** limb box slots per combatant, slots past the combatant's limbs stay empty **/
+	static const int32 MaxLimbsPerCombatant = FCompiledAttack::MaxLimbs;
+
+	/** attack presses a combatant can hold waiting for their combo transition **/
+	static const int32 InputBufferSize = 4;
+
+	/** server ticks of capsule and limb transforms kept for rewinding **/
+	static const int32 HistorySamples = 32;
+
+	/** projectiles in flight at once, the pool is allocated up front **/
+	static const int32 MaxProjectiles = 1024;
+
+	/** limb of hits landed by projectiles, never claimed by clients **/
+	static const uint8 ProjectileLimb = 0xFF;
+
+	ACombatManager();
+
+	/** Returns the combat manager of WorldContextObject's world, spawning it when needed **/
+	static ACombatManager* Get(const UObject* WorldContextObject);
+
+	virtual void Tick(float DeltaSeconds) override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/** Adds Character with its limb boxes (in the order attack rows number limbs) and returns its combatant id **/
+	int32 RegisterCombatant(AActionGameCharacter* Character, TArrayView<UBoxComponent*> LimbBoxes, EMeleeHitDetection HitDetection);
+
+	void UnregisterCombatant(int32 CombatantId);
+
+	/**
+	 * Makes Attack the combatant's current attack, playing Section. Returns false while the attack type
+	 * is cooling down, unless bIgnoreCooldown is set for attacks the server has already accepted.
+	 * Sections with a timeline open and close their attack window and play their sounds on montage
+	 * time kept here, so throttled or skipped animation evaluation cannot move or miss them.
+	 */
+	bool StartAttack(int32 CombatantId, EAttackType Type, const FCompiledAttack* Attack, int32 Section, bool bIgnoreCooldown = false);
+
+	/** Fast forwards the attack timeline, for attacks that started Seconds ago elsewhere **/
+	void SkipAttackTime(int32 CombatantId, float Seconds);
+
+	/** Ends the current attack's timeline and closes its window **/
+	void StopAttack(int32 CombatantId);
+
+	/**
+	 * Buffers an attack press of the combatant. It runs on the first frame the combo table of the playing
+	 * section allows it and its attack is off cooldown, this frame when it already is, and is dropped once
+	 * older than ActionGame.Combo.BufferSeconds. Runs call AActionGameCharacter::ExecuteAttack.
+	 */
+	void BufferAttack(int32 CombatantId, EAttackType Type);
+
+	/** Whether an attack section is still playing, on the montage clock kept here **/
+	FORCEINLINE bool IsAttackPlaying(int32 CombatantId) const { return (Flags[DenseIndices[CombatantId]] & FLAG_AttackPlaying) != 0; }
+
+	/** Whether the current attack runs on its timeline, its notify states are ignored then **/
+	bool IsTimelineDriven(int32 CombatantId) const;
+
+	/** Attack window opened / closed by the attack notify state **/
+	void OpenAttackWindow(int32 CombatantId);
+	void CloseAttackWindow(int32 CombatantId);
+
+	FORCEINLINE EAttackType GetAttackType(int32 CombatantId) const { return AttackTypes[DenseIndices[CombatantId]]; }
+	FORCEINLINE const FCompiledAttack* GetAttack(int32 CombatantId) const { return Attacks[DenseIndices[CombatantId]]; }
+	FORCEINLINE bool IsMovementEnabled(int32 CombatantId) const { return (Flags[DenseIndices[CombatantId]] & FLAG_MovementEnabled) != 0; }
+	FORCEINLINE bool IsAnimationBlended(int32 CombatantId) const { return (Flags[DenseIndices[CombatantId]] & FLAG_AnimationBlended) != 0; }
+	FORCEINLINE bool IsAttackWindowOpen(int32 CombatantId) const { return (Flags[DenseIndices[CombatantId]] & FLAG_WindowOpen) != 0; }
+
+	/** Limbs the current attack's section strikes with at some point, bit N for limb N **/
+	uint8 GetSectionLimbMask(int32 CombatantId) const;
+
+	/** Whether Limb of the current attack can hit at this point of its section **/
+	FORCEINLINE bool IsLimbActive(int32 CombatantId, int32 Limb) const { return (LimbMasks[DenseIndices[CombatantId]] & (1 << Limb)) != 0; }
+
+	void SetMovementEnabled(int32 CombatantId, bool bEnabled);
+
+	/** Combatants whose hits are claimed by their owning client are not swept on the server **/
+	void SetHitsClaimedByClient(int32 CombatantId, bool bClaimed);
+
+	/**
+	 * Checks a hit claimed by a client: rewinds the attacker's Limb and the victim to
+	 * ServerTime (the server time the client saw the hit at) and tests the limb box
+	 * against the victim's capsule. The current swing must have had its window open with
+	 * Limb striking at that time. An accepted hit is queued like a swept one.
+	 */
+	bool ValidateMeleeHit(int32 CombatantId, int32 Limb, AActor* Victim, float ServerTime);
+
+	/**
+	 * Checks an attack a client started against the combo table of the section the server plays.
+	 * The client's clock runs ahead of or behind the server's by up to the hit claim rewind, so a
+	 * cancel window is accepted that much early or late. Cooldowns are left to StartAttack.
+	 */
+	bool ValidateAttack(int32 CombatantId, EAttackType Type, int32 Section) const;
+
+	/**
+	 * Queues a hit of the combatant's current swing on Victim, landed by Limb at Location.
+	 * Resolved with the rest of the frame's hits, a victim takes one hit per swing.
+	 */
+	void QueueHit(int32 CombatantId, int32 Limb, AActor* Victim, const FVector& Location);
+
+	/**
+	 * Freezes the combatant and Victim for the current attack's hit stop by scaling their
+	 * montage play rate (and custom time dilation when the attack asks for it).
+	 * Applied at most once per swing, later hits of the same swing are ignored.
+	 */
+	void ApplyHitStop(int32 CombatantId, AActor* Victim);
+
+	FORCEINLINE bool IsInHitStop(const AActor* Actor) const { return HitStops.ContainsByPredicate([Actor](const FHitStop& HitStop) { return HitStop.Actor.Get() == Actor; }); }
+
+	FORCEINLINE int32 GetNumCombatants() const { return Characters.Num(); }
+
+	/**
+	 * Best target around Location for a fighter of Team: a character of another team within Radius and
+	 * inside the cone around Direction whose cosine is MinDirectionDot, closer and more centered scoring
+	 * better. Reads only the spatial grid cells the radius covers, so the cost follows how crowded the
+	 * area is rather than how many combatants there are. nullptr when nobody qualifies.
+	 */
+	AActionGameCharacter* FindTarget(const FVector& Location, const FVector& Direction, float Radius, float MinDirectionDot, uint8 Team, const AActor* Ignore) const;
+
+	/**
+	 * Launches a projectile of the combatant from Location, flying at Velocity for Lifetime seconds and
+	 * hitting the first character within Radius of its path for Damage. Mesh is drawn as an instance,
+	 * nullptr draws nothing. Dropped when the pool is full.
+	 */
+	void LaunchProjectile(int32 CombatantId, const FVector& Location, const FVector& Velocity, float Radius, float Damage, float Lifetime, UStaticMesh* Mesh);
+
+	FORCEINLINE int32 GetNumProjectiles() const { return Projectiles.Num(); }
+
+	/** game thread cost of the last projectile update **/
+	FORCEINLINE float GetProjectileUpdateMicroseconds() const { return ProjectileUpdateMicroseconds; }
+
+	/** Counts a landed hit, reported by the benchmark **/
+	FORCEINLINE void RecordHit() { ++HitCount; }
+	FORCEINLINE uint64 GetHitCount() const { return HitCount; }
+
+	/** Counts replicated attack events and the delay received ones arrived with, reported by the net report **/
+	FORCEINLINE void RecordAttackEventSent() { ++AttackEventsSent; }
+	void RecordAttackEventReceived(float LatencySeconds);
+	FORCEINLINE uint32 GetAttackEventsSent() const { return AttackEventsSent; }
+	FORCEINLINE uint32 GetAttackEventsReceived() const { return AttackEventsReceived; }
+	FORCEINLINE const TArray<float>& GetAttackEventLatencies() const { return AttackEventLatencies; }
+
+	/** Delay from buffered attack presses to their attack starting, a bounded window, and presses dropped unexecuted **/
+	FORCEINLINE const TArray<float>& GetBufferedInputWaits() const { return BufferedInputWaits; }
+	FORCEINLINE uint32 GetBufferedInputsExpired() const { return BufferedInputsExpired; }
+
+	FORCEINLINE uint32 GetHitClaimsAccepted() const { return HitClaimsAccepted; }
+	FORCEINLINE uint32 GetHitClaimsRejected() const { return HitClaimsRejected; }
+
+private:
+	enum ECombatantFlags : uint8
+	{
+		FLAG_MovementEnabled	= 1 << 0,
+		FLAG_AnimationBlended	= 1 << 1,
+		FLAG_WindowOpen			= 1 << 2,
+		FLAG_SweepLimbs			= 1 << 3,
+		FLAG_HitStopUsed		= 1 << 4,
+		FLAG_ClaimedHits		= 1 << 5,
+		FLAG_AttackPlaying		= 1 << 6,
+	};
+
+	/** attack press waiting in a combatant's input buffer **/
+	struct FBufferedAttack
+	{
+		EAttackType Type;
+
+		/** world time of the press, for expiry **/
+		float Time;
+
+		/** wall clock of the press, for the reported wait **/
+		uint64 InputCycles;
+	};
+
+	/** hit waiting for the end of frame resolve **/
+	struct FQueuedHit
+	{
+		/** the id is only trusted while it still belongs to Attacker **/
+		TWeakObjectPtr<AActionGameCharacter> Attacker;
+		int32 CombatantId;
+		uint16 SwingId;
+		uint8 Limb;
+		TWeakObjectPtr<AActor> Victim;
+		FVector Location;
+
+		/** damage of a projectile hit, limb hits take their attack's when resolved **/
+		float ProjectileDamage;
+	};
+
+	/** projectile in flight, its world trace covers the step it takes next, issued a frame ahead **/
+	struct FProjectile
+	{
+		TWeakObjectPtr<AActionGameCharacter> Attacker;
+		int32 CombatantId;
+
+		/** team of the attacker at launch, its fighters are flown through **/
+		uint8 Team;
+
+		FVector Location;
+		FVector Velocity;
+		float Radius;
+		float Damage;
+		float TimeRemaining;
+
+		/** instanced mesh drawing it, INDEX_NONE for none **/
+		int32 MeshIndex;
+
+		FTraceHandle Trace;
+	};
+
+	/** one actor slowed down by a hit stop **/
+	struct FHitStop
+	{
+		TWeakObjectPtr<AActor> Actor;
+		TWeakObjectPtr<UAnimInstance> AnimInstance;
+		TWeakObjectPtr<UAnimMontage> Montage;
+		float TimeRemaining;
+		float RestorePlayRate;
+		float RestoreTimeDilation;
+
+		/** combatant whose timeline is slowed down with the montage **/
+		int32 CombatantId;
+	};
+
+	void SetFlag(int32 DenseIndex, uint8 Flag, bool bSet);
+
+	/** Slows Actor down for the attack's hit stop, CombatantId is its combatant or INDEX_NONE for other actors **/
+	void StartHitStop(AActor* Actor, int32 CombatantId, const FCompiledAttack& Attack);
+	void EndHitStop(const FHitStop& HitStop);
+
+	void UpdateCooldowns(float DeltaSeconds);
+	void UpdateAttackTimelines(float DeltaSeconds);
+	void UpdateAttackWindows(float DeltaSeconds);
+	void UpdateHitStops(float DeltaSeconds);
+	void UpdateInputBuffers();
+
+	/** Hits and advances every projectile, then issues their world traces as one batch **/
+	void UpdateProjectiles(float DeltaSeconds);
+
+	/** Issues the async world trace of the step Projectile takes next, lasting DeltaSeconds **/
+	FTraceHandle TraceProjectileStep(const FProjectile& Projectile, float DeltaSeconds) const;
+
+	/** Queues a hit on the first character within the projectile's radius of Start to End, returns whether one was found **/
+	bool HitProjectileStep(const FProjectile& Projectile, const FVector& Start, const FVector& End);
+
+	/** Moves the projectile mesh instances to their projectiles **/
+	void UpdateProjectileMeshes();
+	int32 FindProjectileMesh(UStaticMesh* Mesh);
+
+	/** Runs and drops the buffered presses of DenseIndex that are allowed or expired, oldest first **/
+	void RunInputBuffer(int32 DenseIndex, float Now);
+	void RunMeleeSweeps();
+	void ResolveHits();
+	void RecordHistory();
+
+	/** Moves combatants that changed cell to their new grid bucket **/
+	void UpdateSpatialGrid();
+	void LinkGridBucket(int32 DenseIndex, int32 Bucket);
+	void UnlinkGridBucket(int32 DenseIndex);
+
+#if COMBAT_DEBUG_DRAW
+	/** Adds hitboxes, attack windows and recent hits to the frame's debug lines and draws them **/
+	void DrawDebug();
+#endif
+
+	/** Interpolates the history of DenseIndex at Time, returns false without samples **/
+	bool RewindCombatant(int32 DenseIndex, float Time, FVector& OutCapsuleLocation, FTransform* OutLimbTransforms) const;
+
+	/** Whether the current swing of DenseIndex had its window open with Limb striking at Time **/
+	bool IsLimbStrikingAt(int32 DenseIndex, int32 Limb, float Time) const;
+
+	/** History slots at or before Time and right after it, false without history **/
+	bool FindHistorySlots(float Time, int32& OutOlder, int32& OutNewer) const;
+
+	//========= COMBATANT STATE, INDEXED BY DENSE INDEX =========//
+
+	UPROPERTY()
+	TArray<AActionGameCharacter*> Characters;
+
+	TArray<EAttackType> AttackTypes;
+	TArray<const FCompiledAttack*> Attacks;
+	TArray<uint8> Flags;
+
+	/** time the attack window has been open **/
+	TArray<float> WindowTimes;
+
+	/** section played, seconds into it on the montage clock, next timeline event (INDEX_NONE once done) and hit stop rate **/
+	TArray<int32> AttackSections;
+	TArray<float> AttackTimes;
+	TArray<int32> TimelineCursors;
+	TArray<float> TimelineRates;
+
+	/** seconds left before each attack type can be used again, EAttackType::MAX per combatant **/
+	TArray<float> Cooldowns;
+
+	/** limbs of the current attack that can hit now, bit N for limb N **/
+	TArray<uint8> LimbMasks;
+
+	/** limb boxes and their location after the last sweep, MaxLimbsPerCombatant per combatant **/
+	UPROPERTY()
+	TArray<UBoxComponent*> Limbs;
+	TArray<FVector> PreviousLimbLocations;
+
+	/** presses waiting to run, InputBufferSize per combatant, oldest first, and how many each holds **/
+	TArray<FBufferedAttack> BufferedAttacks;
+	TArray<uint8> BufferedCounts;
+
+	/** swing of the current attack, counted up by every attack start **/
+	TArray<uint16> SwingIds;
+
+	/** actors already hit by the current swing **/
+	TArray<TArray<TWeakObjectPtr<AActor>, TInlineAllocator<4>>> SwingHits;
+
+	/** limb box pose at one history slot, the rotation quantized to 16 bits per component and the scale left out, it never changes **/
+	struct FLimbSample
+	{
+		FVector Location;
+		int16 Rotation[4];
+
+		FORCEINLINE void Set(const FQuat& InRotation, const FVector& InLocation)
+		{
+			const FQuat Normalized = InRotation.GetNormalized();
+			Location = InLocation;
+			Rotation[0] = static_cast<int16>(FMath::RoundToInt(Normalized.X * MAX_int16));
+			Rotation[1] = static_cast<int16>(FMath::RoundToInt(Normalized.Y * MAX_int16));
+			Rotation[2] = static_cast<int16>(FMath::RoundToInt(Normalized.Z * MAX_int16));
+			Rotation[3] = static_cast<int16>(FMath::RoundToInt(Normalized.W * MAX_int16));
+		}
+
+		FORCEINLINE FQuat GetRotation() const
+		{
+			return FQuat(Rotation[0], Rotation[1], Rotation[2], Rotation[3]).GetNormalized();
+		}
+	};
+
+	/**
+	 * Capsule locations (HistorySamples per combatant) and limb poses (HistorySamples per limb)
+	 * of the last server ticks, written in place as a ring and never reallocated while the
+	 * combatant count is stable. HistoryTimes holds the world time of each slot. With the attack
+	 * samples a combatant costs about 3 KB: 2.5 KB of limb poses, 384 B of capsule locations
+	 * and 192 B of attack state.
+	 */
+	TArray<FVector> CapsuleHistory;
+	TArray<FLimbSample> LimbHistory;
+
+	/** attack state of a combatant at one history slot **/
+	struct FAttackSample
+	{
+		uint16 SwingId;
+		int16 Section;
+		uint8 Flags;
+	};
+
+	/** HistorySamples per combatant, claims are checked against the window of their time **/
+	TArray<FAttackSample> AttackHistory;
+	float HistoryTimes[HistorySamples];
+	int32 HistoryHead;
+	int32 HistoryCount;
+
+	/**
+	 * Location at the last grid update, its cell, and the bucket list the cell hashes to: dense
+	 * indices of the previous and next combatant in the same bucket, INDEX_NONE at the ends.
+	 */
+	TArray<FVector> GridLocations;
+	TArray<FIntPoint> GridCells;
+	TArray<int32> GridBucketIndices;
+	TArray<int32> GridPrevious;
+	TArray<int32> GridNext;
+
+	//========= SPATIAL GRID =========//
+
+	/** first combatant of each bucket, INDEX_NONE when empty **/
+	TArray<int32> GridBuckets;
+
+	//========= PROJECTILES =========//
+
+	/** in flight, swap-removed, never grown past MaxProjectiles **/
+	TArray<FProjectile> Projectiles;
+
+	/** one instanced mesh per projectile mesh, none without presentation **/
+	UPROPERTY()
+	TArray<UInstancedStaticMeshComponent*> ProjectileMeshes;
+
+	float ProjectileUpdateMicroseconds;
+
+	//========= ID MAPPING =========//
+
+	/** combatant id -> dense index, INDEX_NONE for free ids **/
+	TArray<int32> DenseIndices;
+
+	/** dense index -> combatant id **/
+	TArray<int32> CombatantIds;
+
+	TArray<int32> FreeIds;
+
+	/** this frame's hits, emptied by the resolve but keeping its capacity for the next frame **/
+	TArray<FQueuedHit> QueuedHits;
+
+	/** actors currently in hit stop, at most one entry per actor **/
+	TArray<FHitStop> HitStops;
+
+	/** reused between sweeps **/
+	TArray<FHitResult> SweepHits;
+
+	/** hits landed since the manager was spawned **/
+	uint64 HitCount;
+
+	uint32 AttackEventsSent;
+	uint32 AttackEventsReceived;
+	uint32 HitClaimsAccepted;
+	uint32 HitClaimsRejected;
+
+	/** latest received event delays in seconds, a bounded window **/
+	TArray<float> AttackEventLatencies;
+
+	/** latest buffered press waits in milliseconds, a bounded window **/
+	TArray<float> BufferedInputWaits;
+	uint32 BufferedInputsExecuted;
+	uint32 BufferedInputsExpired;
+
+#if COMBAT_DEBUG_DRAW
+	/** lines of this frame, sweeps are added as they run **/
+	FCombatDebugDraw DebugDraw;
+
+	/** resolved hits still drawn, oldest first **/
+	struct FDebugHit
+	{
+		FVector Location;
+		float Time;
+	};
+	TArray<FDebugHit> DebugHits;
+#endif
+};
@@ -0,0 +1,363 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CombatMemoryReport.h"
+#include "ActionGame.h"
+#include "ActionGameCharacter.h"
+#include "ActionGameLog.h"
+#include "CombatStatistics.h"
+#include "Animation/AnimInstance.h"
+#include "Animation/AnimMontage.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "EngineUtils.h"
+#include "Engine/World.h"
+#include "GameFramework/GameModeBase.h"
+#include "GameFramework/PlayerStart.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformMemory.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Policies/PrettyJsonPrintPolicy.h"
+#include "Serialization/ArchiveCountMem.h"
+#include "Serialization/JsonWriter.h"
+#include "UObject/GarbageCollection.h"
+#include "UObject/UnrealType.h"
+
+
+namespace
+{
+	FAutoConsoleCommandWithWorldAndArgs MemoryReportCommand(
+		TEXT("ActionGame.Memory.Report"),
+		TEXT("Measures the memory of one combat character against its budget. Usage: ActionGame.Memory.Report [Characters]"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+		{
+			FString Params = TEXT("-NoQuit");
+			if (Args.Num() > 0)
+			{
+				Params += FString::Printf(TEXT(" -MemoryCharacters=%s"), *Args[0]);
+			}
+			ACombatMemoryReport::Start(World, *Params);
+		}));
+
+	/** frames the characters run before they are measured, enough for their first attack to start **/
+	const int32 SettleFrames = 30;
+
+	/** parts listed in the log when the budget is exceeded **/
+	const int32 LoggedParts = 10;
+
+	/** Bytes Object holds itself: its properties, the containers they own and its exclusive resources **/
+	int64 GetObjectBytes(UObject* Object)
+	{
+		FArchiveCountMem CountMem(Object);
+		return static_cast<int64>(Object->GetClass()->GetPropertiesSize()) + static_cast<int64>(CountMem.GetMax()) + static_cast<int64>(Object->GetResourceSizeBytes(EResourceSizeMode::Exclusive));
+	}
+
+	/** Number of dynamic delegate bindings on Object, such as the hit events bound in BeginPlay **/
+	int32 CountDelegateBindings(const UObject* Object)
+	{
+		int32 Bindings = 0;
+		for (TFieldIterator<UMulticastDelegateProperty> It(Object->GetClass()); It; ++It)
+		{
+			if (const FMulticastScriptDelegate* Delegate = It->GetPropertyValuePtr_InContainer(Object))
+			{
+				Bindings += Delegate->GetAllObjects().Num();
+			}
+		}
+		return Bindings;
+	}
+}
+
+
+ACombatMemoryReport::ACombatMemoryReport()
+{
+	PrimaryActorTick.bCanEverTick = true;
+
+	SetReplicates(false);
+
+	CharacterBudgetKB = 512;
+	CharacterCount = 16;
+	bQuitWhenDone = true;
+	Frame = 0;
+	MemoryBeforeSpawn = 0;
+	ProcessBytes = 0;
+	PresentationBytes = 0;
+}
+
+ACombatMemoryReport* ACombatMemoryReport::Start(UWorld* World, const TCHAR* Params)
+{
+	if (World == nullptr || !World->IsGameWorld())
+	{
+		return nullptr;
+	}
+
+	ACombatMemoryReport* Report = World->SpawnActor<ACombatMemoryReport>();
+	if (Report == nullptr)
+	{
+		return nullptr;
+	}
+
+	FParse::Value(Params, TEXT("MemoryCharacters="), Report->CharacterCount);
+	FParse::Value(Params, TEXT("MemoryBudgetKB="), Report->CharacterBudgetKB);
+	Report->CharacterCount = FMath::Max(Report->CharacterCount, 1);
+	Report->bQuitWhenDone = !FParse::Param(Params, TEXT("NoQuit"));
+	Report->OutputPath = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Benchmarks"), FString::Printf(TEXT("CombatMemory-%s.json"), *FDateTime::Now().ToString()));
+
+	// the game's pawn when it is a combat character, the native class otherwise
+	AGameModeBase* GameMode = World->GetAuthGameMode();
+	if (GameMode && GameMode->DefaultPawnClass && GameMode->DefaultPawnClass->IsChildOf(AActionGameCharacter::StaticClass()))
+	{
+		Report->CharacterClass = *GameMode->DefaultPawnClass;
+	}
+	else
+	{
+		Report->CharacterClass = AActionGameCharacter::StaticClass();
+	}
+
+	AG_LOG(Combat, INFO, "Combat memory report started, {} characters, budget {} KB each", Report->CharacterCount, Report->CharacterBudgetKB);
+	return Report;
+}
+
+void ACombatMemoryReport::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	DestroyCharacters();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void ACombatMemoryReport::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	if (Frame == 0)
+	{
+		MemoryBeforeSpawn = FPlatformMemory::GetStats().UsedPhysical;
+		SpawnCharacters();
+	}
+	else if (Frame == 1)
+	{
+		// an attack in flight creates the montage instances a fighting character holds
+		for (AActionGameCharacter* Character : Characters)
+		{
+			Character->AttackInput(EAttackType::MELEE_FIST);
+		}
+	}
+	else if (Frame == SettleFrames)
+	{
+		ProcessBytes = static_cast<int64>(FPlatformMemory::GetStats().UsedPhysical) - static_cast<int64>(MemoryBeforeSpawn);
+		Measure();
+
+		const bool bWithinBudget = WriteReport();
+		DestroyCharacters();
+		SetActorTickEnabled(false);
+		if (bQuitWhenDone)
+		{
+			FPlatformMisc::RequestExitWithStatus(false, bWithinBudget ? 0 : 1);
+		}
+		else
+		{
+			Destroy();
+		}
+	}
+	++Frame;
+}
+
+void ACombatMemoryReport::SpawnCharacters()
+{
+	UWorld* World = GetWorld();
+
+	FVector Origin(0.f, 0.f, 300.f);
+	for (TActorIterator<APlayerStart> It(World); It; ++It)
+	{
+		Origin = It->GetActorLocation();
+		break;
+	}
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+
+	// far enough apart that nobody is hit and hit reactions stay out of the numbers
+	const float Spacing = 500.f;
+
+	Characters.Reserve(CharacterCount);
+	for (int32 Index = 0; Index < CharacterCount; ++Index)
+	{
+		const FVector Location = Origin + FVector((Index % 8) * Spacing, (Index / 8) * Spacing, 0.f);
+		if (AActionGameCharacter* Character = World->SpawnActor<AActionGameCharacter>(CharacterClass, Location, FRotator::ZeroRotator, SpawnParameters))
+		{
+			Characters.Add(Character);
+		}
+	}
+}
+
+void ACombatMemoryReport::DestroyCharacters()
+{
+	for (AActionGameCharacter* Character : Characters)
+	{
+		if (Character && !Character->IsPendingKill())
+		{
+			Character->Destroy();
+		}
+	}
+	Characters.Reset();
+}
+
+void ACombatMemoryReport::Measure()
+{
+	for (AActionGameCharacter* Character : Characters)
+	{
+		if (Character == nullptr || Character->IsPendingKill())
+		{
+			continue;
+		}
+
+		AddObject(FString::Printf(TEXT("Actor (%s)"), *Character->GetClass()->GetName()), Character);
+
+		TInlineComponentArray<UActorComponent*> Components;
+		Character->GetComponents(Components);
+		for (UActorComponent* Component : Components)
+		{
+			const int64 Bytes = AddObject(FString::Printf(TEXT("%s (%s)"), *Component->GetName(), *Component->GetClass()->GetName()), Component);
+			if (Character->IsPresentationComponent(Component))
+			{
+				PresentationBytes += Bytes;
+			}
+		}
+
+		if (UAnimInstance* AnimInstance = Character->GetMesh()->GetAnimInstance())
+		{
+			AddObject(FString::Printf(TEXT("Anim instance (%s)"), *AnimInstance->GetClass()->GetName()), AnimInstance);
+
+			const int64 MontageBytes = AnimInstance->MontageInstances.GetAllocatedSize() + AnimInstance->MontageInstances.Num() * sizeof(FAnimMontageInstance);
+			AddBytes(Parts, TEXT("Montage instances"), MontageBytes);
+		}
+	}
+}
+
+int64 ACombatMemoryReport::AddObject(const FString& Name, UObject* Object)
+{
+	const int64 Bytes = GetObjectBytes(Object);
+	AddBytes(Parts, Name, Bytes);
+
+	const int32 Bindings = CountDelegateBindings(Object);
+	if (Bindings > 0)
+	{
+		AddBytes(Parts, TEXT("Dynamic delegate bindings"), Bindings * sizeof(FScriptDelegate));
+	}
+
+	// assets are shared by every character, counted once and kept out of the budget
+	TArray<UObject*> References;
+	FReferenceFinder ReferenceFinder(References, nullptr, false, true, false, true);
+	ReferenceFinder.FindReferences(Object);
+	for (UObject* Reference : References)
+	{
+		if (Reference && Reference->IsAsset() && !CountedAssets.Contains(Reference))
+		{
+			CountedAssets.Add(Reference);
+			AddBytes(SharedAssets, FString::Printf(TEXT("%s (%s)"), *Reference->GetPathName(), *Reference->GetClass()->GetName()), GetObjectBytes(Reference));
+		}
+	}
+	return Bytes;
+}
+
+void ACombatMemoryReport::AddBytes(TArray<FMemoryEntry>& Entries, const FString& Name, int64 Bytes)
+{
+	FMemoryEntry* Entry = Entries.FindByPredicate([&Name](const FMemoryEntry& Existing) { return Existing.Name == Name; });
+	if (Entry == nullptr)
+	{
+		Entry = &Entries[Entries.Add(FMemoryEntry{ Name, 0, 0 })];
+	}
+	Entry->Bytes += Bytes;
+	++Entry->Count;
+}
+
+bool ACombatMemoryReport::WriteReport() const
+{
+	const int32 Measured = FMath::Max(Characters.Num(), 1);
+
+	TArray<FMemoryEntry> SortedParts = Parts;
+	SortedParts.Sort([](const FMemoryEntry& A, const FMemoryEntry& B) { return A.Bytes > B.Bytes; });
+
+	int64 TotalBytes = 0;
+	for (const FMemoryEntry& Part : SortedParts)
+	{
+		TotalBytes += Part.Bytes;
+	}
+	int64 SharedBytes = 0;
+	for (const FMemoryEntry& Asset : SharedAssets)
+	{
+		SharedBytes += Asset.Bytes;
+	}
+
+	const int64 BytesPerCharacter = TotalBytes / Measured;
+	const int64 BudgetBytes = static_cast<int64>(CharacterBudgetKB) * 1024;
+	const bool bWithinBudget = CharacterBudgetKB <= 0 || BytesPerCharacter <= BudgetBytes;
+
+	FString Json;
+	TSharedRef<TJsonWriter<TCHAR, TPrettyJsonPrintPolicy<TCHAR>>> Writer = TJsonWriterFactory<TCHAR, TPrettyJsonPrintPolicy<TCHAR>>::Create(&Json);
+
+	Writer->WriteObjectStart();
+	FCombatStatistics::WriteBuild(Writer);
+
+	Writer->WriteValue(TEXT("map"), GetWorld()->GetMapName());
+	Writer->WriteValue(TEXT("character_class"), CharacterClass ? CharacterClass->GetName() : FString());
+	Writer->WriteValue(TEXT("characters"), Characters.Num());
+	Writer->WriteValue(TEXT("bytes_per_character"), BytesPerCharacter);
+	Writer->WriteValue(TEXT("budget_bytes"), BudgetBytes);
+	Writer->WriteValue(TEXT("within_budget"), bWithinBudget);
+
+	// with presentation, what a dedicated server saves per character, none without
+	Writer->WriteValue(TEXT("presentation"), FActionGameProfile::HasPresentation());
+	Writer->WriteValue(TEXT("presentation_bytes_per_character"), PresentationBytes / Measured);
+
+	// physical memory the process grew by, includes allocator slack and the shared assets loaded for the first character
+	Writer->WriteValue(TEXT("process_bytes_per_character"), ProcessBytes / Measured);
+
+	Writer->WriteArrayStart(TEXT("parts"));
+	for (const FMemoryEntry& Part : SortedParts)
+	{
+		Writer->WriteObjectStart();
+		Writer->WriteValue(TEXT("name"), Part.Name);
+		Writer->WriteValue(TEXT("bytes_per_character"), Part.Bytes / Measured);
+		Writer->WriteValue(TEXT("count_per_character"), static_cast<float>(Part.Count) / Measured);
+		Writer->WriteObjectEnd();
+	}
+	Writer->WriteArrayEnd();
+
+	Writer->WriteObjectStart(TEXT("shared_assets"));
+	Writer->WriteValue(TEXT("bytes"), SharedBytes);
+	Writer->WriteArrayStart(TEXT("assets"));
+	for (const FMemoryEntry& Asset : SharedAssets)
+	{
+		Writer->WriteObjectStart();
+		Writer->WriteValue(TEXT("name"), Asset.Name);
+		Writer->WriteValue(TEXT("bytes"), Asset.Bytes);
+		Writer->WriteObjectEnd();
+	}
+	Writer->WriteArrayEnd();
+	Writer->WriteObjectEnd();
+
+	Writer->WriteObjectEnd();
+	Writer->Close();
+
+	if (FFileHelper::SaveStringToFile(Json, *OutputPath))
+	{
+		AG_LOG(Combat, INFO, "Combat memory report written to {}", OutputPath);
+	}
+	else
+	{
+		AG_LOG(Combat, ERROR, "Combat memory report could not write {}", OutputPath);
+	}
+
+	if (bWithinBudget)
+	{
+		AG_LOG(Combat, INFO, "Combat memory: {} bytes per character, {} of them presentation only, budget {} bytes, shared assets {} bytes", BytesPerCharacter, PresentationBytes / Measured, BudgetBytes, SharedBytes);
+		return true;
+	}
+
+	AG_LOG(Combat, ERROR, "Combat memory: {} bytes per character exceeds the budget of {} bytes by {} bytes. Largest parts:", BytesPerCharacter, BudgetBytes, BytesPerCharacter - BudgetBytes);
+	for (int32 Index = 0; Index < FMath::Min(SortedParts.Num(), LoggedParts); ++Index)
+	{
+		AG_LOG(Combat, ERROR, "    {} bytes  {}", SortedParts[Index].Bytes / Measured, SortedParts[Index].Name);
+	}
+	return false;
+}
@@ -0,0 +1,96 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+
+#include "CombatMemoryReport.generated.h"
+
+class AActionGameCharacter;
+
+
+/**
+ * Memory footprint of one combat character, checked against a budget.
+ *
+ * Spawns characters headless, lets them start an attack so their anim instance and
+ * montage instances exist, then measures what each of them holds on its own: the
+ * actor, every component, the anim instance, montage instances and the dynamic
+ * delegates bound on them. Assets the characters reference (meshes, montages, sound
+ * cues) are shared and listed apart from the per character cost. The average per
+ * character is compared against CharacterBudgetKB, and the part of it a dedicated
+ * server leaves out (see FActionGameProfile) is reported on its own, results are written as JSON to
+ * Saved/Benchmarks and a run over budget logs the largest parts and, when it quits
+ * the game, exits with code 1.
+ *
+ * Run with
+ *     ActionGame -nullrhi -unattended -CombatMemoryReport [-MemoryCharacters=16] [-MemoryBudgetKB=<KB>] [-ServerProfile] [-NoQuit]
+ * or from the console with "ActionGame.Memory.Report [Characters]".
+ */
+UCLASS(NotBlueprintable, Transient, config=Game)
+class ACTIONGAME_API ACombatMemoryReport : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	ACombatMemoryReport();
+
+	/** Spawns a report in World configured from Params (command line style) **/
+	static ACombatMemoryReport* Start(UWorld* World, const TCHAR* Params);
+
+	virtual void Tick(float DeltaSeconds) override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/** memory one character may hold on its own, shared assets not included **/
+	UPROPERTY(config)
+	int32 CharacterBudgetKB;
+
+	/** characters measured **/
+	int32 CharacterCount;
+
+	/** exit the game once the report is written **/
+	bool bQuitWhenDone;
+
+	/** JSON report file **/
+	FString OutputPath;
+
+	UPROPERTY()
+	TSubclassOf<AActionGameCharacter> CharacterClass;
+
+private:
+	/** bytes of one part of the characters, summed over all of them **/
+	struct FMemoryEntry
+	{
+		FString Name;
+		int64 Bytes;
+		int32 Count;
+	};
+
+	void SpawnCharacters();
+	void DestroyCharacters();
+	void Measure();
+
+	/** Adds the bytes Object holds on its own to the entry called Name, returns them **/
+	int64 AddObject(const FString& Name, UObject* Object);
+	void AddBytes(TArray<FMemoryEntry>& Entries, const FString& Name, int64 Bytes);
+
+	/** Writes the report and returns whether the characters fit the budget **/
+	bool WriteReport() const;
+
+	UPROPERTY()
+	TArray<AActionGameCharacter*> Characters;
+
+	/** per character parts and shared assets, by name **/
+	TArray<FMemoryEntry> Parts;
+	TArray<FMemoryEntry> SharedAssets;
+
+	/** assets already counted in SharedAssets **/
+	TSet<const UObject*> CountedAssets;
+
+	int32 Frame;
+	uint64 MemoryBeforeSpawn;
+	int64 ProcessBytes;
+
+	/** bytes of the presentation only components, summed over all characters **/
+	int64 PresentationBytes;
+};
@@ -0,0 +1,123 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CombatMoveSet.h"
+#include "ActionGameLog.h"
+#include "Engine/DataTable.h"
+
+
+namespace
+{
+	/** move sets are owned by the characters and preloads using them **/
+	TMap<TWeakObjectPtr<const UClass>, TWeakPtr<FCombatMoveSet>> MoveSets;
+}
+
+
+TSharedRef<FCombatMoveSet> FCombatMoveSet::Request(const UClass* Archetype, const TSoftObjectPtr<UDataTable>& AttackTable, const TArray<FSoftObjectPath>& Assets)
+{
+	check(IsInGameThread());
+
+	if (const TWeakPtr<FCombatMoveSet>* Existing = MoveSets.Find(Archetype))
+	{
+		if (TSharedPtr<FCombatMoveSet> MoveSet = Existing->Pin())
+		{
+			return MoveSet.ToSharedRef();
+		}
+	}
+
+	// drop archetypes whose move set has been released
+	for (auto It = MoveSets.CreateIterator(); It; ++It)
+	{
+		if (!It.Key().IsValid() || !It.Value().IsValid())
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	TSharedRef<FCombatMoveSet> MoveSet = MakeShared<FCombatMoveSet>();
+	MoveSet->AttackTable = AttackTable;
+	MoveSet->Assets = Assets;
+	MoveSets.Add(Archetype, MoveSet);
+
+	AG_LOG(Combat, DEBUG, "Streaming move set of {}", Archetype ? Archetype->GetFName() : NAME_None);
+
+	// the table is small, the montages it points to are only known once it is in
+	if (AttackTable.IsNull())
+	{
+		MoveSet->OnTableLoaded();
+	}
+	else
+	{
+		MoveSet->TableHandle = GetStreamableManager().RequestAsyncLoad(AttackTable.ToSoftObjectPath(),
+			FStreamableDelegate::CreateSP(MoveSet, &FCombatMoveSet::OnTableLoaded), FStreamableManager::AsyncLoadHighPriority);
+	}
+	return MoveSet;
+}
+
+void FCombatMoveSet::CallWhenLoaded(FSimpleDelegate Delegate)
+{
+	if (bLoaded)
+	{
+		Delegate.ExecuteIfBound();
+	}
+	else
+	{
+		LoadedDelegates.Add(MoveTemp(Delegate));
+	}
+}
+
+FStreamableManager& FCombatMoveSet::GetStreamableManager()
+{
+	static FStreamableManager StreamableManager;
+	return StreamableManager;
+}
+
+void FCombatMoveSet::OnTableLoaded()
+{
+	TArray<FSoftObjectPath> AssetPaths = Assets;
+
+	if (const UDataTable* Table = AttackTable.Get())
+	{
+		static const FString ContextString(TEXT("Combat Move Set Context"));
+		TArray<FPlayAttackMontage*> Rows;
+		Table->GetAllRows<FPlayAttackMontage>(ContextString, Rows);
+		for (const FPlayAttackMontage* Row : Rows)
+		{
+			if (!Row->Montage.IsNull())
+			{
+				AssetPaths.AddUnique(Row->Montage.ToSoftObjectPath());
+			}
+			if (!Row->ProjectileMesh.IsNull())
+			{
+				AssetPaths.AddUnique(Row->ProjectileMesh.ToSoftObjectPath());
+			}
+		}
+	}
+	else if (!AttackTable.IsNull())
+	{
+		AG_LOG(Combat, ERROR, "Move set: attack table {} could not be loaded", AttackTable.ToString());
+	}
+
+	if (AssetPaths.Num() == 0)
+	{
+		OnAssetsLoaded();
+		return;
+	}
+
+	AssetsHandle = GetStreamableManager().RequestAsyncLoad(AssetPaths,
+		FStreamableDelegate::CreateSP(this, &FCombatMoveSet::OnAssetsLoaded), FStreamableManager::AsyncLoadHighPriority);
+}
+
+void FCombatMoveSet::OnAssetsLoaded()
+{
+	// montages are resident, the catalogue can resolve their sections and notifies
+	Catalogue = FAttackCatalogue::Get(AttackTable.Get());
+	bLoaded = true;
+
+	AG_LOG(Combat, DEBUG, "Move set loaded from {}", AttackTable.ToString());
+
+	TArray<FSimpleDelegate> Delegates = MoveTemp(LoadedDelegates);
+	for (FSimpleDelegate& Delegate : Delegates)
+	{
+		Delegate.ExecuteIfBound();
+	}
+}
@@ -0,0 +1,59 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/StreamableManager.h"
+#include "UObject/SoftObjectPtr.h"
+
+#include "AttackCatalogue.h"
+
+
+/**
+ * Combat content of one character archetype, streamed in the background.
+ *
+ * Loads the archetype's attack table, then every montage its rows point to along
+ * with the archetype's other assets (sounds), and compiles the attack catalogue once
+ * they are resident. Shared by all characters of the archetype: the assets stay
+ * loaded while one of them (or a preload) holds the move set and are unloaded by
+ * the next garbage collection after the last one lets go.
+ */
+class ACTIONGAME_API FCombatMoveSet : public TSharedFromThis<FCombatMoveSet>
+{
+public:
+	FCombatMoveSet()
+		: bLoaded(false)
+	{
+	}
+
+	/**
+	 * Returns the move set of Archetype, starting to stream it on first request.
+	 * AttackTable and Assets are only read when the archetype has no move set yet.
+	 */
+	static TSharedRef<FCombatMoveSet> Request(const UClass* Archetype, const TSoftObjectPtr<UDataTable>& AttackTable, const TArray<FSoftObjectPath>& Assets);
+
+	FORCEINLINE bool IsLoaded() const { return bLoaded; }
+
+	/** compiled attacks, invalid until loaded **/
+	FORCEINLINE const TSharedPtr<const FAttackCatalogue>& GetCatalogue() const { return Catalogue; }
+
+	/** Calls Delegate once everything is resident, right away when it already is **/
+	void CallWhenLoaded(FSimpleDelegate Delegate);
+
+	/** streaming of all combat content, the game thread never waits on it **/
+	static FStreamableManager& GetStreamableManager();
+
+private:
+	void OnTableLoaded();
+	void OnAssetsLoaded();
+
+	TSoftObjectPtr<UDataTable> AttackTable;
+	TArray<FSoftObjectPath> Assets;
+
+	TSharedPtr<FStreamableHandle> TableHandle;
+	TSharedPtr<FStreamableHandle> AssetsHandle;
+
+	TSharedPtr<const FAttackCatalogue> Catalogue;
+	TArray<FSimpleDelegate> LoadedDelegates;
+	bool bLoaded;
+};
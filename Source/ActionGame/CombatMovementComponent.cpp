@@ -0,0 +1,211 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CombatMovementComponent.h"
+#include "ActionGameCharacter.h"
+#include "CombatLatencyTracer.h"
+#include "GameFramework/Character.h"
+
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Movement corrections sent"), STAT_MovementCorrectionsSent, STATGROUP_ActionGameCombat);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Movement corrections received"), STAT_MovementCorrectionsReceived, STATGROUP_ActionGameCombat);
+
+namespace
+{
+	/** compressed move flags the attack state is packed into **/
+	const uint8 FLAG_AttackLocked = FSavedMove_Character::FLAG_Custom_0;
+	const uint8 FLAG_Lunging = FSavedMove_Character::FLAG_Custom_1;
+}
+
+
+UCombatMovementComponent::UCombatMovementComponent()
+{
+	bAttackLocked = false;
+	bLunging = false;
+	LungeSpeed = 0.f;
+	LungeTimeRemaining = 0.f;
+	CorrectionsSent = 0;
+	CorrectionsReceived = 0;
+}
+
+void UCombatMovementComponent::StartLunge(float Speed, float Duration)
+{
+	if (Speed <= 0.f || Duration <= 0.f)
+	{
+		return;
+	}
+	LungeSpeed = Speed;
+	LungeTimeRemaining = Duration;
+}
+
+void UCombatMovementComponent::StopLunge()
+{
+	LungeTimeRemaining = 0.f;
+}
+
+bool UCombatMovementComponent::IsAttackStateLocal() const
+{
+	// the server follows the flags of the moves a remote player sends
+	return CharacterOwner == nullptr || CharacterOwner->Role != ROLE_Authority || CharacterOwner->GetRemoteRole() != ROLE_AutonomousProxy;
+}
+
+void UCombatMovementComponent::TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	// the state of this frame's move, saved with it before it runs
+	if (IsAttackStateLocal())
+	{
+		const AActionGameCharacter* Character = Cast<AActionGameCharacter>(CharacterOwner);
+		bAttackLocked = Character && !Character->IsMovementEnabled();
+		bLunging = LungeTimeRemaining > 0.f;
+	}
+
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+}
+
+float UCombatMovementComponent::GetMaxAcceleration() const
+{
+	// a rooted attack drops input on every side alike, root motion and lunges still move the character
+	return bAttackLocked ? 0.f : Super::GetMaxAcceleration();
+}
+
+void UCombatMovementComponent::CalcVelocity(float DeltaTime, float Friction, bool bFluid, float BrakingDeceleration)
+{
+	if (bLunging && IsMovingOnGround() && CharacterOwner)
+	{
+		const float VerticalSpeed = Velocity.Z;
+		Velocity = CharacterOwner->GetActorForwardVector().GetSafeNormal2D() * LungeSpeed;
+		Velocity.Z = VerticalSpeed;
+		return;
+	}
+
+	Super::CalcVelocity(DeltaTime, Friction, bFluid, BrakingDeceleration);
+}
+
+void UCombatMovementComponent::UpdateCharacterStateAfterMovement(float DeltaSeconds)
+{
+	Super::UpdateCharacterStateAfterMovement(DeltaSeconds);
+
+	// replayed moves count the lunge down again from the time saved with them, the server counts its own down with the client's moves
+	if (LungeTimeRemaining > 0.f)
+	{
+		LungeTimeRemaining = FMath::Max(LungeTimeRemaining - DeltaSeconds, 0.f);
+	}
+}
+
+void UCombatMovementComponent::UpdateFromCompressedFlags(uint8 Flags)
+{
+	Super::UpdateFromCompressedFlags(Flags);
+
+	bAttackLocked = (Flags & FLAG_AttackLocked) != 0;
+	bLunging = (Flags & FLAG_Lunging) != 0;
+
+	if (IsAttackStateLocal())
+	{
+		return;
+	}
+
+	// the client's flags only narrow the server's own attack state, they never free a rooted attack or lunge past the server's attack
+	const AActionGameCharacter* Character = Cast<AActionGameCharacter>(CharacterOwner);
+	const float AttackLungeSpeed = Character ? Character->GetAttackLungeSpeed() : 0.f;
+	bAttackLocked = bAttackLocked || (Character && !Character->IsMovementEnabled());
+	bLunging = bLunging && AttackLungeSpeed > 0.f && LungeTimeRemaining > 0.f;
+	if (bLunging)
+	{
+		LungeSpeed = AttackLungeSpeed;
+	}
+}
+
+FNetworkPredictionData_Client* UCombatMovementComponent::GetPredictionData_Client() const
+{
+	if (ClientPredictionData == nullptr)
+	{
+		UCombatMovementComponent* MutableThis = const_cast<UCombatMovementComponent*>(this);
+		MutableThis->ClientPredictionData = new FNetworkPredictionData_Client_Combat(*this);
+	}
+	return ClientPredictionData;
+}
+
+void UCombatMovementComponent::SendClientAdjustment()
+{
+	const FNetworkPredictionData_Server_Character* ServerData = HasPredictionData_Server() ? GetPredictionData_Server_Character() : nullptr;
+	if (ServerData && ServerData->PendingAdjustment.TimeStamp > 0.f && !ServerData->PendingAdjustment.bAckGoodMove)
+	{
+		++CorrectionsSent;
+		INC_DWORD_STAT(STAT_MovementCorrectionsSent);
+	}
+
+	Super::SendClientAdjustment();
+}
+
+void UCombatMovementComponent::ClientAdjustPosition_Implementation(float TimeStamp, FVector NewLoc, FVector NewVel, UPrimitiveComponent* NewBase, FName NewBaseBoneName, bool bHasBase, bool bBaseRelativePosition, uint8 ServerMovementMode)
+{
+	++CorrectionsReceived;
+	INC_DWORD_STAT(STAT_MovementCorrectionsReceived);
+
+	Super::ClientAdjustPosition_Implementation(TimeStamp, NewLoc, NewVel, NewBase, NewBaseBoneName, bHasBase, bBaseRelativePosition, ServerMovementMode);
+}
+
+//========= SAVED MOVE =========//
+
+void FSavedMove_Combat::Clear()
+{
+	Super::Clear();
+
+	bSavedAttackLocked = false;
+	bSavedLunging = false;
+	SavedLungeSpeed = 0.f;
+	SavedLungeTimeRemaining = 0.f;
+}
+
+uint8 FSavedMove_Combat::GetCompressedFlags() const
+{
+	uint8 Flags = Super::GetCompressedFlags();
+	Flags |= bSavedAttackLocked ? FLAG_AttackLocked : 0;
+	Flags |= bSavedLunging ? FLAG_Lunging : 0;
+	return Flags;
+}
+
+bool FSavedMove_Combat::CanCombineWith(const FSavedMovePtr& NewMove, ACharacter* InCharacter, float MaxDelta) const
+{
+	const FSavedMove_Combat* NewCombatMove = static_cast<const FSavedMove_Combat*>(NewMove.Get());
+	if (bSavedAttackLocked != NewCombatMove->bSavedAttackLocked || bSavedLunging != NewCombatMove->bSavedLunging)
+	{
+		return false;
+	}
+	return Super::CanCombineWith(NewMove, InCharacter, MaxDelta);
+}
+
+void FSavedMove_Combat::SetMoveFor(ACharacter* Character, float InDeltaTime, FVector const& NewAccel, FNetworkPredictionData_Client_Character& ClientData)
+{
+	Super::SetMoveFor(Character, InDeltaTime, NewAccel, ClientData);
+
+	if (const UCombatMovementComponent* Movement = Cast<UCombatMovementComponent>(Character->GetCharacterMovement()))
+	{
+		bSavedAttackLocked = Movement->bAttackLocked;
+		bSavedLunging = Movement->bLunging;
+		SavedLungeSpeed = Movement->LungeSpeed;
+		SavedLungeTimeRemaining = Movement->LungeTimeRemaining;
+	}
+}
+
+void FSavedMove_Combat::PrepMoveFor(ACharacter* Character)
+{
+	Super::PrepMoveFor(Character);
+
+	if (UCombatMovementComponent* Movement = Cast<UCombatMovementComponent>(Character->GetCharacterMovement()))
+	{
+		Movement->bAttackLocked = bSavedAttackLocked;
+		Movement->bLunging = bSavedLunging;
+		Movement->LungeSpeed = SavedLungeSpeed;
+		Movement->LungeTimeRemaining = SavedLungeTimeRemaining;
+	}
+}
+
+FNetworkPredictionData_Client_Combat::FNetworkPredictionData_Client_Combat(const UCharacterMovementComponent& ClientMovement)
+	: Super(ClientMovement)
+{
+}
+
+FSavedMovePtr FNetworkPredictionData_Client_Combat::AllocateNewMove()
+{
+	return FSavedMovePtr(new FSavedMove_Combat());
+}
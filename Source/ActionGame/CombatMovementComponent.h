@@ -0,0 +1,107 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/CharacterMovementComponent.h"
+
+#include "CombatMovementComponent.generated.h"
+
+
+/**
+ * Character movement that predicts attacks.
+ *
+ * Attacks that root the character and attack lunges are applied inside the movement
+ * update rather than by dropping input, and their state travels with every saved move
+ * in the compressed move flags (FLAG_Custom_0 for the attack lock, FLAG_Custom_1 for the
+ * lunge). The server replays the client's moves with the same state, checked against its
+ * own copy of the attack: it keeps the character rooted while its attack roots it and
+ * only lunges while its own lunge lasts. The client replays its own moves with the state
+ * after a correction, so attacks cost no extra RPCs and cause no rubber-banding. Root motion of attack montages runs through the engine's
+ * predicted montage root motion, which the attack lock leaves alone.
+ *
+ * Corrections sent by the server and received by the owning client are counted for the
+ * combat net report.
+ */
+UCLASS()
+class ACTIONGAME_API UCombatMovementComponent : public UCharacterMovementComponent
+{
+	GENERATED_BODY()
+
+	friend class FSavedMove_Combat;
+
+public:
+	UCombatMovementComponent();
+
+	/** Moves the character forward at Speed for Duration seconds, ahead of its input. On the server of a remote player it is the longest lunge the client's moves get **/
+	void StartLunge(float Speed, float Duration);
+
+	/** Ends a lunge early, when its attack is stopped **/
+	void StopLunge();
+
+	FORCEINLINE bool IsAttackLocked() const { return bAttackLocked; }
+	FORCEINLINE bool IsLunging() const { return bLunging; }
+
+	/** corrections sent to the owning client (server) or received from the server (owning client) **/
+	FORCEINLINE uint32 GetCorrectionsSent() const { return CorrectionsSent; }
+	FORCEINLINE uint32 GetCorrectionsReceived() const { return CorrectionsReceived; }
+
+	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+	virtual float GetMaxAcceleration() const override;
+	virtual void UpdateFromCompressedFlags(uint8 Flags) override;
+	virtual class FNetworkPredictionData_Client* GetPredictionData_Client() const override;
+	virtual void SendClientAdjustment() override;
+	virtual void ClientAdjustPosition_Implementation(float TimeStamp, FVector NewLoc, FVector NewVel, UPrimitiveComponent* NewBase, FName NewBaseBoneName, bool bHasBase, bool bBaseRelativePosition, uint8 ServerMovementMode) override;
+
+protected:
+	virtual void UpdateCharacterStateAfterMovement(float DeltaSeconds) override;
+	virtual void CalcVelocity(float DeltaTime, float Friction, bool bFluid, float BrakingDeceleration) override;
+
+private:
+	/** whether this side decides the attack state itself rather than reading it from client moves **/
+	bool IsAttackStateLocal() const;
+
+	/** the current attack roots the character, input is ignored **/
+	bool bAttackLocked;
+
+	/** the character is driven forward at LungeSpeed **/
+	bool bLunging;
+
+	float LungeSpeed;
+
+	/** seconds of lunge left, kept by the controlling side and restored with replayed moves, counted down with the client's moves on the server **/
+	float LungeTimeRemaining;
+
+	uint32 CorrectionsSent;
+	uint32 CorrectionsReceived;
+};
+
+
+/** Saved move carrying the attack state of the move **/
+class FSavedMove_Combat : public FSavedMove_Character
+{
+public:
+	typedef FSavedMove_Character Super;
+
+	virtual void Clear() override;
+	virtual uint8 GetCompressedFlags() const override;
+	virtual bool CanCombineWith(const FSavedMovePtr& NewMove, ACharacter* InCharacter, float MaxDelta) const override;
+	virtual void SetMoveFor(ACharacter* Character, float InDeltaTime, FVector const& NewAccel, class FNetworkPredictionData_Client_Character& ClientData) override;
+	virtual void PrepMoveFor(ACharacter* Character) override;
+
+	bool bSavedAttackLocked;
+	bool bSavedLunging;
+	float SavedLungeSpeed;
+	float SavedLungeTimeRemaining;
+};
+
+
+class FNetworkPredictionData_Client_Combat : public FNetworkPredictionData_Client_Character
+{
+public:
+	typedef FNetworkPredictionData_Client_Character Super;
+
+	FNetworkPredictionData_Client_Combat(const UCharacterMovementComponent& ClientMovement);
+
+	virtual FSavedMovePtr AllocateNewMove() override;
+};
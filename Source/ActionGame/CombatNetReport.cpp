@@ -0,0 +1,225 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CombatNetReport.h"
+#include "ActionGameLog.h"
+#include "AttackEvent.h"
+#include "CombatManager.h"
+#include "CombatMovementComponent.h"
+#include "CombatStatistics.h"
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/Character.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Policies/PrettyJsonPrintPolicy.h"
+#include "Serialization/JsonWriter.h"
+
+
+namespace
+{
+	const TCHAR* GetNetModeName(ENetMode NetMode)
+	{
+		switch (NetMode)
+		{
+		case NM_DedicatedServer:	return TEXT("dedicated_server");
+		case NM_ListenServer:		return TEXT("listen_server");
+		case NM_Client:				return TEXT("client");
+		default:					return TEXT("standalone");
+		}
+	}
+}
+
+
+ACombatNetReport::ACombatNetReport()
+{
+	PrimaryActorTick.bCanEverTick = true;
+
+	SetReplicates(false);
+
+	Duration = 60.f;
+	bQuitWhenDone = true;
+	Elapsed = 0.f;
+	SinceLastSample = 0.f;
+	MaxConnections = 0;
+	AttackEventsSentAtStart = 0;
+	AttackEventsReceivedAtStart = 0;
+	CorrectionsSentAtStart = 0;
+	CorrectionsReceivedAtStart = 0;
+}
+
+ACombatNetReport* ACombatNetReport::Start(UWorld* World, float Seconds, bool bQuitWhenDone)
+{
+	if (World == nullptr || !World->IsGameWorld())
+	{
+		return nullptr;
+	}
+
+	ACombatNetReport* Report = World->SpawnActor<ACombatNetReport>();
+	if (Report == nullptr)
+	{
+		return nullptr;
+	}
+
+	Report->Duration = FMath::Max(Seconds, 1.f);
+	Report->bQuitWhenDone = bQuitWhenDone;
+	Report->OutputPath = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Benchmarks"),
+		FString::Printf(TEXT("CombatNet-%s-%s-%d.json"), GetNetModeName(World->GetNetMode()), *FDateTime::Now().ToString(), FPlatformProcess::GetCurrentProcessId()));
+
+	Report->CountMovementCorrections(Report->CorrectionsSentAtStart, Report->CorrectionsReceivedAtStart);
+
+	if (ACombatManager* CombatManager = ACombatManager::Get(World))
+	{
+		Report->AttackEventsSentAtStart = CombatManager->GetAttackEventsSent();
+		Report->AttackEventsReceivedAtStart = CombatManager->GetAttackEventsReceived();
+	}
+
+	AG_LOG(Combat, INFO, "Combat net report started for {} s", Report->Duration);
+	return Report;
+}
+
+void ACombatNetReport::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	Elapsed += DeltaSeconds;
+	SinceLastSample += DeltaSeconds;
+
+	// connections update their rates once per second
+	if (SinceLastSample >= 1.f)
+	{
+		SinceLastSample -= 1.f;
+		Sample();
+	}
+
+	if (Elapsed >= Duration)
+	{
+		WriteReport();
+		SetActorTickEnabled(false);
+		if (bQuitWhenDone)
+		{
+			FPlatformMisc::RequestExit(false);
+		}
+		else
+		{
+			Destroy();
+		}
+	}
+}
+
+void ACombatNetReport::Sample()
+{
+	UNetDriver* NetDriver = GetWorld()->GetNetDriver();
+	if (NetDriver == nullptr)
+	{
+		return;
+	}
+
+	TArray<UNetConnection*, TInlineAllocator<16>> Connections;
+	if (NetDriver->ServerConnection)
+	{
+		Connections.Add(NetDriver->ServerConnection);
+	}
+	Connections.Append(NetDriver->ClientConnections);
+
+	float InBytes = 0.f;
+	float OutBytes = 0.f;
+	for (UNetConnection* Connection : Connections)
+	{
+		if (Connection == nullptr)
+		{
+			continue;
+		}
+		InBytes += Connection->InBytesPerSecond;
+		OutBytes += Connection->OutBytesPerSecond;
+		RoundTripMilliseconds.Add(Connection->AvgLag * 1000.f);
+	}
+
+	InBytesPerSecond.Add(InBytes);
+	OutBytesPerSecond.Add(OutBytes);
+	MaxConnections = FMath::Max(MaxConnections, Connections.Num());
+}
+
+void ACombatNetReport::CountMovementCorrections(uint32& OutSent, uint32& OutReceived) const
+{
+	OutSent = 0;
+	OutReceived = 0;
+	for (TActorIterator<ACharacter> It(GetWorld()); It; ++It)
+	{
+		if (const UCombatMovementComponent* Movement = Cast<UCombatMovementComponent>(It->GetCharacterMovement()))
+		{
+			OutSent += Movement->GetCorrectionsSent();
+			OutReceived += Movement->GetCorrectionsReceived();
+		}
+	}
+}
+
+void ACombatNetReport::WriteReport() const
+{
+	const ACombatManager* CombatManager = ACombatManager::Get(GetWorld());
+	const uint32 EventsSent = CombatManager ? CombatManager->GetAttackEventsSent() - AttackEventsSentAtStart : 0;
+	const uint32 EventsReceived = CombatManager ? CombatManager->GetAttackEventsReceived() - AttackEventsReceivedAtStart : 0;
+
+	TArray<float> EventLatencyMilliseconds;
+	if (CombatManager)
+	{
+		for (float Latency : CombatManager->GetAttackEventLatencies())
+		{
+			EventLatencyMilliseconds.Add(Latency * 1000.f);
+		}
+	}
+
+	FString Json;
+	TSharedRef<TJsonWriter<TCHAR, TPrettyJsonPrintPolicy<TCHAR>>> Writer = TJsonWriterFactory<TCHAR, TPrettyJsonPrintPolicy<TCHAR>>::Create(&Json);
+
+	Writer->WriteObjectStart();
+	FCombatStatistics::WriteBuild(Writer);
+
+	Writer->WriteValue(TEXT("map"), GetWorld()->GetMapName());
+	Writer->WriteValue(TEXT("net_mode"), GetNetModeName(GetWorld()->GetNetMode()));
+	Writer->WriteValue(TEXT("seconds"), Elapsed);
+	Writer->WriteValue(TEXT("connections"), MaxConnections);
+
+	FCombatStatistics::WriteDistribution(Writer, TEXT("in_bytes_per_second"), InBytesPerSecond);
+	FCombatStatistics::WriteDistribution(Writer, TEXT("out_bytes_per_second"), OutBytesPerSecond);
+	FCombatStatistics::WriteDistribution(Writer, TEXT("round_trip_ms"), RoundTripMilliseconds);
+
+	Writer->WriteObjectStart(TEXT("attack_events"));
+	Writer->WriteValue(TEXT("bits_per_event"), FAttackEvent::GetSerializedBits());
+	Writer->WriteValue(TEXT("sent"), static_cast<int64>(EventsSent));
+	Writer->WriteValue(TEXT("received"), static_cast<int64>(EventsReceived));
+	Writer->WriteValue(TEXT("payload_bytes_per_second"), Elapsed > 0.f ? (EventsSent + EventsReceived) * FAttackEvent::GetSerializedBits() / 8.f / Elapsed : 0.f);
+	FCombatStatistics::WriteDistribution(Writer, TEXT("delay_ms"), EventLatencyMilliseconds);
+	Writer->WriteObjectEnd();
+
+	// filled on the server, hits claimed by clients and checked against rewound positions
+	Writer->WriteObjectStart(TEXT("hit_claims"));
+	Writer->WriteValue(TEXT("accepted"), CombatManager ? static_cast<int64>(CombatManager->GetHitClaimsAccepted()) : 0);
+	Writer->WriteValue(TEXT("rejected"), CombatManager ? static_cast<int64>(CombatManager->GetHitClaimsRejected()) : 0);
+	Writer->WriteObjectEnd();
+
+	// corrections of predicted movement, sent by the server and received by clients - characters destroyed meanwhile are not counted
+	uint32 CorrectionsSent, CorrectionsReceived;
+	CountMovementCorrections(CorrectionsSent, CorrectionsReceived);
+	CorrectionsSent -= FMath::Min(CorrectionsSent, CorrectionsSentAtStart);
+	CorrectionsReceived -= FMath::Min(CorrectionsReceived, CorrectionsReceivedAtStart);
+
+	Writer->WriteObjectStart(TEXT("movement_corrections"));
+	Writer->WriteValue(TEXT("sent"), static_cast<int64>(CorrectionsSent));
+	Writer->WriteValue(TEXT("received"), static_cast<int64>(CorrectionsReceived));
+	Writer->WriteValue(TEXT("per_second"), Elapsed > 0.f ? (CorrectionsSent + CorrectionsReceived) / Elapsed : 0.f);
+	Writer->WriteObjectEnd();
+
+	Writer->WriteObjectEnd();
+	Writer->Close();
+
+	if (FFileHelper::SaveStringToFile(Json, *OutputPath))
+	{
+		AG_LOG(Combat, INFO, "Combat net report written to {}", OutputPath);
+	}
+	else
+	{
+		AG_LOG(Combat, ERROR, "Combat net report could not write {}", OutputPath);
+	}
+}
@@ -0,0 +1,68 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+
+#include "CombatNetReport.generated.h"
+
+
+/**
+ * Bandwidth and latency report of a networked fight.
+ *
+ * Samples the net connections of this instance once per second (bytes in and
+ * out, round trip time) together with the attack events the combat manager has
+ * sent and received, the delay they arrived with and the movement corrections of
+ * the predicted character movement. Results are written as JSON to
+ * Saved/Benchmarks, one file per instance.
+ *
+ * Local multi-client run, each client replaying a recorded fight:
+ *     ActionGame ThirdPersonExampleMap?listen -CombatNetReport=60
+ *     ActionGame 127.0.0.1 -nullrhi -CombatNetReport=60 -CombatReplay=<name>
+ */
+UCLASS(NotBlueprintable, Transient)
+class ACTIONGAME_API ACombatNetReport : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	ACombatNetReport();
+
+	/** Spawns a report in World measuring for Seconds **/
+	static ACombatNetReport* Start(UWorld* World, float Seconds, bool bQuitWhenDone);
+
+	virtual void Tick(float DeltaSeconds) override;
+
+	/** seconds measured **/
+	float Duration;
+
+	/** exit the game once the report is written **/
+	bool bQuitWhenDone;
+
+	/** JSON report file **/
+	FString OutputPath;
+
+private:
+	void Sample();
+	void WriteReport() const;
+
+	/** corrections counted by the movement components of the characters in the world **/
+	void CountMovementCorrections(uint32& OutSent, uint32& OutReceived) const;
+
+	float Elapsed;
+	float SinceLastSample;
+
+	int32 MaxConnections;
+	uint32 AttackEventsSentAtStart;
+	uint32 AttackEventsReceivedAtStart;
+	uint32 CorrectionsSentAtStart;
+	uint32 CorrectionsReceivedAtStart;
+
+	/** one entry per second, summed over connections **/
+	TArray<float> InBytesPerSecond;
+	TArray<float> OutBytesPerSecond;
+
+	/** one entry per connection per second **/
+	TArray<float> RoundTripMilliseconds;
+};
@@ -0,0 +1,212 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CombatSignificanceManager.h"
+#include "ActionGameCharacter.h"
+#include "CombatLatencyTracer.h"
+#include "EngineUtils.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "Camera/PlayerCameraManager.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/App.h"
+
+
+DECLARE_CYCLE_STAT(TEXT("Significance update"), STAT_SignificanceUpdate, STATGROUP_ActionGameCombat);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Significance high"), STAT_SignificanceHigh, STATGROUP_ActionGameCombat);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Significance medium"), STAT_SignificanceMedium, STATGROUP_ActionGameCombat);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Significance low"), STAT_SignificanceLow, STATGROUP_ActionGameCombat);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Significance dormant"), STAT_SignificanceDormant, STATGROUP_ActionGameCombat);
+
+namespace
+{
+	TMap<TWeakObjectPtr<UWorld>, TWeakObjectPtr<ACombatSignificanceManager>> SignificanceManagers;
+
+	FCombatSignificanceTier Tiers[] =
+	{
+		// MaxDistance	Budget	Tick	Animation	Movement	FullCollision	Audible
+		{ 2000.f,		16,		0.f,	0.f,		0.f,		true,			true },		// HIGH
+		{ 5000.f,		48,		0.05f,	0.033f,		0.f,		true,			true },		// MEDIUM
+		{ 12000.f,		128,	0.2f,	0.1f,		0.05f,		false,			false },	// LOW
+		{ MAX_flt,		-1,		0.5f,	0.25f,		0.2f,		false,			false },	// DORMANT
+	};
+
+	static_assert(ARRAY_COUNT(Tiers) == static_cast<uint8>(ECombatSignificance::MAX), "Every ECombatSignificance needs a tier");
+
+	int32 SignificanceEnabled = 1;
+	FAutoConsoleVariableRef CVarSignificanceEnabled(TEXT("ActionGame.Significance.Enabled"), SignificanceEnabled, TEXT("Scale character updates by significance, 0 keeps every character at full detail"));
+
+	float UpdateInterval = 0.1f;
+	FAutoConsoleVariableRef CVarSignificanceInterval(TEXT("ActionGame.Significance.UpdateInterval"), UpdateInterval, TEXT("Seconds between significance rankings"));
+
+	float OffscreenDistanceScale = 2.f;
+	FAutoConsoleVariableRef CVarSignificanceOffscreen(TEXT("ActionGame.Significance.OffscreenScale"), OffscreenDistanceScale, TEXT("Distance multiplier of characters no camera sees"));
+
+	FAutoConsoleVariableRef CVarHighDistance(TEXT("ActionGame.Significance.HighDistance"), Tiers[0].MaxDistance, TEXT("Effective distance of the high significance tier"));
+	FAutoConsoleVariableRef CVarMediumDistance(TEXT("ActionGame.Significance.MediumDistance"), Tiers[1].MaxDistance, TEXT("Effective distance of the medium significance tier"));
+	FAutoConsoleVariableRef CVarLowDistance(TEXT("ActionGame.Significance.LowDistance"), Tiers[2].MaxDistance, TEXT("Effective distance of the low significance tier"));
+
+	FAutoConsoleVariableRef CVarHighBudget(TEXT("ActionGame.Significance.HighBudget"), Tiers[0].Budget, TEXT("Characters in the high significance tier at most"));
+	FAutoConsoleVariableRef CVarMediumBudget(TEXT("ActionGame.Significance.MediumBudget"), Tiers[1].Budget, TEXT("Characters in the medium significance tier at most"));
+	FAutoConsoleVariableRef CVarLowBudget(TEXT("ActionGame.Significance.LowBudget"), Tiers[2].Budget, TEXT("Characters in the low significance tier at most"));
+
+	/** seconds a character may go unrendered and still count as seen **/
+	const float RenderedTolerance = 0.25f;
+}
+
+
+ACombatSignificanceManager::ACombatSignificanceManager()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	// rank once the cameras have moved for this frame
+	PrimaryActorTick.TickGroup = TG_PostUpdateWork;
+
+	SetReplicates(false);
+
+	TimeUntilUpdate = 0.f;
+	FMemory::Memzero(TierCounts);
+}
+
+ACombatSignificanceManager* ACombatSignificanceManager::Get(const UObject* WorldContextObject)
+{
+	UWorld* World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull);
+	if (World == nullptr || !World->IsGameWorld())
+	{
+		return nullptr;
+	}
+
+	TWeakObjectPtr<ACombatSignificanceManager>& SignificanceManager = SignificanceManagers.FindOrAdd(World);
+	if (!SignificanceManager.IsValid())
+	{
+		FActorSpawnParameters SpawnParameters;
+		SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		SpawnParameters.ObjectFlags |= RF_Transient;
+
+		SignificanceManager = World->SpawnActor<ACombatSignificanceManager>(SpawnParameters);
+	}
+	return SignificanceManager.Get();
+}
+
+const FCombatSignificanceTier& ACombatSignificanceManager::GetTier(ECombatSignificance Tier)
+{
+	return Tiers[FMath::Min(static_cast<int32>(Tier), static_cast<int32>(ECombatSignificance::DORMANT))];
+}
+
+void ACombatSignificanceManager::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	SignificanceManagers.Remove(GetWorld());
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void ACombatSignificanceManager::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	TimeUntilUpdate -= DeltaSeconds;
+	if (TimeUntilUpdate > 0.f)
+	{
+		return;
+	}
+	TimeUntilUpdate = UpdateInterval;
+
+	SCOPE_CYCLE_COUNTER(STAT_SignificanceUpdate);
+
+	GatherViewers();
+	FMemory::Memzero(TierCounts);
+	Ranked.Reset();
+
+	for (TActorIterator<AActionGameCharacter> It(GetWorld()); It; ++It)
+	{
+		AActionGameCharacter* Character = *It;
+		if (Character->IsPooled() || Character->IsPendingKill())
+		{
+			continue;
+		}
+
+		// the player's own character, and everyone while the system is off or nobody is looking, stay at full detail
+		if (!SignificanceEnabled || Viewers.Num() == 0 || Character->IsLocallyControlled())
+		{
+			Character->SetSignificance(ECombatSignificance::HIGH);
+			++TierCounts[static_cast<int32>(ECombatSignificance::HIGH)];
+			continue;
+		}
+
+		Ranked.Add(FRankedCharacter{ Character, GetEffectiveDistance(Character) });
+	}
+
+	// closest first, each takes the best tier it is in range of that still has room
+	Ranked.Sort([](const FRankedCharacter& A, const FRankedCharacter& B) { return A.Distance < B.Distance; });
+
+	int32 Tier = 0;
+	for (const FRankedCharacter& Entry : Ranked)
+	{
+		while (Tier < static_cast<int32>(ECombatSignificance::DORMANT)
+			&& (Entry.Distance > Tiers[Tier].MaxDistance || (Tiers[Tier].Budget >= 0 && TierCounts[Tier] >= Tiers[Tier].Budget)))
+		{
+			++Tier;
+		}
+
+		Entry.Character->SetSignificance(static_cast<ECombatSignificance>(Tier));
+		++TierCounts[Tier];
+	}
+
+	SET_DWORD_STAT(STAT_SignificanceHigh, TierCounts[static_cast<int32>(ECombatSignificance::HIGH)]);
+	SET_DWORD_STAT(STAT_SignificanceMedium, TierCounts[static_cast<int32>(ECombatSignificance::MEDIUM)]);
+	SET_DWORD_STAT(STAT_SignificanceLow, TierCounts[static_cast<int32>(ECombatSignificance::LOW)]);
+	SET_DWORD_STAT(STAT_SignificanceDormant, TierCounts[static_cast<int32>(ECombatSignificance::DORMANT)]);
+}
+
+void ACombatSignificanceManager::GatherViewers()
+{
+	Viewers.Reset();
+
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* PlayerController = It->Get();
+		if (PlayerController == nullptr)
+		{
+			continue;
+		}
+
+		// local players look through their follow camera, remote players only count by where their pawn is
+		if (PlayerController->IsLocalController() && PlayerController->PlayerCameraManager)
+		{
+			const APlayerCameraManager* CameraManager = PlayerController->PlayerCameraManager;
+			const float HalfFOV = FMath::DegreesToRadians(FMath::Min(CameraManager->GetFOVAngle(), 170.f) * 0.5f);
+
+			FViewer& Viewer = Viewers[Viewers.AddDefaulted()];
+			Viewer.Location = CameraManager->GetCameraLocation();
+			Viewer.Direction = CameraManager->GetCameraRotation().Vector();
+			Viewer.CosHalfFOV = FMath::Cos(HalfFOV);
+			Viewer.bHasView = true;
+		}
+		else if (const APawn* Pawn = PlayerController->GetPawn())
+		{
+			FViewer& Viewer = Viewers[Viewers.AddDefaulted()];
+			Viewer.Location = Pawn->GetActorLocation();
+			Viewer.Direction = FVector::ForwardVector;
+			Viewer.CosHalfFOV = -1.f;
+			Viewer.bHasView = false;
+		}
+	}
+}
+
+float ACombatSignificanceManager::GetEffectiveDistance(const AActionGameCharacter* Character) const
+{
+	const FVector Location = Character->GetActorLocation();
+
+	// in a camera's view cone and drawn lately, when anything is drawn at all
+	const bool bRendered = !FApp::CanEverRender() || Character->WasRecentlyRendered(RenderedTolerance);
+
+	float Closest = MAX_flt;
+	for (const FViewer& Viewer : Viewers)
+	{
+		const FVector ToCharacter = Location - Viewer.Location;
+		const float Distance = ToCharacter.Size();
+
+		const bool bSeen = !Viewer.bHasView || (bRendered && (ToCharacter | Viewer.Direction) >= Viewer.CosHalfFOV * Distance);
+		Closest = FMath::Min(Closest, bSeen ? Distance : Distance * OffscreenDistanceScale);
+	}
+	return Closest;
+}
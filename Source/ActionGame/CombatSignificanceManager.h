@@ -0,0 +1,107 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+
+#include "CombatSignificanceManager.generated.h"
+
+class AActionGameCharacter;
+
+
+UENUM(BlueprintType)
+enum class ECombatSignificance : uint8 {
+	HIGH		UMETA(DisplayName = "High"),
+	MEDIUM		UMETA(DisplayName = "Medium"),
+	LOW			UMETA(DisplayName = "Low"),
+	DORMANT		UMETA(DisplayName = "Dormant"),
+
+	MAX			UMETA(Hidden)
+};
+
+
+/** How much of a character is updated in one significance tier **/
+struct FCombatSignificanceTier
+{
+	/** effective distance to the closest viewer the tier reaches to, characters off screen count as further away **/
+	float MaxDistance;
+
+	/** characters the tier holds at most, the rest drop to the next tier - negative for no limit **/
+	int32 Budget;
+
+	/** tick intervals of the actor, its animation and its movement, 0 ticks every frame **/
+	float TickInterval;
+	float AnimationTickInterval;
+	float MovementTickInterval;
+
+	/** physics bodies of the mesh follow its animation, limb boxes stay on their sockets between attacks **/
+	bool bFullCollision;
+
+	/** combat sounds are requested at all **/
+	bool bAudible;
+};
+
+
+/**
+ * Ranks characters by distance to the local cameras, off screen characters counting as
+ * further away, and sorts them into significance tiers under per-tier budgets. Each tier
+ * sets how often a character ticks, evaluates its animation and moves, whether its mesh
+ * bodies and limb boxes follow the animation and whether it plays combat sounds. Attack
+ * windows and hits run on the combat manager's montage clock, so throttled animation
+ * does not change the fight.
+ *
+ * Servers without a local camera rank by distance to the player pawns. Locally controlled
+ * characters are always HIGH. "stat ActionGameCombat" shows the characters in each tier.
+ *
+ * Spawned on demand, one per game world.
+ */
+UCLASS(NotBlueprintable, Transient)
+class ACTIONGAME_API ACombatSignificanceManager : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	ACombatSignificanceManager();
+
+	/** Returns the significance manager of WorldContextObject's world, spawning it when needed **/
+	static ACombatSignificanceManager* Get(const UObject* WorldContextObject);
+
+	/** Settings of Tier, shared by every world **/
+	static const FCombatSignificanceTier& GetTier(ECombatSignificance Tier);
+
+	virtual void Tick(float DeltaSeconds) override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	FORCEINLINE int32 GetNumInTier(ECombatSignificance Tier) const { return TierCounts[static_cast<int32>(Tier)]; }
+
+private:
+	struct FViewer
+	{
+		FVector Location;
+		FVector Direction;
+
+		/** cosine of half the view angle, characters outside the cone are off screen **/
+		float CosHalfFOV;
+		bool bHasView;
+	};
+
+	struct FRankedCharacter
+	{
+		AActionGameCharacter* Character;
+		float Distance;
+	};
+
+	void GatherViewers();
+
+	/** distance to the closest viewer, scaled up when no viewer sees the character **/
+	float GetEffectiveDistance(const AActionGameCharacter* Character) const;
+
+	float TimeUntilUpdate;
+
+	int32 TierCounts[static_cast<int32>(ECombatSignificance::MAX)];
+
+	/** reused by the update **/
+	TArray<FViewer, TInlineAllocator<4>> Viewers;
+	TArray<FRankedCharacter> Ranked;
+};
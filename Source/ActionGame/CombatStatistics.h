@@ -0,0 +1,60 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Misc/App.h"
+#include "Misc/DateTime.h"
+#include "Misc/EngineVersion.h"
+
+
+/** Sample statistics and JSON helpers shared by the combat benchmark and reports **/
+struct FCombatStatistics
+{
+	/** Returns the value below which Percentile of the samples fall **/
+	static float GetPercentile(TArray<float> Samples, float Percentile)
+	{
+		if (Samples.Num() == 0)
+		{
+			return 0.f;
+		}
+		Samples.Sort();
+		const int32 Index = FMath::Clamp(FMath::CeilToInt(Percentile * Samples.Num()) - 1, 0, Samples.Num() - 1);
+		return Samples[Index];
+	}
+
+	static float GetAverage(const TArray<float>& Samples)
+	{
+		float Sum = 0.f;
+		for (float Sample : Samples)
+		{
+			Sum += Sample;
+		}
+		return Samples.Num() > 0 ? Sum / Samples.Num() : 0.f;
+	}
+
+	template <typename WriterType>
+	static void WriteDistribution(WriterType& Writer, const TCHAR* Name, const TArray<float>& Samples)
+	{
+		Writer->WriteObjectStart(Name);
+		Writer->WriteValue(TEXT("avg"), GetAverage(Samples));
+		Writer->WriteValue(TEXT("p50"), GetPercentile(Samples, 0.50f));
+		Writer->WriteValue(TEXT("p90"), GetPercentile(Samples, 0.90f));
+		Writer->WriteValue(TEXT("p95"), GetPercentile(Samples, 0.95f));
+		Writer->WriteValue(TEXT("p99"), GetPercentile(Samples, 0.99f));
+		Writer->WriteValue(TEXT("max"), GetPercentile(Samples, 1.00f));
+		Writer->WriteObjectEnd();
+	}
+
+	/** Writes the "build" object identifying the binary a report comes from **/
+	template <typename WriterType>
+	static void WriteBuild(WriterType& Writer)
+	{
+		Writer->WriteObjectStart(TEXT("build"));
+		Writer->WriteValue(TEXT("version"), FApp::GetBuildVersion());
+		Writer->WriteValue(TEXT("configuration"), FString(EBuildConfigurations::ToString(FApp::GetBuildConfiguration())));
+		Writer->WriteValue(TEXT("engine"), FEngineVersion::Current().ToString());
+		Writer->WriteValue(TEXT("date"), FDateTime::UtcNow().ToIso8601());
+		Writer->WriteObjectEnd();
+	}
+};
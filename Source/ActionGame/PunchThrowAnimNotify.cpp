@@ -10,9 +10,9 @@ void UPunchThrowAnimNotify::Notify(USkeletalMeshComponent* MeshComp, UAnimSequen
 	if (MeshComp != NULL && MeshComp->GetOwner() != NULL)
 	{
 		AActionGameCharacter* player = Cast<AActionGameCharacter>(MeshComp->GetOwner());
-		if (player != NULL && !player->PunchThrowAudioComponent->IsPlaying())
+		if (player != NULL)
 		{
-			player->PunchThrowAudioComponent->Play(0.0f);
+			player->PlayPunchThrowSound();
 		}
 	}*/
 }
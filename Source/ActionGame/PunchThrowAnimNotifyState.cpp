@@ -2,17 +2,21 @@
 
 #include "PunchThrowAnimNotifyState.h"
 #include "ActionGameCharacter.h"
+#include "CombatLatencyTracer.h"
 #include "Engine.h"
 
+DECLARE_CYCLE_STAT(TEXT("PunchThrowNotifyState Begin"), STAT_PunchThrowNotifyStateBegin, STATGROUP_ActionGameCombat);
+
 void UPunchThrowAnimNotifyState::NotifyBegin(USkeletalMeshComponent * MeshComp, UAnimSequenceBase * Animation, float TotalDuration)
 {
-	GEngine->AddOnScreenDebugMessage(-1, 3.0f, FColor::Orange, __FUNCTION__);
+	SCOPE_CYCLE_COUNTER(STAT_PunchThrowNotifyStateBegin);
+	AG_LOG(Animation, DEBUG, "{}", __FUNCTION__);
 	if (MeshComp != NULL && MeshComp->GetOwner() != NULL)
 	{
 		AActionGameCharacter* player = Cast<AActionGameCharacter>(MeshComp->GetOwner());
-		if (player != NULL && !player->PunchThrowAudioComponent->IsPlaying())
+		if (player != NULL && !player->HasAttackTimeline())
 		{
-			player->PunchThrowAudioComponent->Play(0.0f);
+			player->PlayPunchThrowSound();
 		}
 	}
 }
@@ -24,5 +28,5 @@ void UPunchThrowAnimNotifyState::NotifyTick(USkeletalMeshComponent * MeshComp, U
 
 void UPunchThrowAnimNotifyState::NotifyEnd(USkeletalMeshComponent * MeshComp, UAnimSequenceBase * Animation)
 {
-	GEngine->AddOnScreenDebugMessage(-1, 3.0f, FColor::Orange, __FUNCTION__);
+	AG_LOG(Animation, DEBUG, "{}", __FUNCTION__);
 }